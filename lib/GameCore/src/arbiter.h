@@ -0,0 +1,137 @@
+#ifndef ARBITER_H
+#define ARBITER_H
+
+#include <stdint.h>
+#include "node_set.h"
+
+// ============================================================================
+// PRESS ARBITRATION
+// ============================================================================
+//
+// Radio retries, channel contention and receive task scheduling can deliver
+// two presses in the opposite order to the one they happened in. Instead of
+// locking in whichever frame arrives first, the controller opens a short
+// window on the first press, collects every press that arrives during it, and
+// then picks the earliest by (clock-synchronized) press time.
+//
+// A window of 0 disables arbitration: the first press wins immediately.
+// All times are controller-time microseconds.
+//
+// There is one candidate slot per node (ids 1..N), so a round never drops a
+// press however many buzzers join it. A NodeSet marks the nodes already in
+// the round, so a repeated press finds its slot without a search.
+
+template <uint8_t N> class PressArbiter {
+  static_assert(N >= 1 && N <= 64, "PressArbiter supports 1-64 nodes");
+
+public:
+  struct Result {
+    uint8_t winner;        // Node id of the earliest press
+    int64_t pressTimeUs;   // Winner's press time
+    int64_t marginUs;      // Gap to the runner-up, -1 if uncontested
+    uint8_t candidates;    // Distinct nodes that pressed in the window
+    bool reordered;        // Winner was not the first frame to arrive
+  };
+
+  explicit PressArbiter(uint32_t windowUs)
+      : windowUs_(windowUs), open_(false), openedAtUs_(0), count_(0),
+        firstArrival_(0), rounds_(0), contested_(0), reordered_(0) {}
+
+  void setWindowUs(uint32_t windowUs) { windowUs_ = windowUs; }
+  uint32_t windowUs() const { return windowUs_; }
+  bool isEnabled() const { return windowUs_ > 0; }
+  bool isOpen() const { return open_; }
+
+  // Record a press (nodeId 1..N, others are ignored). The first press opens
+  // the window.
+  void submit(uint8_t nodeId, int64_t pressTimeUs, int64_t arrivalUs) {
+    if (nodeId < 1 || nodeId > N) return;
+    if (!open_) {
+      open_ = true;
+      openedAtUs_ = arrivalUs;
+      count_ = 0;
+      inRound_.clear();
+      firstArrival_ = nodeId;
+    }
+
+    // Repeated press from the same node: keep its earliest time
+    int64_t& time = times_[nodeId - 1];
+    if (inRound_.test(nodeId)) {
+      if (pressTimeUs < time) time = pressTimeUs;
+      return;
+    }
+
+    inRound_.set(nodeId);
+    nodes_[count_++] = nodeId;
+    time = pressTimeUs;
+  }
+
+  // True once the window that opened on the first press has elapsed
+  bool isDue(int64_t nowUs) const {
+    return open_ && (nowUs - openedAtUs_) >= (int64_t)windowUs_;
+  }
+
+  // Close the window and pick the earliest press. Only valid while open.
+  Result resolve() {
+    Result result;
+    uint8_t best = nodes_[0];
+    for (uint8_t i = 1; i < count_; i++) {
+      if (times_[nodes_[i] - 1] < times_[best - 1]) best = nodes_[i];
+    }
+
+    int64_t runnerUp = INT64_MAX;
+    for (uint8_t i = 0; i < count_; i++) {
+      if (nodes_[i] != best && times_[nodes_[i] - 1] < runnerUp) {
+        runnerUp = times_[nodes_[i] - 1];
+      }
+    }
+
+    result.winner = best;
+    result.pressTimeUs = times_[best - 1];
+    result.marginUs = count_ > 1 ? runnerUp - result.pressTimeUs : -1;
+    result.candidates = count_;
+    result.reordered = best != firstArrival_;
+
+    rounds_++;
+    if (count_ > 1) contested_++;
+    if (result.reordered) reordered_++;
+
+    open_ = false;
+    count_ = 0;
+    inRound_.clear();
+    return result;
+  }
+
+  // Drop any pending round (e.g. on a full reset)
+  void cancel() {
+    open_ = false;
+    count_ = 0;
+    inRound_.clear();
+  }
+
+  uint32_t rounds() const { return rounds_; }
+  uint32_t contested() const { return contested_; }
+  // How often arrival order and press-time order disagreed on the winner
+  uint32_t reordered() const { return reordered_; }
+
+  void resetStats() {
+    rounds_ = 0;
+    contested_ = 0;
+    reordered_ = 0;
+  }
+
+private:
+  uint32_t windowUs_;
+  bool open_;
+  int64_t openedAtUs_;
+  uint8_t nodes_[N];   // Nodes in the round, in arrival order
+  int64_t times_[N];   // Earliest press time per node (index nodeId - 1)
+  NodeSet<N> inRound_; // Nodes with an entry in nodes_
+  uint8_t count_;
+  uint8_t firstArrival_;
+  uint32_t rounds_;
+  uint32_t contested_;
+  uint32_t reordered_;
+};
+
+#endif // ARBITER_H
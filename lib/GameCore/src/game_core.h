@@ -0,0 +1,362 @@
+#ifndef GAME_CORE_H
+#define GAME_CORE_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "protocol.h"
+#include "node_set.h"
+#include "arbiter.h"
+
+// ============================================================================
+// GAME CORE (hardware-independent buzzer game state machine)
+// ============================================================================
+//
+// The READY / LOCKED / PARTIAL_LOCKOUT state machine, press arbitration and
+// the LED state / state sync encoding, with no Arduino, ESP-NOW or Serial
+// dependency. The firmware plugs in its radio, clock and serial/BLE output
+// through the three interfaces below; host builds plug in fakes, so the same
+// code runs on the ESP32 and on a build machine.
+//
+// Not thread-safe: one task (the controller's game task) drives it.
+
+enum GameState {
+  STATE_READY,          // Waiting for first press, all buzzers active
+  STATE_LOCKED,         // One buzzer pressed, all others locked out
+  STATE_PARTIAL_LOCKOUT // Wrong answer given, that buzzer locked, others can try
+};
+
+// The game state that survives a controller restart: enough to put every
+// LED back where it was. Plain data, so it can be stored as-is.
+struct GameSnapshot {
+  uint8_t state;        // GameState
+  uint8_t selected;     // 1-N, or 0 if none
+  uint16_t ledSeq;      // LED state sequence at the time
+  uint64_t locked;      // Locked-out buzzers (bit 0 = buzzer 1)
+};
+
+// Monotonic microsecond clock of the device running the code (controller
+// time base for GameCore, node time base for NodeLink)
+class GameClock {
+public:
+  virtual ~GameClock() {}
+  virtual int64_t nowUs() = 0;
+};
+
+// Delivery of encoded state to the buzzer nodes
+class GameTransport {
+public:
+  virtual ~GameTransport() {}
+  // New LED state for every node (seq already advanced)
+  virtual void publishLedState(const LedStateMessage& frame) = 0;
+  // Full state for one (re)connecting node
+  virtual void sendStateSync(uint8_t nodeId, const StateSyncMessage& msg) = 0;
+};
+
+// Text output: host protocol lines (BUZZ, CORRECT, ...) and debug traces
+class GameOutput {
+public:
+  virtual ~GameOutput() {}
+  virtual void report(const char* line) = 0;
+  virtual void debug(const char* line) = 0;
+  // False skips formatting debug lines altogether
+  virtual bool debugEnabled() const { return true; }
+  // A buzzer was locked in (called before its BUZZ line is reported).
+  // marginUs: gap to the runner-up press, -1 if nobody else pressed.
+  virtual void buzzed(uint8_t /* nodeId */, uint64_t /* pressTimeUs */,
+                      int64_t /* marginUs */) {}
+};
+
+template <uint8_t N> class GameCore {
+  static_assert(N >= 1 && N <= MAX_NODES, "node count must be between 1 and MAX_NODES");
+
+public:
+  static const uint8_t LINE_LENGTH = 121; // Longest report/debug line + NUL
+
+  GameCore(GameClock& clock, GameTransport& transport, GameOutput& output,
+           uint32_t arbitrationWindowUs)
+      : clock_(clock), transport_(transport), output_(output),
+        arbiter_(arbitrationWindowUs), state_(STATE_READY), selected_(0),
+        lastPressTimeUs_(0), epoch_(0), ledFrame_() {}
+
+  // State version = (epoch, LED sequence). The epoch identifies this run of
+  // the controller (set once at boot, before anything is published), so
+  // nodes can tell a restart from a sequence number they already hold.
+  void setEpoch(uint32_t epoch) {
+    epoch_ = epoch;
+    ledFrame_.epoch = epoch;
+  }
+
+  // ==========================================================================
+  // Inputs
+  // ==========================================================================
+
+  // pressTimeUs: press edge in controller time; arrivalUs: frame receive time
+  void press(uint8_t nodeId, uint64_t pressTimeUs, int64_t arrivalUs) {
+    if (nodeId < 1 || nodeId > N) return;
+
+    // Check if this buzzer is locked out
+    if (locked_.test(nodeId)) {
+      debug("Buzzer %u is locked out, ignoring press", nodeId);
+      return;
+    }
+
+    if (state_ == STATE_READY || state_ == STATE_PARTIAL_LOCKOUT) {
+      if (!arbiter_.isEnabled()) {
+        // First frame to arrive wins
+        lockIn(nodeId, pressTimeUs, -1);
+        return;
+      }
+
+      // Collect presses until the window closes, then pick the earliest
+      if (!arbiter_.isOpen()) {
+        debug("Buzzer %u pressed, arbitration window open", nodeId);
+      }
+      arbiter_.submit(nodeId, (int64_t)pressTimeUs, arrivalUs);
+    } else if (state_ == STATE_LOCKED) {
+      // Already locked, ignore subsequent presses
+      debug("System locked, ignoring press from buzzer %u", nodeId);
+    }
+  }
+
+  // Call regularly: resolves the arbitration round once its window elapsed
+  void poll() {
+    if (!arbiter_.isDue(clock_.nowUs())) return;
+
+    typename PressArbiter<N>::Result result = arbiter_.resolve();
+    if (result.reordered) {
+      debug("Arbitration: buzzer %u pressed first but its frame arrived later",
+            result.winner);
+    }
+    lockIn(result.winner, (uint64_t)result.pressTimeUs, result.marginUs);
+  }
+
+  void correct() {
+    if (selected_ == 0) {
+      debug("No buzzer selected, ignoring CORRECT command");
+      return;
+    }
+
+    debug("CORRECT answer - resetting to READY");
+
+    // Reset to ready state
+    state_ = STATE_READY;
+    selected_ = 0;
+    locked_.clear();
+
+    report("CORRECT");
+
+    // All LEDs on
+    publishLeds();
+  }
+
+  void wrong() {
+    if (selected_ == 0) {
+      debug("No buzzer selected, ignoring WRONG command");
+      return;
+    }
+
+    debug("WRONG answer from buzzer %u - entering PARTIAL_LOCKOUT", selected_);
+
+    // Lock out the wrong buzzer
+    locked_.set(selected_);
+
+    // Check if all buzzers are now locked
+    if (locked_.all()) {
+      debug("All buzzers locked out, resetting to READY");
+      state_ = STATE_READY;
+      selected_ = 0;
+      locked_.clear();
+    } else {
+      // Enter partial lockout state
+      state_ = STATE_PARTIAL_LOCKOUT;
+      selected_ = 0; // Clear selection so another buzzer can try
+    }
+
+    report("WRONG");
+
+    publishLeds();
+  }
+
+  void reset() {
+    debug("FULL RESET - clearing all state");
+
+    // Reset everything, including a press round still being arbitrated
+    arbiter_.cancel();
+    state_ = STATE_READY;
+    selected_ = 0;
+    locked_.clear();
+
+    report("RESET");
+
+    // All LEDs on
+    publishLeds();
+  }
+
+  // Send the full state to one node (reconnect / state request)
+  void syncNode(uint8_t nodeId) {
+    if (nodeId < 1 || nodeId > N) return;
+
+    StateSyncMessage msg = stateSync(nodeId);
+    transport_.sendStateSync(nodeId, msg);
+
+    debug("STATE_SYNC:%u (state=%d, selected=%u, locked=0x%llX)", nodeId,
+          state_, selected_, (unsigned long long)msg.locked);
+  }
+
+  // Resume a saved game (controller boot, before the first publishLeds()).
+  // Returns false and changes nothing if the snapshot is not a valid state.
+  bool restore(const GameSnapshot& snapshot) {
+    NodeSet<N> locked = NodeSet<N>::fromMask(snapshot.locked);
+    bool valid;
+    switch (snapshot.state) {
+    case STATE_READY:
+      valid = snapshot.selected == 0 && snapshot.locked == 0;
+      break;
+    case STATE_LOCKED:
+      // A locked-out buzzer can never have been selected
+      valid = snapshot.selected >= 1 && snapshot.selected <= N &&
+              !locked.test(snapshot.selected);
+      break;
+    case STATE_PARTIAL_LOCKOUT:
+      valid = snapshot.selected == 0 && snapshot.locked != 0;
+      break;
+    default:
+      valid = false;
+    }
+    if (!valid || locked.toMask() != snapshot.locked || locked.all()) return false;
+
+    arbiter_.cancel();
+    state_ = (GameState)snapshot.state;
+    selected_ = snapshot.selected;
+    locked_ = locked;
+    ledFrame_.seq = snapshot.ledSeq;
+    debug("Restored state=%d selected=%u locked=0x%llX", state_, selected_,
+          (unsigned long long)snapshot.locked);
+    return true;
+  }
+
+  // Re-encode the LED frame for the current state and publish it
+  void publishLeds() {
+    ledFrame_.node_id = 0;
+    ledFrame_.msg_type = MSG_LED_STATE;
+    ledFrame_.seq++;
+    ledFrame_.epoch = epoch_;
+    ledFrame_.node_count = N;
+    for (uint8_t i = 1; i <= N; i++) {
+      setNodeLED(ledFrame_, i, ledStateFor(i));
+    }
+    transport_.publishLedState(ledFrame_);
+  }
+
+  // ==========================================================================
+  // Encoding
+  // ==========================================================================
+
+  LEDState ledStateFor(uint8_t nodeId) const {
+    if (state_ == STATE_READY) {
+      // All LEDs on in ready state
+      return LED_ON;
+    } else if (state_ == STATE_LOCKED) {
+      // Selected buzzer blinks, others off
+      return nodeId == selected_ ? LED_BLINK : LED_OFF;
+    }
+    // PARTIAL_LOCKOUT: selected buzzer blinks, locked buzzers off, active on
+    if (nodeId == selected_) {
+      return LED_BLINK;
+    }
+    return locked_.test(nodeId) ? LED_OFF : LED_ON;
+  }
+
+  StateSyncMessage stateSync(uint8_t nodeId) const {
+    StateSyncMessage msg;
+    msg.node_id = nodeId;
+    msg.msg_type = MSG_STATE_SYNC;
+    msg.selected = selected_;
+    msg.partial_lockout = state_ == STATE_PARTIAL_LOCKOUT ? 1 : 0;
+    msg.node_count = N;
+    msg.led_seq = ledFrame_.seq;
+    msg.epoch = epoch_;
+    msg.locked = locked_.toMask();
+    return msg;
+  }
+
+  GameSnapshot snapshot() const {
+    GameSnapshot snapshot;
+    snapshot.state = (uint8_t)state_;
+    snapshot.selected = selected_;
+    snapshot.ledSeq = ledFrame_.seq;
+    snapshot.locked = locked_.toMask();
+    return snapshot;
+  }
+
+  // Last published LED frame (msg_type 0 until the first publish)
+  const LedStateMessage& ledFrame() const { return ledFrame_; }
+
+  // ==========================================================================
+  // State
+  // ==========================================================================
+
+  GameState state() const { return state_; }
+  uint8_t selected() const { return selected_; } // 1-N, or 0 if none
+  const NodeSet<N>& locked() const { return locked_; }
+  uint64_t lastPressTimeUs() const { return lastPressTimeUs_; }
+  uint32_t epoch() const { return epoch_; }
+  uint16_t ledSeq() const { return ledFrame_.seq; }
+  PressArbiter<N>& arbiter() { return arbiter_; }
+  const PressArbiter<N>& arbiter() const { return arbiter_; }
+
+private:
+  // Lock in the winning buzzer. marginUs is the gap to the runner-up press
+  // (-1 if nobody else pressed within the arbitration window).
+  void lockIn(uint8_t nodeId, uint64_t pressTimeUs, int64_t marginUs) {
+    selected_ = nodeId;
+    state_ = STATE_LOCKED;
+    lastPressTimeUs_ = pressTimeUs;
+
+    debug("Buzzer %u pressed and locked in", nodeId);
+    output_.buzzed(nodeId, pressTimeUs, marginUs);
+
+    if (marginUs >= 0) {
+      report("BUZZ %u MARGIN_US:%lld", nodeId, (long long)marginUs);
+    } else {
+      report("BUZZ %u", nodeId);
+    }
+
+    // Update LEDs: selected blinks, others off
+    publishLeds();
+  }
+
+  __attribute__((format(printf, 2, 3))) void report(const char* fmt, ...) {
+    char line[LINE_LENGTH];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    output_.report(line);
+  }
+
+  __attribute__((format(printf, 2, 3))) void debug(const char* fmt, ...) {
+    if (!output_.debugEnabled()) return;
+    char line[LINE_LENGTH];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    output_.debug(line);
+  }
+
+  GameClock& clock_;
+  GameTransport& transport_;
+  GameOutput& output_;
+  PressArbiter<N> arbiter_;
+
+  GameState state_;
+  uint8_t selected_;         // 1-N, or 0 if none
+  NodeSet<N> locked_;        // Locked-out buzzers (bit 0 = buzzer 1)
+  uint64_t lastPressTimeUs_; // Press edge time in controller time base (µs)
+  uint32_t epoch_;           // Controller boot id (state version, with the LED seq)
+  LedStateMessage ledFrame_; // Re-sent by the firmware for repair
+};
+
+#endif // GAME_CORE_H
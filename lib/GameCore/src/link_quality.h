@@ -0,0 +1,137 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <math.h>
+#include <stdint.h>
+
+// ============================================================================
+// LINK QUALITY (per-node heartbeat loss, RSSI and adaptive timeout)
+// ============================================================================
+//
+// Every heartbeat the controller sends is one delivery trial: it either gets
+// a status reply (the reply echoes the heartbeat's t1) or the next heartbeat
+// is sent while it is still unanswered. Loss and RSSI are smoothed with the
+// same 1/8 gain as the RTT estimate in reliable_link.h:
+//
+//   loss = 7/8 loss + 1/8 (0 if answered, 1 if lost)
+//   rssi = 7/8 rssi + 1/8 reported RSSI
+//
+// A node is declared disconnected after it has been silent for
+//
+//   timeout = k * heartbeat interval + TIMEOUT_GRACE_MS
+//
+// where k is the smallest number of consecutive lost heartbeats whose chance
+// (loss^k) is below FALSE_TIMEOUT_PROBABILITY, clamped to
+// [MIN_MISSES, MAX_MISSES]. A clean link times out as fast as the old fixed
+// 5s timeout; a lossy one gets more slack instead of flapping.
+//
+// This class only keeps time and counts; the caller does the sending.
+
+class LinkQuality {
+public:
+  static const uint8_t MIN_MISSES = 2;
+  static const uint8_t MAX_MISSES = 6;
+  static const uint32_t TIMEOUT_GRACE_MS = 1000; // Reply latency, tick jitter
+  static constexpr float FALSE_TIMEOUT_PROBABILITY = 0.001f;
+
+  LinkQuality() { reset(); }
+
+  // Forget the estimates and counters
+  void reset() {
+    awaiting_ = false;
+    t1Us_ = 0;
+    hasRssi_ = false;
+    lastRssi_ = 0;
+    rssi_ = 0.0f;
+    loss_ = 0.0f;
+    suppressedRun_ = 0;
+    sent_ = 0;
+    replies_ = 0;
+    lost_ = 0;
+    suppressed_ = 0;
+  }
+
+  // A heartbeat with this t1 is being sent. Returns its number (1, 2, ...),
+  // which the node uses to count heartbeats it missed. Loss is only sampled
+  // while the node is connected: heartbeats sent while it is away say
+  // nothing about the link.
+  uint32_t heartbeatSent(int64_t t1Us, bool connected) {
+    if (awaiting_) sampleLoss(true);
+    awaiting_ = connected;
+    t1Us_ = t1Us;
+    suppressedRun_ = 0;
+    return ++sent_;
+  }
+
+  // The heartbeat was skipped because other traffic proved liveness
+  void heartbeatSuppressed() {
+    suppressedRun_++;
+    suppressed_++;
+  }
+
+  // Status reply for the heartbeat sent at t1. rssi 0 = not measured.
+  // Returns false for a late reply to an older heartbeat (already counted lost).
+  bool onReply(int64_t t1Us, int8_t rssi) {
+    if (!awaiting_ || t1Us != t1Us_) return false;
+    awaiting_ = false;
+    replies_++;
+    sampleLoss(false);
+    if (rssi != 0) sampleRssi(rssi);
+    return true;
+  }
+
+  uint32_t timeoutMs(uint32_t heartbeatIntervalMs) const {
+    return missesBeforeTimeout() * heartbeatIntervalMs + TIMEOUT_GRACE_MS;
+  }
+
+  uint8_t missesBeforeTimeout() const {
+    if (loss_ <= 0.0f) return MIN_MISSES;
+    if (loss_ >= 1.0f) return MAX_MISSES;
+    float k = ceilf(logf(FALSE_TIMEOUT_PROBABILITY) / logf(loss_));
+    if (k < MIN_MISSES) return MIN_MISSES;
+    if (k > MAX_MISSES) return MAX_MISSES;
+    return (uint8_t)k;
+  }
+
+  float lossRate() const { return loss_; }
+  bool hasRssi() const { return hasRssi_; }
+  int8_t lastRssi() const { return lastRssi_; }
+  float rssiAverage() const { return rssi_; }
+  uint8_t suppressedRun() const { return suppressedRun_; }
+
+  uint32_t sent() const { return sent_; }
+  uint32_t replies() const { return replies_; }
+  uint32_t lost() const { return lost_; }
+  uint32_t suppressed() const { return suppressed_; }
+
+private:
+  void sampleLoss(bool lost) {
+    if (lost) lost_++;
+    loss_ += ((lost ? 1.0f : 0.0f) - loss_) / 8.0f;
+  }
+
+  void sampleRssi(int8_t rssi) {
+    lastRssi_ = rssi;
+    if (!hasRssi_) {
+      rssi_ = rssi;
+      hasRssi_ = true;
+    } else {
+      rssi_ += (rssi - rssi_) / 8.0f;
+    }
+  }
+
+  bool awaiting_;        // Latest heartbeat not answered yet
+  int64_t t1Us_;         // Its send time (matched against the reply's t1)
+  bool hasRssi_;
+  int8_t lastRssi_;
+  float rssi_;           // EWMA, dBm
+  float loss_;           // EWMA of heartbeat loss, 0..1
+  uint8_t suppressedRun_; // Heartbeats skipped in a row
+
+  uint32_t sent_;
+  uint32_t replies_;
+  uint32_t lost_;
+  uint32_t suppressed_;
+};
+
+#endif // LINK_QUALITY_H
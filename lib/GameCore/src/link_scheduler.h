@@ -0,0 +1,194 @@
+#ifndef LINK_SCHEDULER_H
+#define LINK_SCHEDULER_H
+
+#include <stdint.h>
+#include "protocol.h"
+#include "node_set.h"
+#include "game_core.h"
+#include "link_quality.h"
+#include "reliable_link.h"
+
+// ============================================================================
+// LINK SCHEDULER (controller side: heartbeats and LED delivery per node)
+// ============================================================================
+//
+// Which node gets a heartbeat each round, and which gets the current LED
+// frame again because its ACK is overdue. Per node it keeps the delivery
+// state (ReliableLink), the heartbeat loss estimate (LinkQuality), whether
+// the node is connected, and whether it ACKed anything since the last round.
+// No radio here: controller.cpp and the simulator send through
+// LinkTransport, so both run the same suppression and retransmit rules.
+//
+// Not thread-safe: one task (the controller's game task) drives it.
+
+class LinkTransport {
+public:
+  virtual ~LinkTransport() {}
+  // Unicast heartbeat (msg.node_id addressed)
+  virtual void sendHeartbeat(const HeartbeatMessage& msg) = 0;
+  // Repeat of the current LED frame to every node, after each heartbeat round
+  virtual void broadcastLedFrame(const LedStateMessage& frame) = 0;
+  // Retransmit to one node whose ACK is overdue
+  virtual void resendLedFrame(uint8_t nodeId, const LedStateMessage& frame) = 0;
+  // The node never acknowledged seq: delivery stops until the next change
+  virtual void deliveryFailed(uint8_t /* nodeId */, uint16_t /* seq */) {}
+};
+
+template <uint8_t N> class LinkScheduler {
+  static_assert(N >= 1 && N <= MAX_NODES, "node count must be between 1 and MAX_NODES");
+
+public:
+  // maxSuppressed: heartbeats skipped in a row at most, so clock sync and
+  // node status stay fresh
+  LinkScheduler(GameClock& clock, LinkTransport& transport, uint8_t maxSuppressed)
+      : clock_(clock), transport_(transport), maxSuppressed_(maxSuppressed) {}
+
+  // ==========================================================================
+  // Node state (connection monitoring is the caller's)
+  // ==========================================================================
+
+  // A node that drops out stops receiving retransmits; it gets a state
+  // sync when it reconnects
+  void setConnected(uint8_t nodeId, bool connected) {
+    if (nodeId < 1 || nodeId > N) return;
+    if (connected) {
+      connected_.set(nodeId);
+    } else {
+      connected_.reset(nodeId);
+      links_[nodeId - 1].cancel();
+    }
+  }
+
+  // Heartbeat reply: samples the loss and RSSI, and the node's status flags
+  // decide whether its heartbeats may be skipped. Returns false if the reply
+  // was stale or repeated.
+  bool onReply(uint8_t nodeId, int64_t t1Us, int8_t rssi, uint8_t flags) {
+    if (nodeId < 1 || nodeId > N) return false;
+    if (flags & NODE_STATUS_LOW_POWER) {
+      lowPower_.set(nodeId);
+    } else {
+      lowPower_.reset(nodeId);
+    }
+    return quality_[nodeId - 1].onReply(t1Us, rssi);
+  }
+
+  // LED state or state sync acknowledged (cumulative)
+  void onAck(uint8_t nodeId, uint16_t seq, int64_t rxTimeUs) {
+    if (nodeId < 1 || nodeId > N) return;
+    ackedSinceRound_.set(nodeId);
+    links_[nodeId - 1].onAck(seq, rxTimeUs);
+  }
+
+  // ==========================================================================
+  // LED delivery
+  // ==========================================================================
+
+  // A new LED frame went to every node: each connected node must
+  // acknowledge it, the others are not waited for
+  void published(const LedStateMessage& frame) {
+    int64_t nowUs = clock_.nowUs();
+    for (uint8_t i = 1; i <= N; i++) {
+      if (connected_.test(i)) {
+        links_[i - 1].track(frame.seq, nowUs);
+      } else {
+        links_[i - 1].cancel();
+      }
+    }
+  }
+
+  // A state sync for seq went to one node. If its ACK is lost the node gets
+  // the current LED frame by retransmission, which carries the same state.
+  void synced(uint8_t nodeId, uint16_t seq) {
+    if (nodeId < 1 || nodeId > N) return;
+    links_[nodeId - 1].track(seq, clock_.nowUs());
+  }
+
+  // Call regularly: resend the current LED frame to nodes whose ACK is
+  // overdue. Only the newest state matters, so older frames are never resent.
+  void retransmit(const LedStateMessage& frame) {
+    int64_t nowUs = clock_.nowUs();
+    for (uint8_t i = 1; i <= N; i++) {
+      ReliableLink& link = links_[i - 1];
+      if (!link.isDue(nowUs)) continue;
+
+      if (link.retransmitted(nowUs)) {
+        transport_.resendLedFrame(i, frame);
+      } else {
+        transport_.deliveryFailed(i, link.pendingSeq());
+      }
+    }
+  }
+
+  // True while some node's ACK is awaited (the caller should keep polling)
+  bool isPending() const {
+    for (uint8_t i = 0; i < N; i++) {
+      if (links_[i].isPending()) return true;
+    }
+    return false;
+  }
+
+  // ==========================================================================
+  // Heartbeats
+  // ==========================================================================
+
+  // One heartbeat round (every heartbeat interval): a heartbeat to each node
+  // that needs one, then the current LED frame again, so a lost broadcast
+  // is repaired within one interval. The heartbeat carries the state
+  // version (epoch + LED sequence); nodes holding an older one pull a sync.
+  void heartbeat(const LedStateMessage& frame) {
+    HeartbeatMessage msg;
+    msg.msg_type = MSG_HEARTBEAT;
+    msg.led_seq = frame.seq;
+    msg.epoch = frame.epoch;
+
+    // time_us is t1 of the clock sync exchange, so take it per send
+    for (uint8_t i = 1; i <= N; i++) {
+      LinkQuality& quality = quality_[i - 1];
+      if (heartbeatRedundant(i)) {
+        quality.heartbeatSuppressed();
+        continue;
+      }
+      msg.node_id = i;
+      msg.time_us = (uint64_t)clock_.nowUs();
+      msg.number = quality.heartbeatSent((int64_t)msg.time_us, connected_.test(i));
+      transport_.sendHeartbeat(msg);
+    }
+    ackedSinceRound_.clear();
+
+    if (frame.msg_type == MSG_LED_STATE) {
+      transport_.broadcastLedFrame(frame);
+    }
+  }
+
+  // A node that ACKed one of our frames since the last heartbeat round has
+  // proven the link both ways, so its heartbeat can be skipped to save
+  // airtime. Low-power nodes are never skipped (they time their radio
+  // windows by the heartbeat), and at most maxSuppressed in a row are.
+  bool heartbeatRedundant(uint8_t nodeId) const {
+    if (nodeId < 1 || nodeId > N) return false;
+    if (!connected_.test(nodeId) || lowPower_.test(nodeId)) return false;
+    if (quality_[nodeId - 1].suppressedRun() >= maxSuppressed_) return false;
+    return ackedSinceRound_.test(nodeId);
+  }
+
+  // ==========================================================================
+  // State
+  // ==========================================================================
+
+  bool isConnected(uint8_t nodeId) const { return connected_.test(nodeId); }
+  const ReliableLink& delivery(uint8_t nodeId) const { return links_[nodeId - 1]; }
+  const LinkQuality& quality(uint8_t nodeId) const { return quality_[nodeId - 1]; }
+
+private:
+  GameClock& clock_;
+  LinkTransport& transport_;
+  const uint8_t maxSuppressed_;
+
+  NodeSet<N> connected_;
+  NodeSet<N> lowPower_;         // Last status reply had NODE_STATUS_LOW_POWER
+  NodeSet<N> ackedSinceRound_;  // Any ACK since the last heartbeat round
+  ReliableLink links_[N];       // LED state delivery
+  LinkQuality quality_[N];      // Heartbeat loss, RSSI, adaptive timeout
+};
+
+#endif // LINK_SCHEDULER_H
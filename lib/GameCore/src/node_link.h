@@ -0,0 +1,283 @@
+#ifndef NODE_LINK_H
+#define NODE_LINK_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "protocol.h"
+#include "game_core.h"
+
+// ============================================================================
+// NODE LINK (buzzer node side of the controller protocol)
+// ============================================================================
+//
+// What a buzzer node does with the frames the controller sends it: the
+// state version it holds (controller epoch + LED sequence), LED frame dedup
+// and ACKs, state sync decoding, heartbeat replies and gap counting, and
+// pulling a state sync after (re)connecting or falling behind. No radio or
+// LED driver here: buzzer_node.cpp and the simulator plug theirs in through
+// NodeLinkIO, so both run the same protocol code.
+//
+// Not thread-safe: one task (the node's loop()) drives it.
+
+class NodeLinkIO {
+public:
+  virtual ~NodeLinkIO() {}
+  virtual void sendToController(const void* data, size_t len) = 0;
+  // Switch the LED. rxTimeUs: receive time of the frame that changed it,
+  // -1 for a change of the node's own (disconnect)
+  virtual void showLed(LEDState state, int64_t rxTimeUs) = 0;
+  // A heartbeat for this node arrived: fill in the status fields of the
+  // reply (rssi, flags, battery_mv)
+  virtual void heartbeat(TimeSyncMessage& /* reply */) {}
+  // Connection and state changes
+  virtual void log(const char* line) = 0;
+  // False skips formatting log lines altogether
+  virtual bool logEnabled() const { return true; }
+};
+
+class NodeLink {
+public:
+  static const uint8_t LINE_LENGTH = 121; // Longest log line + NUL
+
+  // clock: the node's own time base (t2/t3 of the clock sync exchange)
+  NodeLink(uint8_t nodeId, GameClock& clock, NodeLinkIO& io)
+      : nodeId_(nodeId), clock_(clock), io_(io), connected_(false),
+        haveEpoch_(false), epoch_(0), haveLedSeq_(false), ledSeq_(0),
+        haveHeartbeatNum_(false), heartbeatNum_(0), heartbeatGaps_(0),
+        led_(LED_FADE) {}
+
+  // A frame from the controller, received at rxTimeUs (node time). Returns
+  // false if it is not one the controller sends to nodes.
+  bool onFrame(const uint8_t* data, size_t len, int64_t rxTimeUs) {
+    if (len < 2) return false;
+
+    if (len == sizeof(LedStateMessage) && data[1] == MSG_LED_STATE) {
+      LedStateMessage msg;
+      memcpy(&msg, data, sizeof(msg));
+      onLedState(msg, rxTimeUs);
+      return true;
+    }
+
+    // Frames for nodes without a controller peer slot arrive by broadcast:
+    // check node_id.
+    if (len == sizeof(StateSyncMessage) && data[1] == MSG_STATE_SYNC) {
+      StateSyncMessage msg;
+      memcpy(&msg, data, sizeof(msg));
+      if (msg.node_id == nodeId_) onStateSync(msg, rxTimeUs);
+      return true;
+    }
+
+    if (len == sizeof(HeartbeatMessage) && data[1] == MSG_HEARTBEAT) {
+      HeartbeatMessage msg;
+      memcpy(&msg, data, sizeof(msg));
+      if (msg.node_id == nodeId_) onHeartbeat(msg, rxTimeUs);
+      return true;
+    }
+    return false;
+  }
+
+  // The controller went quiet: show the breathing fade until a heartbeat
+  // reconnects
+  void disconnect() {
+    connected_ = false;
+    haveLedSeq_ = false; // Controller may restart its sequence numbers
+    haveHeartbeatNum_ = false;
+    show(LED_FADE, -1);
+  }
+
+  // A node's LED for the game state in a state sync. reason (optional) says
+  // which rule picked it, for logging.
+  static LEDState stateSyncLed(const StateSyncMessage& msg, uint8_t nodeId,
+                               const char** reason = nullptr) {
+    bool isLocked = (msg.locked >> (nodeId - 1)) & 1;
+    const char* why;
+    LEDState state;
+    if (msg.selected == nodeId) {
+      state = LED_BLINK;
+      why = "selected";
+    } else if (msg.partial_lockout) {
+      // In PARTIAL_LOCKOUT: only explicitly locked buzzers turn OFF
+      state = isLocked ? LED_OFF : LED_ON;
+      why = isLocked ? "locked in PARTIAL_LOCKOUT" : "not locked in PARTIAL_LOCKOUT";
+    } else if (msg.selected == 0) {
+      // STATE_READY: no buzzer selected, all LEDs ON
+      state = LED_ON;
+      why = "ready state";
+    } else {
+      // In LOCKED state: all non-selected buzzers turn OFF
+      state = LED_OFF;
+      why = "not selected in LOCKED";
+    }
+    if (reason) *reason = why;
+    return state;
+  }
+
+  bool isConnected() const { return connected_; }
+  LEDState led() const { return led_; }
+  bool hasEpoch() const { return haveEpoch_; }
+  uint32_t epoch() const { return epoch_; }
+  bool hasLedSeq() const { return haveLedSeq_; }
+  uint16_t ledSeq() const { return ledSeq_; }    // Newest LED sequence applied
+  uint32_t heartbeatGaps() const { return heartbeatGaps_; } // Missed while connected
+
+private:
+  // Broadcast (or retransmitted unicast) LED frame: pick out our own slot,
+  // skip repeats and stale frames
+  void onLedState(const LedStateMessage& msg, int64_t rxTimeUs) {
+    // While disconnected the LED shows the fade until a heartbeat arrives
+    if (!connected_ || nodeId_ > msg.node_count) return;
+    adoptEpoch(msg.epoch);
+
+    if (!haveLedSeq_ || !isStaleLedSeq(msg.seq, ledSeq_)) {
+      haveLedSeq_ = true;
+      ledSeq_ = msg.seq;
+
+      // Only react to a change, so an update for another node does not
+      // restart this node's blink pattern
+      LEDState state = getNodeLED(msg, nodeId_);
+      if (state != led_) {
+        show(state, rxTimeUs);
+        log("LED state received: %u", state);
+      }
+    }
+
+    // Repeats are acknowledged too: our previous ACK may have been lost
+    sendAck(MSG_LED_STATE);
+  }
+
+  // Full game state after reconnecting: derive this node's LED from it
+  void onStateSync(const StateSyncMessage& msg, int64_t rxTimeUs) {
+    adoptEpoch(msg.epoch);
+
+    // A retransmitted sync we already applied: only acknowledge it again
+    if (haveLedSeq_ && isStaleLedSeq(msg.led_seq, ledSeq_)) {
+      sendAck(MSG_STATE_SYNC);
+      return;
+    }
+    haveLedSeq_ = true;
+    ledSeq_ = msg.led_seq;
+
+    const char* reason;
+    LEDState state = stateSyncLed(msg, nodeId_, &reason);
+    log("State sync: locked=0x%llX selected=%u mode=%s -> LED %u (%s)",
+        (unsigned long long)msg.locked, msg.selected,
+        msg.partial_lockout ? "PARTIAL_LOCKOUT" : "LOCKED", state, reason);
+    show(state, rxTimeUs); // Even if unchanged: a blink restarts from the fast phase
+    sendAck(MSG_STATE_SYNC);
+  }
+
+  // Heartbeat: answer it, (re)connect, and pull a state sync if the
+  // controller announces a state version we do not hold
+  void onHeartbeat(const HeartbeatMessage& msg, int64_t rxTimeUs) {
+    bool wasConnected = connected_;
+
+    // Numbers restart with the controller (new epoch); only count forward jumps
+    if (wasConnected && haveHeartbeatNum_ && haveEpoch_ && msg.epoch == epoch_ &&
+        msg.number > heartbeatNum_) {
+      heartbeatGaps_ += msg.number - heartbeatNum_ - 1;
+    }
+    haveHeartbeatNum_ = true;
+    heartbeatNum_ = msg.number;
+
+    // Answer with our receive/send times so the controller can map our
+    // clock into its own time base, and with our view of the link
+    TimeSyncMessage sync;
+    memset(&sync, 0, sizeof(sync));
+    sync.node_id = nodeId_;
+    sync.msg_type = MSG_TIME_SYNC;
+    sync.hb_gaps = heartbeatGaps_ > 0xFFFF ? 0xFFFF : (uint16_t)heartbeatGaps_;
+    io_.heartbeat(sync);
+    sync.t1_us = msg.time_us;
+    sync.t2_us = (uint64_t)rxTimeUs;
+    sync.t3_us = (uint64_t)clock_.nowUs();
+    io_.sendToController(&sync, sizeof(sync));
+
+    if (!wasConnected) {
+      // We just reconnected
+      log("Connected to controller, requesting state sync");
+      connected_ = true;
+      requestStateSync();
+    } else if (stateBehind(msg)) {
+      // Missed an LED change (or the controller restarted): pull the state
+      // now rather than at the next LED change
+      log("State version %08X/%u behind controller %08X/%u, requesting sync",
+          (unsigned)epoch_, ledSeq_, (unsigned)msg.epoch, msg.led_seq);
+      requestStateSync();
+    }
+  }
+
+  // A different epoch means the controller restarted and its LED sequence
+  // numbers started over, so the one we hold means nothing any more
+  void adoptEpoch(uint32_t epoch) {
+    if (haveEpoch_ && epoch == epoch_) return;
+    if (haveEpoch_) {
+      log("Controller epoch changed (%08X -> %08X)", (unsigned)epoch_, (unsigned)epoch);
+    }
+    haveEpoch_ = true;
+    epoch_ = epoch;
+    haveLedSeq_ = false;
+  }
+
+  // True if the heartbeat announces a state version newer than ours
+  bool stateBehind(const HeartbeatMessage& msg) const {
+    if (!haveEpoch_ || msg.epoch != epoch_ || !haveLedSeq_) return true;
+    return isNewerLedSeq(msg.led_seq, ledSeq_);
+  }
+
+  // Tell the controller which LED state sequence we hold (cumulative)
+  void sendAck(uint8_t ackedType) {
+    AckMessage ack;
+    memset(&ack, 0, sizeof(ack));
+    ack.node_id = nodeId_;
+    ack.msg_type = MSG_ACK;
+    ack.acked_type = ackedType;
+    ack.seq = ledSeq_;
+    io_.sendToController(&ack, sizeof(ack));
+  }
+
+  // Ask the controller for a state sync (full state for this node)
+  void requestStateSync() {
+    int64_t nowUs = clock_.nowUs();
+    BuzzerMessage request;
+    memset(&request, 0, sizeof(request));
+    request.node_id = nodeId_;
+    request.msg_type = MSG_STATE_REQUEST;
+    request.timestamp = (uint32_t)(nowUs / 1000);
+    request.time_us = (uint64_t)nowUs;
+    io_.sendToController(&request, sizeof(request));
+  }
+
+  void show(LEDState state, int64_t rxTimeUs) {
+    led_ = state;
+    io_.showLed(state, rxTimeUs);
+  }
+
+  __attribute__((format(printf, 2, 3))) void log(const char* fmt, ...) {
+    if (!io_.logEnabled()) return;
+    char line[LINE_LENGTH];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    io_.log(line);
+  }
+
+  const uint8_t nodeId_;
+  GameClock& clock_;
+  NodeLinkIO& io_;
+
+  bool connected_;
+  bool haveEpoch_;           // State version held: controller epoch + last
+  uint32_t epoch_;           // LED sequence applied (the sequence is cleared
+  bool haveLedSeq_;          // on disconnect and when the epoch changes)
+  uint16_t ledSeq_;
+  bool haveHeartbeatNum_;
+  uint32_t heartbeatNum_;
+  uint32_t heartbeatGaps_;   // Missed while connected, since boot
+  LEDState led_;             // Shown now (LED_FADE while disconnected)
+};
+
+#endif // NODE_LINK_H
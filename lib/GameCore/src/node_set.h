@@ -0,0 +1,70 @@
+#ifndef NODE_SET_H
+#define NODE_SET_H
+
+#include <stdint.h>
+#include <type_traits>
+
+// ============================================================================
+// NODE SET (compile-time sized bitset of buzzer node ids)
+// ============================================================================
+//
+// One bit per node, node 1 = bit 0. The storage word is the smallest unsigned
+// type that holds N bits, so every operation is a single mask/compare on the
+// ESP32 (two words at most for 33-64 nodes) no matter how many nodes there
+// are. The 64-bit wire form (toMask/fromMask) is shared by every node count.
+
+template <uint8_t N> class NodeSet {
+  static_assert(N >= 1 && N <= 64, "NodeSet supports 1-64 nodes");
+
+public:
+  typedef typename std::conditional<
+      (N <= 8), uint8_t,
+      typename std::conditional<
+          (N <= 16), uint16_t,
+          typename std::conditional<(N <= 32), uint32_t, uint64_t>::type>::type>::type
+      Word;
+
+  static constexpr uint8_t SIZE = N;
+  static constexpr Word ALL =
+      N == sizeof(Word) * 8 ? (Word)~(Word)0 : (Word)(((Word)1 << N) - 1);
+
+  constexpr NodeSet() : bits_(0) {}
+
+  // nodeId is 1-based; out-of-range ids are ignored / reported as absent
+  void set(uint8_t nodeId) {
+    if (valid(nodeId)) bits_ |= bit(nodeId);
+  }
+  void reset(uint8_t nodeId) {
+    if (valid(nodeId)) bits_ &= (Word)~bit(nodeId);
+  }
+  bool test(uint8_t nodeId) const {
+    return valid(nodeId) && (bits_ & bit(nodeId)) != 0;
+  }
+  void clear() { bits_ = 0; }
+
+  bool all() const { return bits_ == ALL; }
+  bool none() const { return bits_ == 0; }
+  uint8_t count() const { return (uint8_t)__builtin_popcountll(bits_); }
+
+  uint64_t toMask() const { return bits_; }
+  static NodeSet fromMask(uint64_t mask) {
+    NodeSet set;
+    set.bits_ = (Word)(mask & ALL);
+    return set;
+  }
+
+  bool operator==(const NodeSet &other) const { return bits_ == other.bits_; }
+  bool operator!=(const NodeSet &other) const { return bits_ != other.bits_; }
+
+private:
+  static constexpr bool valid(uint8_t nodeId) {
+    return nodeId >= 1 && nodeId <= N;
+  }
+  static constexpr Word bit(uint8_t nodeId) {
+    return (Word)((Word)1 << (nodeId - 1));
+  }
+
+  Word bits_;
+};
+
+#endif // NODE_SET_H
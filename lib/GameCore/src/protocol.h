@@ -0,0 +1,146 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Largest node count the wire formats can carry (64-bit masks, 2-bit LED slots)
+#define MAX_NODES 64
+
+// Message types
+enum MessageType : uint8_t {
+  MSG_BUTTON_PRESS = 1,
+  MSG_LED_COMMAND = 2,  // Retired (unsequenced LED state for one node); not reused
+  MSG_ACK = 3,          // Node confirms LED state / state sync (AckMessage)
+  MSG_HEARTBEAT = 4,
+  MSG_STATE_REQUEST = 5,
+  MSG_STATE_SYNC = 6,
+  MSG_TIME_SYNC = 7,
+  MSG_LED_STATE = 8
+};
+
+// LED states
+enum LEDState : uint8_t {
+  LED_OFF = 0,    // LED off (locked out or other buzzer selected)
+  LED_ON = 1,     // LED solid on (ready state, full brightness)
+  LED_BLINK = 2,  // Two-stage blink: 5Hz fast for 3s, then 2Hz slow (selected buzzer)
+  LED_FADE = 3    // Breathing fade effect for disconnected state (smooth in/out)
+};
+
+// ESP-NOW message structure
+struct BuzzerMessage {
+  uint8_t node_id;      // 1-MAX_NODES for buzzer nodes, 0 for the controller
+  uint8_t msg_type;     // MessageType enum
+  uint8_t value;        // LED state or press count
+  uint32_t timestamp;   // millis() on the sender
+  uint32_t press_id;    // MSG_BUTTON_PRESS: per-node id, +1 per press (retries
+                        // reuse it); random start at boot.
+                        // 0 otherwise.
+  uint64_t time_us;     // esp_timer_get_time() of the event on the sender
+                        // For MSG_BUTTON_PRESS: GPIO edge time captured in the ISR
+};
+
+// Heartbeat (Main -> each Buzzer, unicast). Carries the controller's state
+// version, epoch + LED sequence: a node that holds an older version (or one
+// from an earlier epoch) pulls a state sync right away instead of waiting
+// for the next LED change.
+struct HeartbeatMessage {
+  uint8_t node_id;      // Addressed node (others drop it)
+  uint8_t msg_type;     // MSG_HEARTBEAT
+  uint16_t led_seq;     // Current LED state sequence
+  uint32_t epoch;       // Controller boot id (LED sequence numbers restart with it)
+  uint32_t number;      // Per-node heartbeat number (+1 per heartbeat sent to
+                        // this node, so it can count the ones it missed)
+  uint64_t time_us;     // Controller send time (t1 of the clock sync exchange)
+};
+
+// Node status flags (TimeSyncMessage.flags)
+#define NODE_STATUS_LOW_POWER 0x01 // Node sleeps between heartbeats: always send them
+
+// Heartbeat reply (Buzzer -> Main): the timestamps for clock synchronization
+// plus the node's view of the link. See clock_sync.h for how the four
+// timestamps are used. t2/t3 count from the node's boot, so t3 is also its
+// uptime. The status fields fill what would otherwise be padding.
+struct TimeSyncMessage {
+  uint8_t node_id;      // 1-MAX_NODES for buzzer nodes
+  uint8_t msg_type;     // MSG_TIME_SYNC
+  int8_t rssi;          // Signal strength of the controller at the node (dBm, 0 = unknown)
+  uint8_t flags;        // NODE_STATUS_* bits
+  uint16_t hb_gaps;     // Heartbeats missed since boot (saturates at 65535)
+  uint16_t battery_mv;  // Battery voltage (0 = not measured)
+  uint64_t t1_us;       // Controller send time, echoed from the heartbeat's time_us
+  uint64_t t2_us;       // Node time when the heartbeat was received
+  uint64_t t3_us;       // Node time when this reply was sent
+};
+
+// LED state of every node in one broadcast frame (Main -> all Buzzers).
+// Each node reads its own 2-bit slot, so all LEDs change on the same frame.
+#define LED_STATE_MAX_NODES MAX_NODES
+#define LED_STATE_STALE_WINDOW 32 // Older seq numbers within this range are stale
+
+struct LedStateMessage {
+  uint8_t node_id;      // 0 (broadcast from controller)
+  uint8_t msg_type;     // MSG_LED_STATE
+  uint16_t seq;         // Increments on every LED state change
+  uint32_t epoch;       // Controller boot id (see HeartbeatMessage)
+  uint8_t node_count;   // Valid slots in leds[]
+  uint8_t leds[LED_STATE_MAX_NODES / 4]; // LEDState, 2 bits per node:
+                                         // node 1 = bits 0-1 of leds[0]
+};
+
+inline LEDState getNodeLED(const LedStateMessage &msg, uint8_t nodeId) {
+  uint8_t slot = nodeId - 1;
+  return (LEDState)((msg.leds[slot >> 2] >> ((slot & 3) * 2)) & 0x03);
+}
+
+inline void setNodeLED(LedStateMessage &msg, uint8_t nodeId, LEDState state) {
+  uint8_t slot = nodeId - 1;
+  uint8_t shift = (slot & 3) * 2;
+  msg.leds[slot >> 2] = (msg.leds[slot >> 2] & ~(0x03 << shift)) | (state << shift);
+}
+
+// True if seq is a repeat or a delayed older frame. Anything further back
+// than the window is taken as a restarted controller and accepted.
+inline bool isStaleLedSeq(uint16_t seq, uint16_t last) {
+  return (uint16_t)(last - seq) < LED_STATE_STALE_WINDOW;
+}
+
+// True if the controller's current seq is newer than the one a node holds
+inline bool isNewerLedSeq(uint16_t current, uint16_t held) {
+  return (int16_t)(current - held) > 0;
+}
+
+// Full game state for one node after it reconnects (Main -> Buzzer)
+struct StateSyncMessage {
+  uint8_t node_id;        // Addressed node
+  uint8_t msg_type;       // MSG_STATE_SYNC
+  uint8_t selected;       // Selected buzzer, 0 = none (READY or PARTIAL_LOCKOUT)
+  uint8_t partial_lockout; // 1 = PARTIAL_LOCKOUT, 0 = READY/LOCKED
+  uint8_t node_count;     // Nodes in the game
+  uint16_t led_seq;       // LED state sequence this sync corresponds to
+  uint32_t epoch;         // Controller boot id (see HeartbeatMessage)
+  uint64_t locked;        // Locked-out nodes: bit 0 = node 1 ... bit 63 = node 64
+};
+
+// Cumulative acknowledgment (Buzzer -> Main): the node holds the LED state
+// with this sequence number (or newer). Sent for every MSG_LED_STATE and
+// MSG_STATE_SYNC received, including repeats, so a lost ACK is recovered by
+// the controller's retransmission.
+struct AckMessage {
+  uint8_t node_id;      // Acknowledging node
+  uint8_t msg_type;     // MSG_ACK
+  uint8_t acked_type;   // MSG_LED_STATE or MSG_STATE_SYNC
+  uint16_t seq;         // Newest LED state sequence applied
+};
+
+// Custom MAC address base
+const uint8_t MAC_BASE[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x00};
+
+// MAC address of a node: MAC_BASE with the node id as the last byte
+// (0 = main controller)
+inline void nodeMAC(uint8_t nodeId, uint8_t mac[6]) {
+  memcpy(mac, MAC_BASE, 6);
+  mac[5] = nodeId;
+}
+
+#endif // PROTOCOL_H
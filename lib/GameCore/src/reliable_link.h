@@ -0,0 +1,152 @@
+#ifndef RELIABLE_LINK_H
+#define RELIABLE_LINK_H
+
+#include <stdint.h>
+
+// ============================================================================
+// RELIABLE DELIVERY (per-peer acknowledgment and retransmit timing)
+// ============================================================================
+//
+// Controller -> node state is idempotent: only the newest sequence number
+// matters, so a peer never has more than one message outstanding. Sending a
+// newer sequence supersedes the pending one, and ACKs are cumulative (an ACK
+// for seq n also confirms everything before it).
+//
+// The retransmit timeout adapts to the peer's measured round trip the way
+// TCP does (RFC 6298):
+//
+//   first sample:  SRTT = R, RTTVAR = R / 2
+//   afterwards:    RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|,  SRTT = 7/8 SRTT + 1/8 R
+//   RTO = SRTT + 4 * RTTVAR, clamped to [MIN_RTO_US, MAX_RTO_US]
+//
+// Round trips are only sampled from messages that were never retransmitted
+// (Karn's rule), and each retransmit doubles the timeout until an ACK arrives.
+// After MAX_RESENDS the message is dropped and counted as a failure.
+//
+// This class only keeps time and counts; the caller does the sending.
+
+class ReliableLink {
+public:
+  static const uint32_t INITIAL_RTO_US = 50000; // Before the first RTT sample
+  static const uint32_t MIN_RTO_US = 5000;      // ESP-NOW round trips are ~1-3ms
+  static const uint32_t MAX_RTO_US = 1000000;   // Cap, including backoff
+  static const uint8_t MAX_RESENDS = 6;
+
+  ReliableLink()
+      : rtoUs_(INITIAL_RTO_US), backoff_(0), srttUs_(0), rttvarUs_(0),
+        hasRtt_(false), pending_(false), seq_(0), sentAtUs_(0), retries_(0),
+        sent_(0), acked_(0), retransmits_(0), failures_(0), lastRttUs_(0) {}
+
+  // A message with this sequence number has just been sent to the peer
+  void track(uint16_t seq, int64_t nowUs) {
+    pending_ = true;
+    seq_ = seq;
+    sentAtUs_ = nowUs;
+    retries_ = 0;
+    sent_++;
+  }
+
+  // Cumulative ACK. Returns true if it confirmed the pending message.
+  bool onAck(uint16_t seq, int64_t nowUs) {
+    if (!pending_ || (int16_t)(seq - seq_) < 0) return false;
+
+    if (retries_ == 0) {
+      sampleRtt((uint32_t)(nowUs - sentAtUs_));
+    }
+    pending_ = false;
+    backoff_ = 0;
+    acked_++;
+    return true;
+  }
+
+  bool isPending() const { return pending_; }
+  uint16_t pendingSeq() const { return seq_; }
+
+  // True once the pending message has waited a full (backed-off) RTO
+  bool isDue(int64_t nowUs) const {
+    return pending_ && (nowUs - sentAtUs_) >= (int64_t)currentRtoUs();
+  }
+
+  // Call after resending the pending message. Returns false (and drops the
+  // message) once the retry budget is exhausted.
+  bool retransmitted(int64_t nowUs) {
+    if (retries_ >= MAX_RESENDS) {
+      pending_ = false;
+      backoff_ = 0;
+      failures_++;
+      return false;
+    }
+    retries_++;
+    retransmits_++;
+    if (backoff_ < 16) backoff_++;
+    sentAtUs_ = nowUs;
+    return true;
+  }
+
+  // Peer went away: stop retrying without counting a failure
+  void cancel() {
+    pending_ = false;
+    backoff_ = 0;
+  }
+
+  uint32_t rtoUs() const { return rtoUs_; }
+  uint32_t currentRtoUs() const {
+    uint64_t rto = (uint64_t)rtoUs_ << backoff_;
+    if (rto > MAX_RTO_US) rto = MAX_RTO_US;
+    return (uint32_t)rto;
+  }
+  uint32_t srttUs() const { return srttUs_; }
+  uint32_t rttvarUs() const { return rttvarUs_; }
+  uint32_t lastRttUs() const { return lastRttUs_; }
+  bool hasRtt() const { return hasRtt_; }
+
+  uint32_t sent() const { return sent_; }
+  uint32_t acked() const { return acked_; }
+  uint32_t retransmits() const { return retransmits_; }
+  uint32_t failures() const { return failures_; }
+
+  void resetStats() {
+    sent_ = 0;
+    acked_ = 0;
+    retransmits_ = 0;
+    failures_ = 0;
+  }
+
+private:
+  void sampleRtt(uint32_t rttUs) {
+    lastRttUs_ = rttUs;
+    if (!hasRtt_) {
+      srttUs_ = rttUs;
+      rttvarUs_ = rttUs / 2;
+      hasRtt_ = true;
+    } else {
+      uint32_t err = srttUs_ > rttUs ? srttUs_ - rttUs : rttUs - srttUs_;
+      rttvarUs_ = (3 * rttvarUs_ + err) / 4;
+      srttUs_ = (7 * srttUs_ + rttUs) / 8;
+    }
+
+    uint32_t rto = srttUs_ + 4 * rttvarUs_;
+    if (rto < MIN_RTO_US) rto = MIN_RTO_US;
+    if (rto > MAX_RTO_US) rto = MAX_RTO_US;
+    rtoUs_ = rto;
+  }
+
+  uint32_t rtoUs_;    // Base timeout from the RTT estimate
+  uint8_t backoff_;   // Doublings applied since the last ACK
+  uint32_t srttUs_;
+  uint32_t rttvarUs_;
+  bool hasRtt_;
+
+  bool pending_;
+  uint16_t seq_;
+  int64_t sentAtUs_;
+  uint8_t retries_;
+
+  uint32_t sent_;
+  uint32_t acked_;
+  uint32_t retransmits_;
+  uint32_t failures_;
+  uint32_t lastRttUs_;
+};
+
+#endif // RELIABLE_LINK_H
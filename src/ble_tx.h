@@ -0,0 +1,116 @@
+#ifndef BLE_TX_H
+#define BLE_TX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// BLE NOTIFICATION BATCHER
+// ============================================================================
+//
+// The Nordic UART TX characteristic is a byte stream: text lines end with
+// '\n' and binary frames end with 0x00, so a client never relies on one
+// notification carrying exactly one message. That lets outbound messages be
+// packed back to back and sent in as few notifications as the negotiated MTU
+// allows, instead of one setValue()/notify() per event.
+//
+// A chunk becomes due when a full MTU payload is pending, or when the oldest
+// pending byte has waited longer than the flush deadline. Messages longer
+// than one payload are simply split across consecutive notifications.
+//
+// Single producer and single consumer in the same task (the controller's
+// I/O task).
+
+template <uint16_t CAPACITY> class BleTxBatcher {
+public:
+  BleTxBatcher(uint16_t payloadLimit, uint32_t deadlineUs)
+      : payloadLimit_(payloadLimit), deadlineUs_(deadlineUs), len_(0),
+        oldestUs_(0), holdUntilUs_(0), messages_(0), notifications_(0),
+        bytes_(0), dropped_(0), maxChunk_(0) {}
+
+  // Usable bytes per notification (negotiated ATT MTU - 3)
+  void setPayloadLimit(uint16_t limit) {
+    if (limit < 1) limit = 1;
+    if (limit > CAPACITY) limit = CAPACITY;
+    payloadLimit_ = limit;
+  }
+  uint16_t payloadLimit() const { return payloadLimit_; }
+  void setDeadlineUs(uint32_t deadlineUs) { deadlineUs_ = deadlineUs; }
+  uint32_t deadlineUs() const { return deadlineUs_; }
+
+  // Queue one complete message (already delimited). All or nothing.
+  bool append(const uint8_t *data, size_t len, int64_t nowUs) {
+    if (len > (size_t)(CAPACITY - len_)) {
+      dropped_++;
+      return false;
+    }
+    if (len_ == 0) oldestUs_ = nowUs;
+    memcpy(&buf_[len_], data, len);
+    len_ += len;
+    messages_++;
+    return true;
+  }
+
+  // Next chunk to notify, if one is due. Call consume() once it has gone out.
+  bool due(int64_t nowUs, const uint8_t *&data, size_t &len) const {
+    if (len_ == 0 || nowUs < holdUntilUs_) return false;
+    if (len_ < payloadLimit_ && (nowUs - oldestUs_) < (int64_t)deadlineUs_) {
+      return false;
+    }
+    data = buf_;
+    len = len_ < payloadLimit_ ? len_ : payloadLimit_;
+    return true;
+  }
+
+  // Remaining bytes keep the age of the oldest message they belong to
+  void consume(size_t len) {
+    if (len > len_) len = len_;
+    memmove(buf_, &buf_[len], len_ - len);
+    len_ -= len;
+    notifications_++;
+    bytes_ += len;
+    if (len > maxChunk_) maxChunk_ = len;
+  }
+
+  // The stack refused the chunk (congested): leave it queued and try again
+  // after one deadline
+  void holdOff(int64_t nowUs) { holdUntilUs_ = nowUs + deadlineUs_; }
+
+  // Discard everything pending (client gone)
+  void clear() {
+    len_ = 0;
+    holdUntilUs_ = 0;
+  }
+
+  uint16_t pendingBytes() const { return len_; }
+  uint16_t freeBytes() const { return CAPACITY - len_; }
+  uint32_t messages() const { return messages_; }
+  uint32_t notifications() const { return notifications_; }
+  uint32_t bytes() const { return bytes_; }
+  uint32_t dropped() const { return dropped_; }
+  uint16_t maxChunk() const { return maxChunk_; }
+
+  void resetStats() {
+    messages_ = 0;
+    notifications_ = 0;
+    bytes_ = 0;
+    dropped_ = 0;
+    maxChunk_ = 0;
+  }
+
+private:
+  uint8_t buf_[CAPACITY];
+  uint16_t payloadLimit_;
+  uint32_t deadlineUs_;
+  uint16_t len_;
+  int64_t oldestUs_;
+  int64_t holdUntilUs_;
+  uint32_t messages_;
+  uint32_t notifications_;
+  uint32_t bytes_;
+  uint32_t dropped_;
+  uint16_t maxChunk_;
+};
+
+#endif // BLE_TX_H
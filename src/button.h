@@ -0,0 +1,68 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include <stdint.h>
+#include "debounce.h"
+
+// ============================================================================
+// NON-BLOCKING BUTTON
+// ============================================================================
+//
+// Edge state machine on top of the leading-edge Debouncer. update() is called
+// once per loop iteration with the raw pin level and returns at most one event:
+//
+//   EVENT_PRESS       first debounced press edge (no added latency)
+//   EVENT_LONG_PRESS  button still held after longPress time units (once)
+//   EVENT_RELEASE     debounced release edge
+//
+// Nothing here waits for the button to be released, so the caller's loop keeps
+// running while the button is held. Time units are the caller's (micros()).
+
+class Button {
+public:
+  enum Event : uint8_t {
+    EVENT_NONE = 0,
+    EVENT_PRESS = 1,
+    EVENT_LONG_PRESS = 2,
+    EVENT_RELEASE = 3
+  };
+
+  // longPress = 0 disables EVENT_LONG_PRESS
+  Button(uint32_t lockout, uint32_t longPress = 0, bool activeLow = true)
+      : debouncer_(lockout, activeLow), longPress_(longPress),
+        pressedAt_(0), longFired_(false) {}
+
+  Event update(int level, uint32_t now) {
+    switch (debouncer_.update(level, now)) {
+    case Debouncer::EVENT_PRESSED:
+      pressedAt_ = now;
+      longFired_ = false;
+      return EVENT_PRESS;
+
+    case Debouncer::EVENT_RELEASED:
+      return EVENT_RELEASE;
+
+    case Debouncer::EVENT_NONE:
+      break;
+    }
+
+    if (longPress_ > 0 && debouncer_.isPressed() && !longFired_ &&
+        (uint32_t)(now - pressedAt_) >= longPress_) {
+      longFired_ = true;
+      return EVENT_LONG_PRESS;
+    }
+    return EVENT_NONE;
+  }
+
+  bool isPressed() const { return debouncer_.isPressed(); }
+  // True if the current (or just released) press already fired a long press
+  bool wasLongPress() const { return longFired_; }
+
+private:
+  Debouncer debouncer_;
+  uint32_t longPress_;
+  uint32_t pressedAt_;
+  bool longFired_;
+};
+
+#endif // BUTTON_H
@@ -1,17 +1,31 @@
 #include "config.h"
+#include "debounce.h"
+#include "latency_histogram.h"
+#include "led_pattern.h"
+#include "log.h"
+#include "node_link.h"
+#include "power_schedule.h"
 #include "protocol.h"
 #include <Arduino.h>
 #include <WiFi.h>
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include <driver/uart.h>
 #include <esp_now.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <atomic>
 
 // Ensure NODE_ID is defined at compile time
 #ifndef NODE_ID
-#error "NODE_ID must be defined (1-4) via build flags"
+#error "NODE_ID must be defined (1-MAX_NODES) via build flags"
 #endif
 
-#if NODE_ID < 1 || NODE_ID > 4
-#error "NODE_ID must be between 1 and 4"
+#if NODE_ID < 1 || NODE_ID > MAX_NODES
+#error "NODE_ID must be between 1 and MAX_NODES (64)"
 #endif
 
 // ============================================================================
@@ -19,159 +33,308 @@
 // ============================================================================
 
 // LED state management
-LEDState currentLEDState = LED_OFF;
-LEDState savedLEDState = LED_OFF; // Save state before disconnection
-unsigned long lastBlinkTime = 0;
-bool blinkState = false;
-
-// LED fade variables for breathing effect
-// Breathing fade is used during disconnected state for smooth visual feedback
-uint8_t fadeBrightness = 0;        // Current brightness (0-255)
-int8_t fadeDirection = 1;          // 1 for fade-in, -1 for fade-out
-unsigned long lastFadeTime = 0;    // Last time fade was updated
-
-// Two-stage blink variables for pressed state
-// Fast blink (5Hz) for 3 seconds grabs attention, then slow blink (2Hz) continues
-unsigned long fastBlinkStartTime = 0;  // When fast blink phase started
-bool isInFastBlinkPhase = false;       // True if in 5Hz fast blink phase
+LedPatternPlayer ledPlayer; // Plays the pattern of nodeLink.led()
 
 // Button state management
-bool lastButtonState = HIGH;
-unsigned long lastDebounceTime = 0;
-
-// Connection monitoring
+// The press edge is captured by a GPIO interrupt (esp_timer_get_time() in the
+// ISR) and handed to loop() through pressQueue; polling only tracks release.
+Debouncer buttonDebouncer(DEBOUNCE_DELAY_MS * 1000UL);
+QueueHandle_t pressQueue = nullptr;
+volatile bool buttonArmed = true;      // Cleared by ISR, set again on release
+volatile int64_t lastPressEdgeUs = 0;  // Last accepted press edge (ISR time base)
+
+// Press delivery: one press is in flight at a time (later ones wait in
+// pressQueue) and is resent with the same press_id until the MAC layer
+// reports it delivered. The controller discards repeated ids.
+enum PressStatus : uint8_t {
+  PRESS_STATUS_NONE,      // Send outcome not reported yet
+  PRESS_STATUS_DELIVERED,
+  PRESS_STATUS_FAILED
+};
+
+bool pressInFlight = false;
+BuzzerMessage pressMsg;
+uint8_t pressAttempts = 0;
+unsigned long pressSentAt = 0;
+uint32_t nextPressId = 0;                 // Random start, set in setup()
+std::atomic<uint8_t> pressStatus(PRESS_STATUS_NONE);
+
+// Send completion matching. ESP-NOW reports send results in send order, and
+// every send happens in loop(), so the n-th onDataSent() call belongs to the
+// n-th successful esp_now_send().
+uint32_t sendsIssued = 0;                 // Written by loop() only
+uint32_t sendsCompleted = 0;              // Written by onDataSent() only
+std::atomic<uint32_t> pressTicket(0);     // Send number of the press frame
+
+// Frames from the ESP-NOW receive callback, handled in loop() so replies are
+// sent from loop() too
+struct RxFrame {
+  int64_t rxTimeUs;
+  uint8_t len;
+  uint8_t data[32];
+};
+QueueHandle_t rxQueue = nullptr;
+
+// Connection monitoring. Any controller frame proves the link is up;
+// heartbeats also set the radio window phase. The connection state, the
+// state version held and the heartbeat gap count are in nodeLink (CONTROLLER
+// PROTOCOL).
 unsigned long lastHeartbeatTime = 0;
-bool isConnected = false;
+unsigned long lastControllerTime = 0;
+std::atomic<int8_t> controllerRssi(0);     // Last controller frame (dBm, 0 = none)
+
+// Hot-path latency histograms (µs), dumped by the STATS serial command
+LatencyHistogram edgeToSendHist;   // Button edge (ISR) -> press frame sent
+LatencyHistogram ledRxToWriteHist; // LED state received -> first LED write of it
+int64_t ledChangeRxUs = -1;        // Receive time of an LED change not yet written
+
+// Log lines (log.h) and command replies, written to serial by logTask()
+LogRing logRing;
+LogRing replyRing; // Replies first, so a log burst never delays them
+
+// Serial command input
+char serialInputBuffer[32];
+uint8_t serialInputIndex = 0;
+
+// Power mode (POWER serial command). In low-power mode loop() light-sleeps
+// whenever nothing is pending; see POWER MANAGEMENT.
+bool lowPowerMode = NODE_LOW_POWER;
+unsigned long awakeUntil = 0; // Don't sleep before this (millis)
+
+struct PowerStats {
+  int64_t sinceUs;  // Start of the measurement (mode switch or POWER RESET)
+  int64_t asleepUs;
+  uint32_t sleeps;
+  uint32_t wakeGpio;
+  uint32_t wakeTimer;
+  uint32_t wakeUart;
+};
+PowerStats powerStats = {};
+
+// Main controller MAC address (MAC_BASE, AA:BB:CC:DD:EE:00)
+uint8_t mainControllerMAC[6] = {MAC_BASE[0], MAC_BASE[1], MAC_BASE[2],
+                                MAC_BASE[3], MAC_BASE[4], 0x00};
+
+// ============================================================================
+// SERIAL OUTPUT
+// ============================================================================
+
+// Command replies and query output. Queued like log lines so loop(), which
+// also sends the presses, never waits on the UART.
+void serialReply(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void serialReply(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  replyRing.vwrite(LOG_LEVEL_NONE, fmt, args);
+  va_end(args);
+}
+
+// ============================================================================
+// LED PATTERNS
+// ============================================================================
+//
+// Each LED state maps to a declarative pattern (see led_pattern.h) played by
+// the LEDC hardware fade unit. The CPU only writes a new target at step
+// boundaries; steady states write once and are then left alone.
+
+// LED_ON / LED_OFF: one step, then hold
+const LedSegment LED_ON_SEGMENTS[] = {{255, 0, 0}};
+const LedSegment LED_OFF_SEGMENTS[] = {{0, 0, 0}};
+const LedPattern LED_ON_PATTERN = {LED_ON_SEGMENTS, 1, 1, nullptr};
+const LedPattern LED_OFF_PATTERN = {LED_OFF_SEGMENTS, 1, 1, nullptr};
+
+// LED_BLINK: 5Hz for FAST_BLINK_DURATION_MS grabs attention, then 2Hz
+const LedSegment SLOW_BLINK_SEGMENTS[] = {{255, 0, BLINK_INTERVAL_MS},
+                                          {0, 0, BLINK_INTERVAL_MS}};
+const LedSegment FAST_BLINK_SEGMENTS[] = {{255, 0, FAST_BLINK_INTERVAL_MS},
+                                          {0, 0, FAST_BLINK_INTERVAL_MS}};
+const LedPattern SLOW_BLINK_PATTERN = {SLOW_BLINK_SEGMENTS, 2, 0, nullptr};
+const LedPattern LED_BLINK_PATTERN = {
+    FAST_BLINK_SEGMENTS, 2,
+    FAST_BLINK_DURATION_MS / (2 * FAST_BLINK_INTERVAL_MS), &SLOW_BLINK_PATTERN};
+
+// LED_FADE: breathing while disconnected
+const LedSegment BREATHE_SEGMENTS[] = {{255, BREATHE_FADE_MS, 0},
+                                       {0, BREATHE_FADE_MS, 0}};
+const LedPattern LED_FADE_PATTERN = {BREATHE_SEGMENTS, 2, 0, nullptr};
+
+const LedPattern *ledPatternFor(LEDState state) {
+  switch (state) {
+  case LED_ON:
+    return &LED_ON_PATTERN;
+  case LED_BLINK:
+    return &LED_BLINK_PATTERN;
+  case LED_FADE:
+    return &LED_FADE_PATTERN;
+  default:
+    return &LED_OFF_PATTERN;
+  }
+}
+
+// LEDC calls that find a hardware fade in progress block until it ends, so
+// a new target is only written once the fade-end interrupt has cleared this
+// (a state change waits for at most one piece, without blocking loop())
+volatile bool ledFading = false;
+
+// LEDC ISR: the hardware fade reached its target
+bool IRAM_ATTR onLedFadeEnd(const ledc_cb_param_t *param, void *arg) {
+  if (param->event == LEDC_FADE_END_EVT) ledFading = false;
+  return false; // No task to wake
+}
+
+// Every runtime LED write goes through here so the receive -> output latency
+// of a state change is measured at the first write that shows it. Only
+// called while no fade is running.
+void writeLED(const LedPatternPlayer::Step &step) {
+  if (step.fadeMs == 0) {
+    ledc_set_duty_and_update(LEDC_LOW_SPEED_MODE, (ledc_channel_t)LED_PWM_CHANNEL,
+                             step.duty, 0);
+  } else {
+    ledFading = true;
+    ledc_set_fade_time_and_start(LEDC_LOW_SPEED_MODE, (ledc_channel_t)LED_PWM_CHANNEL,
+                                 step.duty, step.fadeMs, LEDC_FADE_NO_WAIT);
+  }
+  if (ledChangeRxUs >= 0) {
+    ledRxToWriteHist.record(esp_timer_get_time() - ledChangeRxUs);
+    ledChangeRxUs = -1;
+  }
+}
+
+// Write the next step once it is due and the last fade has ended (called
+// every loop() pass)
+void handleLED() {
+  unsigned long now = millis();
+  if (!ledFading && ledPlayer.isDue(now)) {
+    writeLED(ledPlayer.step(now));
+  }
+}
 
-// Main controller MAC address (will be set to AA:BB:CC:DD:EE:00)
-uint8_t mainControllerMAC[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x00};
+// Switch the LED to a state's pattern; its first step is written at once
+void showLEDState(LEDState state) {
+  ledPlayer.start(ledPatternFor(state), millis());
+  handleLED();
+}
 
 // ============================================================================
 // ESP-NOW CALLBACKS
 // ============================================================================
 
+// Keep the node (and its radio) awake for at least this long
+void stayAwake(unsigned long ms) {
+  unsigned long until = millis() + ms;
+  if ((long)(until - awakeUntil) > 0) awakeUntil = until;
+}
+
+// Send to the controller from loop(). Returns the send number that
+// onDataSent() will report, or 0 if the frame could not be queued.
+uint32_t sendToController(const void *data, size_t len, bool isPress = false) {
+  stayAwake(RADIO_HOLD_MS); // For the send status and any reply
+  uint32_t ticket = sendsIssued + 1;
+  if (isPress) {
+    pressStatus = PRESS_STATUS_NONE;
+    pressTicket = ticket; // Before sending: the callback may run first
+  }
+  if (esp_now_send(mainControllerMAC, (const uint8_t *)data, len) != ESP_OK) {
+    if (isPress) pressTicket = 0;
+    return 0;
+  }
+  sendsIssued = ticket;
+  return ticket;
+}
+
+// Runs in the WiFi task for every management frame on the channel. ESP-NOW
+// frames are action frames, and the receive callback does not report their
+// RSSI, so it is picked up here for frames from the controller (802.11
+// header: transmitter address at offset 10).
+void onPromiscuousRx(void *buf, wifi_promiscuous_pkt_type_t type) {
+  if (type != WIFI_PKT_MGMT) return;
+  const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+  if (pkt->rx_ctrl.sig_len >= 16 &&
+      memcmp(pkt->payload + 10, mainControllerMAC, 6) == 0) {
+    controllerRssi = (int8_t)pkt->rx_ctrl.rssi;
+  }
+}
+
+// Battery voltage through the divider on BUZZER_BATTERY_PIN (0 = not fitted)
+uint16_t readBatteryMv() {
+#if BUZZER_BATTERY_PIN >= 0
+  return (uint16_t)(analogReadMilliVolts(BUZZER_BATTERY_PIN) * BATTERY_DIVIDER_RATIO);
+#else
+  return 0;
+#endif
+}
+
+// Runs in the WiFi task: timestamp and hand the frame to loop()
 void onDataReceive(const uint8_t *mac, const uint8_t *data, int len) {
-  if (len != sizeof(BuzzerMessage)) {
-    Serial.println("ERROR: Received message with wrong size");
-    return;
+  // Receive time for clock synchronization, taken before anything else
+  RxFrame frame;
+  frame.rxTimeUs = esp_timer_get_time();
+  if (len < 2 || len > (int)sizeof(frame.data)) {
+    return; // Not one of ours
+  }
+  frame.len = (uint8_t)len;
+  memcpy(frame.data, data, len);
+  xQueueSend(rxQueue, &frame, 0);
+}
+
+// Runs in the WiFi task once per successful esp_now_send(), in send order
+void onDataSent(const uint8_t *mac, esp_now_send_status_t status) {
+  uint32_t done = ++sendsCompleted;
+  if (done == pressTicket) {
+    pressStatus = status == ESP_NOW_SEND_SUCCESS ? PRESS_STATUS_DELIVERED
+                                                 : PRESS_STATUS_FAILED;
   }
+}
 
-  BuzzerMessage msg;
-  memcpy(&msg, data, sizeof(msg));
+// ============================================================================
+// CONTROLLER PROTOCOL
+// ============================================================================
 
-  // Handle heartbeat messages from controller
-  if (msg.msg_type == MSG_HEARTBEAT) {
-    unsigned long now = millis();
-    bool wasConnected = isConnected;
-    lastHeartbeatTime = now;
-    
-    if (!wasConnected) {
-      // We just reconnected
-      Serial.println("Connected to controller");
-      isConnected = true;
-      
-      // Request current game state
-      BuzzerMessage stateReq;
-      stateReq.node_id = NODE_ID;
-      stateReq.msg_type = MSG_STATE_REQUEST;
-      stateReq.value = 0;
-      stateReq.timestamp = now;
-      
-      Serial.println("Requesting state sync...");
-      esp_now_send(mainControllerMAC, (uint8_t *)&stateReq, sizeof(stateReq));
-    }
-    return;
+// The protocol logic (lib/GameCore/src/node_link.h) has no hardware
+// dependencies; this adapter gives it the node's clock, radio, LED and log
+class NodeIO : public GameClock, public NodeLinkIO {
+public:
+  int64_t nowUs() override { return esp_timer_get_time(); }
+
+  void sendToController(const void *data, size_t len) override {
+    ::sendToController(data, len);
   }
 
-  // Handle state sync messages
-  if (msg.msg_type == MSG_STATE_SYNC && msg.node_id == NODE_ID) {
-    Serial.println("=== STATE SYNC RECEIVED ===");
-    
-    // Unpack game state from value field
-    uint8_t lockedBuzzers = msg.value & 0x0F;     // Bits 0-3
-    uint8_t selectedBuzzer = (msg.value >> 4) & 0x07; // Bits 4-6
-    bool isPartialLockout = (msg.value & 0x80) != 0;  // Bit 7
-    
-    Serial.print("  Locked buzzers: 0x");
-    Serial.print(lockedBuzzers, HEX);
-    Serial.print(" | Selected buzzer: ");
-    Serial.print(selectedBuzzer);
-    Serial.print(" | Mode: ");
-    Serial.println(isPartialLockout ? "PARTIAL_LOCKOUT" : "LOCKED");
-    
-    // Determine correct LED state based on game state
-    bool isLocked = lockedBuzzers & (1 << (NODE_ID - 1));
-    bool isSelected = (selectedBuzzer == NODE_ID);
-    
-    Serial.print("  This node: locked=");
-    Serial.print(isLocked ? "YES" : "NO");
-    Serial.print(" | selected=");
-    Serial.println(isSelected ? "YES" : "NO");
-    
-    if (isSelected) {
-      currentLEDState = LED_BLINK;
-      lastBlinkTime = millis(); // Reset blink timer to start immediately
-      // Start two-stage blink: fast blink for 3 seconds, then slow
-      isInFastBlinkPhase = true;
-      fastBlinkStartTime = millis();
-      Serial.println("  -> LED state: BLINK (selected)");
-    } else if (selectedBuzzer == 0) {
-      // STATE_READY: no buzzer selected, all LEDs ON
-      currentLEDState = LED_ON;
-      Serial.println("  -> LED state: ON (ready state)");
-    } else if (isPartialLockout) {
-      // In PARTIAL_LOCKOUT: only explicitly locked buzzers turn OFF
-      if (isLocked) {
-        currentLEDState = LED_OFF;
-        Serial.println("  -> LED state: OFF (locked in PARTIAL_LOCKOUT)");
-      } else {
-        currentLEDState = LED_ON;
-        Serial.println("  -> LED state: ON (not locked in PARTIAL_LOCKOUT)");
-      }
-    } else {
-      // In LOCKED state: all non-selected buzzers turn OFF
-      currentLEDState = LED_OFF;
-      Serial.println("  -> LED state: OFF (not selected in LOCKED)");
-    }
-    
-    savedLEDState = currentLEDState;
-    Serial.println("=== STATE SYNC COMPLETE ===");
-    return;
+  void showLed(LEDState state, int64_t rxTimeUs) override {
+    if (rxTimeUs >= 0) ledChangeRxUs = rxTimeUs;
+    showLEDState(state);
   }
 
-  // Handle LED commands for this node
-  if (msg.node_id == NODE_ID && msg.msg_type == MSG_LED_COMMAND) {
-    currentLEDState = (LEDState)msg.value;
-    savedLEDState = currentLEDState; // Save in case of disconnection
-    Serial.print("LED command received: ");
-    Serial.println(msg.value);
-
-    // Handle state-specific initialization
-    if (currentLEDState == LED_ON) {
-      ledcWrite(LED_PWM_CHANNEL, 255);  // Full brightness
-      blinkState = true;
-    } else if (currentLEDState == LED_OFF) {
-      ledcWrite(LED_PWM_CHANNEL, 0);  // Off
-      blinkState = false;
-    } else if (currentLEDState == LED_BLINK) {
-      // Start two-stage blink pattern
-      isInFastBlinkPhase = true;
-      fastBlinkStartTime = millis();
-      lastBlinkTime = millis();
-    } else if (currentLEDState == LED_FADE) {
-      // Initialize fade state
-      fadeBrightness = 0;
-      fadeDirection = 1;
-      lastFadeTime = millis();
-    }
+  void heartbeat(TimeSyncMessage &reply) override {
+    lastHeartbeatTime = millis();
+    reply.rssi = controllerRssi;
+    reply.flags = lowPowerMode ? NODE_STATUS_LOW_POWER : 0;
+    reply.battery_mv = readBatteryMv();
+  }
+
+  void log(const char *line) override { LOG_INFO("%s", line); }
+  bool logEnabled() const override { return LOG_LEVEL >= LOG_LEVEL_INFO; }
+};
+
+NodeIO nodeIO;
+NodeLink nodeLink(NODE_ID, nodeIO, nodeIO);
+
+// Frames the link does not know include the retired MSG_LED_COMMAND: the
+// controller only sends sequenced LED frames now, and an unsequenced one
+// could undo a newer state
+void handleFrame(const RxFrame &frame) {
+  if (!nodeLink.onFrame(frame.data, frame.len, frame.rxTimeUs)) {
+    LOG_WARN("Ignoring unexpected frame (%d bytes)", frame.len);
   }
 }
 
-void onDataSent(const uint8_t *mac, esp_now_send_status_t status) {
-  if (status == ESP_NOW_SEND_SUCCESS) {
-    Serial.println("Button press sent successfully");
-  } else {
-    Serial.println("ERROR: Button press send failed");
+// Drain frames queued by onDataReceive()
+void processReceivedFrames() {
+  RxFrame frame;
+  while (xQueueReceive(rxQueue, &frame, 0) == pdTRUE) {
+    stayAwake(RADIO_HOLD_MS); // Follow-up frames (LED state after a heartbeat)
+    lastControllerTime = millis(); // The controller may skip heartbeats while we ACK
+    handleFrame(frame);
   }
 }
 
@@ -179,46 +342,90 @@ void onDataSent(const uint8_t *mac, esp_now_send_status_t status) {
 // BUTTON HANDLING
 // ============================================================================
 
+// Falling-edge ISR: timestamp the physical press and queue it for loop().
+// Only the first edge after a clean release is accepted; bounce edges are
+// rejected because the button stays disarmed until loop() sees the release.
+void IRAM_ATTR onButtonEdge() {
+  int64_t now = esp_timer_get_time();
+
+  if (!buttonArmed || (now - lastPressEdgeUs) < DEBOUNCE_DELAY_MS * 1000LL) {
+    return;
+  }
+  buttonArmed = false;
+  lastPressEdgeUs = now;
+
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  xQueueSendFromISR(pressQueue, &now, &higherPriorityTaskWoken);
+  if (higherPriorityTaskWoken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+void sendPressAttempt() {
+  pressSentAt = millis();
+  if (sendToController(&pressMsg, sizeof(pressMsg), true) == 0) {
+    pressStatus = PRESS_STATUS_FAILED; // Not even queued: retry the same way
+  }
+}
+
+void sendButtonPress(int64_t pressTimeUs) {
+  pressMsg.node_id = NODE_ID;
+  pressMsg.msg_type = MSG_BUTTON_PRESS;
+  pressMsg.value = 1;
+  pressMsg.timestamp = millis();
+  pressMsg.press_id = nextPressId++;
+  pressMsg.time_us = (uint64_t)pressTimeUs;
+
+  LOG_INFO("Button pressed, sending press %u", pressMsg.press_id);
+
+  pressInFlight = true;
+  pressAttempts = 0;
+  edgeToSendHist.record(esp_timer_get_time() - pressTimeUs);
+  sendPressAttempt();
+}
+
+// Resend the in-flight press (same press_id) until it is delivered
+void updateButtonPress() {
+  uint8_t status = pressStatus;
+  unsigned long sinceSent = millis() - pressSentAt;
+
+  if (status == PRESS_STATUS_DELIVERED) {
+    pressInFlight = false;
+    LOG_DEBUG("Button press delivered");
+    return;
+  }
+
+  bool failed = status == PRESS_STATUS_FAILED && sinceSent >= RETRY_INTERVAL_MS;
+  bool noStatus = status == PRESS_STATUS_NONE && sinceSent >= PRESS_STATUS_TIMEOUT_MS;
+  if (!failed && !noStatus) return;
+
+  if (pressAttempts >= PRESS_MAX_RETRIES) {
+    pressInFlight = false;
+    LOG_ERROR("Button press not delivered");
+    return;
+  }
+  pressAttempts++;
+  LOG_WARN("Button press send failed, retry %u", pressAttempts);
+  sendPressAttempt();
+}
+
 void handleButton() {
-  int reading = digitalRead(BUZZER_BUTTON_PIN);
-
-  // Check if button state changed
-  if (reading != lastButtonState) {
-    lastDebounceTime = millis();
-  }
-
-  // Only register press after debounce delay
-  if ((millis() - lastDebounceTime) > DEBOUNCE_DELAY_MS) {
-    // Button pressed (LOW due to pullup)
-    if (reading == LOW) {
-      // Send button press message
-      BuzzerMessage msg;
-      msg.node_id = NODE_ID;
-      msg.msg_type = MSG_BUTTON_PRESS;
-      msg.value = 1;
-      msg.timestamp = millis();
-
-      Serial.print("Button pressed! Sending message from node ");
-      Serial.println(NODE_ID);
-
-      // Send with retries
-      for (int i = 0; i < MAX_RETRIES; i++) {
-        esp_err_t result =
-            esp_now_send(mainControllerMAC, (uint8_t *)&msg, sizeof(msg));
-        if (result == ESP_OK) {
-          break;
-        }
-        delay(RETRY_INTERVAL_MS);
-      }
-
-      // Wait for button release to avoid multiple presses
-      while (digitalRead(BUZZER_BUTTON_PIN) == LOW) {
-        delay(10);
-      }
-    }
+  // Take the next press captured by the ISR once the previous one is settled
+  int64_t pressTimeUs;
+  if (!pressInFlight && xQueueReceive(pressQueue, &pressTimeUs, 0) == pdTRUE) {
+    buttonDebouncer.accept(true, (uint32_t)pressTimeUs);
+    sendButtonPress(pressTimeUs);
+  }
+  if (pressInFlight) {
+    updateButtonPress();
   }
 
-  lastButtonState = reading;
+  // Poll for the (debounced) release to re-arm the interrupt path
+  Debouncer::Event event = buttonDebouncer.update(
+      digitalRead(BUZZER_BUTTON_PIN), (uint32_t)esp_timer_get_time());
+  if (event == Debouncer::EVENT_RELEASED) {
+    buttonArmed = true;
+  }
 }
 
 // ============================================================================
@@ -227,101 +434,224 @@ void handleButton() {
 
 void checkConnection() {
   unsigned long now = millis();
-  bool wasConnected = isConnected;
-  
+
   // Check if we've timed out
-  if (isConnected && (now - lastHeartbeatTime > CONNECTION_TIMEOUT_MS)) {
-    isConnected = false;
-    Serial.println("Disconnected from controller (timeout)");
-    
-    // Save current LED state before entering disconnected mode
-    savedLEDState = currentLEDState;
-    
-    // Enter breathing fade mode to indicate disconnection
-    currentLEDState = LED_FADE;
-    fadeBrightness = 0;
-    fadeDirection = 1;
-    lastFadeTime = now;
+  if (nodeLink.isConnected() && (now - lastControllerTime > CONNECTION_TIMEOUT_MS)) {
+    LOG_WARN("Disconnected from controller (timeout)");
+
+    // Breathing fade until the next heartbeat reconnects
+    nodeLink.disconnect();
   }
 }
 
 // ============================================================================
-// LED HANDLING
+// POWER MANAGEMENT
 // ============================================================================
+//
+// Low-power mode light-sleeps between events instead of spinning loop():
+// - The button wakes the CPU through a GPIO level wake-up. The press is
+//   timestamped on wake-up and takes the same path as an ISR edge.
+// - The radio is only listened to around the expected controller heartbeat,
+//   and for RADIO_HOLD_MS after any traffic or press. The controller
+//   re-broadcasts the LED frame with every heartbeat, so a node that slept
+//   through an LED change catches up within one heartbeat interval.
+// - LEDC runs from the RTC8M clock, so steady LEDs need no wake-ups at all.
+//   Blink and fade step boundaries wake the CPU briefly (the radio stays
+//   unused); hardware fades continue while asleep. Fades are split into
+//   LED_LOW_POWER_PIECE_MS pieces rather than 100 ms ones, so breathing
+//   wakes the CPU 8 times per cycle instead of 20.
+// - Serial input wakes the node through the UART (the first few characters
+//   are lost) and keeps it awake for SERIAL_WAKE_HOLD_MS.
+
+void resetPowerStats() {
+  powerStats = PowerStats();
+  powerStats.sinceUs = esp_timer_get_time();
+}
 
-// Smooth breathing fade effect for disconnected state
-// Uses PWM to gradually fade brightness in and out
-void handleLEDFade() {
-  unsigned long now = millis();
-  
-  // Update fade brightness at configured interval
-  if (now - lastFadeTime >= FADE_INTERVAL_MS) {
-    lastFadeTime = now;
-    
-    // Update brightness based on fade direction
-    fadeBrightness += (fadeDirection * FADE_STEP);
-    
-    // Reverse direction at brightness limits
-    if (fadeBrightness <= 0) {
-      fadeBrightness = 0;
-      fadeDirection = 1;  // Start fading in
-    } else if (fadeBrightness >= 255) {
-      fadeBrightness = 255;
-      fadeDirection = -1;  // Start fading out
-    }
-    
-    // Apply brightness using PWM
-    ledcWrite(LED_PWM_CHANNEL, fadeBrightness);
+void setPowerMode(bool lowPower) {
+  lowPowerMode = lowPower;
+  ledPlayer.setMaxPieceMs(lowPower ? LED_LOW_POWER_PIECE_MS : LedPatternPlayer::MAX_PIECE_MS);
+  if (lowPower) {
+    esp_sleep_enable_gpio_wakeup();
+    uart_set_wakeup_threshold(UART_NUM_0, 3);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
   }
+  resetPowerStats();
 }
 
-void handleLED() {
-  unsigned long now = millis();
-  
-  switch (currentLEDState) {
-  case LED_ON:
-    // Solid on at full brightness using PWM
-    ledcWrite(LED_PWM_CHANNEL, 255);
-    break;
+void reportPower() {
+  int64_t spanUs = esp_timer_get_time() - powerStats.sinceUs;
+  float asleep = spanUs > 0 ? (float)powerStats.asleepUs / spanUs : 0;
+  float estimateMa = NODE_CURRENT_AWAKE_MA * (1 - asleep) + NODE_CURRENT_SLEEP_MA * asleep;
+  serialReply("POWER mode=%s asleep_pct=%.1f sleeps=%u wake_gpio=%u wake_timer=%u wake_uart=%u est_ma=%.1f",
+              lowPowerMode ? "LOW" : "ACTIVE", asleep * 100, powerStats.sleeps,
+              powerStats.wakeGpio, powerStats.wakeTimer, powerStats.wakeUart,
+              estimateMa);
+}
 
-  case LED_OFF:
-    // Off (zero brightness) using PWM
-    ledcWrite(LED_PWM_CHANNEL, 0);
-    break;
+// Nothing in flight that needs the CPU, the radio or the UART
+bool nodeIdle(unsigned long now) {
+  return (long)(now - awakeUntil) >= 0 && !pressInFlight && buttonArmed &&
+         digitalRead(BUZZER_BUTTON_PIN) == HIGH &&
+         uxQueueMessagesWaiting(pressQueue) == 0 &&
+         uxQueueMessagesWaiting(rxQueue) == 0 && Serial.available() == 0 &&
+         logRing.depth() == 0 && replyRing.depth() == 0 &&
+         uart_wait_tx_done(UART_NUM_0, 0) == ESP_OK;
+}
 
-  case LED_FADE:
-    // Breathing fade effect (for disconnected state)
-    handleLEDFade();
+// A press that woke the node. Only the wake-up time is known; the edge
+// happened up to one light-sleep wake-up latency earlier.
+void captureWakePress(int64_t wokeUs) {
+  if (!buttonArmed || (wokeUs - lastPressEdgeUs) < DEBOUNCE_DELAY_MS * 1000LL) {
+    return;
+  }
+  buttonArmed = false;
+  lastPressEdgeUs = wokeUs;
+  xQueueSend(pressQueue, &wokeUs, 0);
+}
+
+void lightSleep(uint32_t sleepMs) {
+  gpio_num_t button = (gpio_num_t)BUZZER_BUTTON_PIN;
+
+  Serial.flush(); // The UART stops while asleep (nodeIdle() saw it drained)
+
+  // The edge interrupt stays masked until the wake-up press is captured, so
+  // the same press is never queued twice
+  gpio_intr_disable(button);
+  gpio_wakeup_enable(button, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+
+  int64_t sleptUs = esp_timer_get_time();
+  esp_light_sleep_start();
+  int64_t wokeUs = esp_timer_get_time();
+
+  switch (esp_sleep_get_wakeup_cause()) {
+  case ESP_SLEEP_WAKEUP_GPIO:
+    captureWakePress(wokeUs);
+    powerStats.wakeGpio++;
+    break;
+  case ESP_SLEEP_WAKEUP_UART:
+    stayAwake(SERIAL_WAKE_HOLD_MS);
+    powerStats.wakeUart++;
     break;
+  default:
+    powerStats.wakeTimer++;
+    break;
+  }
 
-  case LED_BLINK:
-    // Two-stage blink pattern: 5Hz fast for 3 seconds, then 2Hz slow
-    unsigned long blinkInterval;
-    
-    // Determine if we're in fast blink phase or slow blink phase
-    if (isInFastBlinkPhase) {
-      unsigned long elapsedTime = now - fastBlinkStartTime;
-      
-      if (elapsedTime >= FAST_BLINK_DURATION_MS) {
-        // Transition to slow blink phase
-        isInFastBlinkPhase = false;
-        blinkInterval = BLINK_INTERVAL_MS;  // 2Hz (500ms)
-      } else {
-        // Stay in fast blink phase
-        blinkInterval = FAST_BLINK_INTERVAL_MS;  // 5Hz (100ms)
-      }
-    } else {
-      // Normal slow blink
-      blinkInterval = BLINK_INTERVAL_MS;  // 2Hz (500ms)
+  gpio_wakeup_disable(button);
+  gpio_set_intr_type(button, GPIO_INTR_NEGEDGE);
+  gpio_intr_enable(button);
+
+  powerStats.asleepUs += wokeUs - sleptUs;
+  powerStats.sleeps++;
+}
+
+// Called at the end of every loop() pass
+void idle() {
+  if (lowPowerMode) {
+    unsigned long now = millis();
+    uint32_t sleepMs = lightSleepMs(nodeIdle(now),
+                                    radioNextWindowMs(now - lastHeartbeatTime, nodeLink.isConnected()),
+                                    ledPlayer.msUntilDue(now));
+    if (sleepMs > 0) {
+      lightSleep(sleepMs);
+      return;
     }
-    
-    // Execute non-blocking blink using PWM
-    if (now - lastBlinkTime >= blinkInterval) {
-      blinkState = !blinkState;
-      ledcWrite(LED_PWM_CHANNEL, blinkState ? 255 : 0);
-      lastBlinkTime = now;
+  }
+  delay(1); // Small delay to prevent watchdog issues
+}
+
+// ============================================================================
+// SERIAL COMMANDS
+// ============================================================================
+
+void reportStat(const char *name, const LatencyHistogram &hist) {
+  LatencyHistogram::Summary s = hist.summarize();
+  serialReply("STATS:%s n=%u p50_us=%u p90_us=%u p99_us=%u max_us=%u",
+              name, s.count, s.p50, s.p90, s.p99, s.max);
+}
+
+void executeSerialCommand(const char *command) {
+  if (strcmp(command, "STATS") == 0) {
+    serialReply("CMD_ACK:STATS");
+    reportStat("edge_to_send", edgeToSendHist);
+    reportStat("led_rx_to_write", ledRxToWriteHist);
+  } else if (strcmp(command, "STATS_RESET") == 0) {
+    edgeToSendHist.reset();
+    ledRxToWriteHist.reset();
+    serialReply("CMD_ACK:STATS_RESET");
+  } else if (strcmp(command, "LOG") == 0) {
+    serialReply("CMD_ACK:LOG");
+    serialReply("LOG level=%u depth=%u capacity=%u high_water=%u dropped=%u truncated=%u",
+                LOG_LEVEL, logRing.depth(), logRing.capacity(),
+                logRing.highWater(), logRing.dropped(), logRing.truncated());
+  } else if (strcmp(command, "LINK") == 0) {
+    serialReply("CMD_ACK:LINK");
+    serialReply("LINK connected=%u rssi=%d heartbeat_gaps=%u battery_mv=%u uptime_s=%u",
+                nodeLink.isConnected() ? 1 : 0, controllerRssi.load(), nodeLink.heartbeatGaps(),
+                readBatteryMv(), (uint32_t)(esp_timer_get_time() / 1000000));
+  } else if (strcmp(command, "POWER") == 0) {
+    serialReply("CMD_ACK:POWER");
+    reportPower();
+  } else if (strcmp(command, "POWER LOW") == 0 ||
+             strcmp(command, "POWER ACTIVE") == 0) {
+    setPowerMode(strcmp(command, "POWER LOW") == 0);
+    serialReply("CMD_ACK:POWER");
+    reportPower();
+  } else if (strcmp(command, "POWER RESET") == 0) {
+    resetPowerStats();
+    serialReply("CMD_ACK:POWER");
+  } else if (command[0] != '\0') {
+    serialReply("CMD_ERR:UNKNOWN:%s", command);
+  }
+}
+
+// Next line for the UART with its newline (0 = nothing to write): command
+// replies first, then log lines
+size_t nextSerialLine(char *line, size_t size) {
+  LogRecord record;
+  int n = 0;
+  uint32_t drops;
+  if (replyRing.pop(record)) {
+    n = snprintf(line, size, "%.*s\n", record.len, record.text);
+  } else if ((drops = logRing.takeNewDrops()) > 0) {
+    n = snprintf(line, size, "LOG:W:%u log lines dropped\n", drops);
+  } else if (logRing.pop(record)) {
+    n = snprintf(line, size, "LOG:%c:%.*s\n", LogRing::levelChar(record.level),
+                 record.len, record.text);
+  }
+  return n > 0 ? min((size_t)n, size - 1) : 0;
+}
+
+// Idle-priority task on the other core: the only serial writer, so loop()
+// and the radio callbacks never wait on the UART. A line is only written once
+// the TX buffer has room for all of it, so this task never blocks in the
+// UART driver either.
+void logTask(void *param) {
+  char line[LOG_LINE_LENGTH + 8]; // "LOG:I:" + text + newline
+  size_t len = 0;
+  for (;;) {
+    if (len == 0) len = nextSerialLine(line, sizeof(line));
+    while (len > 0 && (size_t)Serial.availableForWrite() >= len) {
+      Serial.write((const uint8_t *)line, len);
+      len = nextSerialLine(line, sizeof(line));
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_TASK_POLL_MS));
+  }
+}
+
+void handleSerialInput() {
+  while (Serial.available() > 0) {
+    stayAwake(SERIAL_WAKE_HOLD_MS);
+    char c = Serial.read();
+    if (c == '\n' || c == '\r') {
+      serialInputBuffer[serialInputIndex] = '\0';
+      executeSerialCommand(serialInputBuffer);
+      serialInputIndex = 0;
+    } else if (serialInputIndex < sizeof(serialInputBuffer) - 1) {
+      serialInputBuffer[serialInputIndex++] = c;
     }
-    break;
   }
 }
 
@@ -330,53 +660,82 @@ void handleLED() {
 // ============================================================================
 
 void setup() {
-  // Initialize serial for debugging
+  // Initialize serial for debugging; log lines and command replies are
+  // written by the log task
+  Serial.setTxBufferSize(SERIAL_TX_BUFFER_SIZE);
   Serial.begin(SERIAL_BAUD_RATE);
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK_SIZE, nullptr,
+                          LOG_TASK_PRIORITY, nullptr, LOG_TASK_CORE);
   delay(1000);
 
-  Serial.println("========================================");
-  Serial.print("BUZZER NODE ");
-  Serial.println(NODE_ID);
-  Serial.println("========================================");
+  LOG_INFO("BUZZER NODE %d", NODE_ID);
 
   // Configure GPIO pins
   pinMode(BUZZER_BUTTON_PIN, INPUT_PULLUP);
   pinMode(BUZZER_LED_PIN, OUTPUT);
   digitalWrite(BUZZER_LED_PIN, LOW);
 
-  // Initialize PWM/LEDC for smooth LED control
-  ledcSetup(LED_PWM_CHANNEL, LED_PWM_FREQUENCY, LED_PWM_RESOLUTION);
-  ledcAttachPin(BUZZER_LED_PIN, LED_PWM_CHANNEL);
-  ledcWrite(LED_PWM_CHANNEL, 0); // Start with LED off
-  Serial.println("✓ PWM/LEDC initialized for LED control");
+  // Interrupt-driven press capture (edge timestamps in microseconds)
+  pressQueue = xQueueCreate(PRESS_QUEUE_LENGTH, sizeof(int64_t));
+  nextPressId = esp_random(); // A restarted node never reuses recent ids
+  attachInterrupt(digitalPinToInterrupt(BUZZER_BUTTON_PIN), onButtonEdge,
+                  FALLING);
+  LOG_INFO("Button interrupt attached");
+
+  // Initialize PWM/LEDC for smooth LED control. The RTC8M clock (kept
+  // powered in light sleep) lets the LED keep its level while asleep.
+  ledc_timer_config_t ledTimer = {};
+  ledTimer.speed_mode = LEDC_LOW_SPEED_MODE;
+  ledTimer.duty_resolution = (ledc_timer_bit_t)LED_PWM_RESOLUTION;
+  ledTimer.timer_num = (ledc_timer_t)LED_PWM_TIMER;
+  ledTimer.freq_hz = LED_PWM_FREQUENCY;
+  ledTimer.clk_cfg = LEDC_USE_RTC8M_CLK;
+  ledc_timer_config(&ledTimer);
+
+  ledc_channel_config_t ledChannel = {};
+  ledChannel.gpio_num = BUZZER_LED_PIN;
+  ledChannel.speed_mode = LEDC_LOW_SPEED_MODE;
+  ledChannel.channel = (ledc_channel_t)LED_PWM_CHANNEL;
+  ledChannel.timer_sel = (ledc_timer_t)LED_PWM_TIMER;
+  ledChannel.duty = 0; // Start with LED off
+  ledc_channel_config(&ledChannel);
+  ledc_fade_func_install(0); // Hardware fades for the LED patterns
+  ledc_cbs_t ledCallbacks = {};
+  ledCallbacks.fade_cb = onLedFadeEnd;
+  ledc_cb_register(LEDC_LOW_SPEED_MODE, (ledc_channel_t)LED_PWM_CHANNEL, &ledCallbacks,
+                   nullptr);
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_ON);
+  LOG_INFO("PWM/LEDC initialized for LED control");
 
   // Set custom MAC address
   WiFi.mode(WIFI_STA);
-  uint8_t customMAC[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, NODE_ID};
+  uint8_t customMAC[6];
+  nodeMAC(NODE_ID, customMAC);
   esp_err_t macResult = esp_wifi_set_mac(WIFI_IF_STA, customMAC);
 
-  Serial.print("Custom MAC address: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", customMAC[i]);
-    if (i < 5)
-      Serial.print(":");
-  }
-  Serial.println();
-
   if (macResult == ESP_OK) {
-    Serial.println("✓ Custom MAC address set successfully");
+    LOG_INFO("Custom MAC address: %02X:%02X:%02X:%02X:%02X:%02X", customMAC[0],
+             customMAC[1], customMAC[2], customMAC[3], customMAC[4], customMAC[5]);
   } else {
-    Serial.println("✗ ERROR: Failed to set custom MAC address");
+    LOG_ERROR("Failed to set custom MAC address");
   }
 
   // Initialize ESP-NOW
   if (esp_now_init() != ESP_OK) {
-    Serial.println("✗ ERROR: ESP-NOW initialization failed");
+    LOG_ERROR("ESP-NOW initialization failed");
     return;
   }
-  Serial.println("✓ ESP-NOW initialized");
+  LOG_INFO("ESP-NOW initialized");
+
+  // Controller RSSI for the heartbeat reply (see onPromiscuousRx)
+  wifi_promiscuous_filter_t rxFilter = {};
+  rxFilter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+  esp_wifi_set_promiscuous_filter(&rxFilter);
+  esp_wifi_set_promiscuous_rx_cb(onPromiscuousRx);
+  esp_wifi_set_promiscuous(true);
 
-  // Register callbacks
+  // Register callbacks (received frames are handled in loop())
+  rxQueue = xQueueCreate(RX_QUEUE_LENGTH, sizeof(RxFrame));
   esp_now_register_send_cb(onDataSent);
   esp_now_register_recv_cb(onDataReceive);
 
@@ -387,31 +746,28 @@ void setup() {
   peerInfo.encrypt = false;
 
   if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-    Serial.println("✗ ERROR: Failed to add main controller as peer");
+    LOG_ERROR("Failed to add main controller as peer");
     return;
   }
-  Serial.println("✓ Main controller added as peer");
+  LOG_INFO("Main controller added as peer");
 
   // Initial LED state: breathing fade (disconnected until first heartbeat)
-  currentLEDState = LED_FADE;
-  savedLEDState = LED_OFF;
-  fadeBrightness = 0;
-  fadeDirection = 1;
-  lastFadeTime = millis();
-
-  // Initialize connection state (start as disconnected, will connect on first heartbeat)
-  isConnected = false;
+  showLEDState(LED_FADE);
+
+  // Start as disconnected (nodeLink connects on the first heartbeat)
   lastHeartbeatTime = millis(); // Initialize to current time
+  lastControllerTime = lastHeartbeatTime;
 
-  Serial.println("========================================");
-  Serial.println("Buzzer node ready!");
-  Serial.println("Waiting for controller heartbeat...");
-  Serial.println("========================================");
+  setPowerMode(lowPowerMode);
+  LOG_INFO("Buzzer node ready (power mode %s), waiting for controller heartbeat",
+           lowPowerMode ? "LOW" : "ACTIVE");
 }
 
 void loop() {
+  processReceivedFrames();
   checkConnection();
   handleButton();
   handleLED();
-  delay(1); // Small delay to prevent watchdog issues
+  handleSerialInput();
+  idle();
 }
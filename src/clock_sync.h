@@ -0,0 +1,214 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+
+// ============================================================================
+// NODE CLOCK SYNCHRONIZATION (NTP-style offset/drift estimator)
+// ============================================================================
+//
+// Every heartbeat is a four-timestamp exchange:
+//   t1 = controller time when the heartbeat is sent
+//   t2 = node time when the heartbeat is received
+//   t3 = node time when the reply is sent
+//   t4 = controller time when the reply is received
+//
+// For each exchange:
+//   round trip  = (t4 - t1) - (t3 - t2)
+//   offset      = ((t2 - t1) + (t3 - t4)) / 2      (node clock - controller clock)
+// and the true offset lies within +/- round_trip / 2 of that value.
+//
+// The estimator keeps the last WINDOW samples and discards the ones whose round
+// trip was inflated by queueing (anything well above the best round trip).
+// The offset is anchored on the lowest recent round trips, whose error bound is
+// the tightest. Crystal drift is the median slope between accepted samples at
+// least MIN_DRIFT_SPAN_US apart (several heartbeats; over a shorter span the
+// exchange jitter swamps it), clamped to the crystal tolerance, and stays 0
+// until the window spans that long.
+// All times are microseconds from esp_timer_get_time() on the respective side.
+
+class ClockSync {
+public:
+  static const uint8_t WINDOW = 16;            // Samples kept for the fit
+  static const uint32_t MAX_RTT_US = 20000;    // Reject slower exchanges outright
+  static const uint32_t RTT_SLACK_US = 300;    // Accept samples near the best RTT
+  static const uint32_t MAX_STEP_US = 10000;   // Larger jumps mean the node rebooted
+  static const uint32_t MIN_DRIFT_SPAN_US = 16000000; // Drift from samples this far apart
+  static constexpr double MAX_DRIFT_PPM = 100; // Crystal tolerance; a steeper slope is noise
+  static const uint8_t ANCHOR_SAMPLES = 2;     // Samples averaged for the offset
+  static constexpr double ANCHOR_AGE_PPM = 20; // Slope uncertainty when ranking them
+
+  ClockSync() { reset(); }
+
+  void reset() {
+    count_ = 0;
+    next_ = 0;
+    synced_ = false;
+    refCtrlUs_ = 0;
+    refOffsetUs_ = 0;
+    drift_ = 0.0;
+    errorBoundUs_ = 0;
+    bestRttUs_ = 0;
+  }
+
+  // Add one heartbeat exchange. Returns false if the sample was rejected.
+  bool addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    int64_t rtt = (t4 - t1) - (t3 - t2);
+    if (rtt < 0 || rtt > (int64_t)MAX_RTT_US) {
+      return false;
+    }
+
+    int64_t ctrlUs = t1 + (t4 - t1) / 2;
+    int64_t offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+
+    // A node that restarted has a new time base; start over
+    if (synced_) {
+      int64_t step = offsetUs - offsetAt(ctrlUs);
+      if (step > (int64_t)MAX_STEP_US || step < -(int64_t)MAX_STEP_US) {
+        reset();
+      }
+    }
+
+    Sample &s = samples_[next_];
+    s.ctrlUs = ctrlUs;
+    s.offsetUs = offsetUs;
+    s.rttUs = (uint32_t)rtt;
+    next_ = (next_ + 1) % WINDOW;
+    if (count_ < WINDOW) count_++;
+
+    refit();
+    return true;
+  }
+
+  bool isSynced() const { return synced_; }
+
+  // Estimated offset (node - controller) at the given controller time
+  int64_t offsetAt(int64_t ctrlUs) const {
+    return refOffsetUs_ + (int64_t)(drift_ * (double)(ctrlUs - refCtrlUs_));
+  }
+
+  // Map a node-local timestamp into the controller's time base
+  int64_t toController(int64_t nodeUs) const {
+    return nodeUs - offsetAt(nodeUs - refOffsetUs_);
+  }
+
+  // Offset at the most recent fit reference point
+  int64_t offsetUs() const { return refOffsetUs_; }
+  // Drift of the node clock relative to the controller, parts per million
+  double driftPpm() const { return drift_ * 1e6; }
+  // Half the best round trip plus the worst fit residual
+  uint32_t errorBoundUs() const { return errorBoundUs_; }
+  uint32_t bestRttUs() const { return bestRttUs_; }
+  uint8_t sampleCount() const { return count_; }
+
+private:
+  struct Sample {
+    int64_t ctrlUs;   // Controller-time midpoint of the exchange
+    int64_t offsetUs; // Measured node - controller offset
+    uint32_t rttUs;   // Round trip excluding node turnaround
+  };
+
+  void refit() {
+    // Best round trip in the window sets the quality threshold
+    uint32_t best = UINT32_MAX;
+    const Sample &latest = samples_[(next_ + WINDOW - 1) % WINDOW];
+    int64_t newest = latest.ctrlUs;
+    int64_t newestOffset = latest.offsetUs; // Keeps the sums small
+    for (uint8_t i = 0; i < count_; i++) {
+      if (samples_[i].rttUs < best) best = samples_[i].rttUs;
+    }
+    uint32_t limit = best + RTT_SLACK_US;
+
+    // Drift: the median slope over all pairs of accepted samples at least
+    // MIN_DRIFT_SPAN_US apart (Theil-Sen). Closer pairs say more about the
+    // exchange jitter than about the crystal, and the median ignores the
+    // pairs a jittery sample throws off.
+    double slopes[WINDOW * (WINDOW - 1) / 2];
+    uint8_t pairs = 0;
+    for (uint8_t i = 0; i < count_; i++) {
+      const Sample &a = samples_[i];
+      if (a.rttUs > limit) continue;
+      for (uint8_t j = 0; j < count_; j++) {
+        const Sample &b = samples_[j];
+        if (b.rttUs > limit || b.ctrlUs - a.ctrlUs < (int64_t)MIN_DRIFT_SPAN_US) continue;
+        slopes[pairs++] = (double)(b.offsetUs - a.offsetUs) / (double)(b.ctrlUs - a.ctrlUs);
+      }
+    }
+    double slope = drift_; // No such pair: keep the last estimate (0 at first)
+    if (pairs > 0) {
+      slope = median(slopes, pairs);
+      if (slope > MAX_DRIFT_PPM * 1e-6) slope = MAX_DRIFT_PPM * 1e-6;
+      if (slope < -MAX_DRIFT_PPM * 1e-6) slope = -MAX_DRIFT_PPM * 1e-6;
+    }
+
+    // Offset: the ANCHOR_SAMPLES tightest samples, each carried forward to
+    // the newest one along the slope. Tightness is half the round trip plus
+    // what an error of ANCHOR_AGE_PPM in the slope adds over the sample's age.
+    double anchored = 0;
+    uint8_t anchors = 0;
+    bool used[WINDOW] = {};
+    while (anchors < ANCHOR_SAMPLES) {
+      int8_t pick = -1;
+      double pickCost = 0;
+      for (uint8_t i = 0; i < count_; i++) {
+        const Sample &s = samples_[i];
+        if (used[i] || s.rttUs > limit) continue;
+        double cost = s.rttUs / 2.0 + ANCHOR_AGE_PPM * 1e-6 * (double)(newest - s.ctrlUs);
+        if (pick < 0 || cost < pickCost) {
+          pick = i;
+          pickCost = cost;
+        }
+      }
+      if (pick < 0) break;
+      used[pick] = true;
+      const Sample &s = samples_[pick];
+      anchored += (double)(s.offsetUs - newestOffset) + slope * (double)(newest - s.ctrlUs);
+      anchors++;
+    }
+    int64_t offset = newestOffset + (int64_t)(anchored / anchors);
+
+    // Worst residual of the accepted samples
+    double worst = 0;
+    for (uint8_t i = 0; i < count_; i++) {
+      const Sample &s = samples_[i];
+      if (s.rttUs > limit) continue;
+      double r = (double)(s.offsetUs - offset) - slope * (double)(s.ctrlUs - newest);
+      if (r < 0) r = -r;
+      if (r > worst) worst = r;
+    }
+
+    refCtrlUs_ = newest;
+    refOffsetUs_ = offset;
+    drift_ = slope;
+    bestRttUs_ = best;
+    errorBoundUs_ = best / 2 + (uint32_t)worst;
+    synced_ = true;
+  }
+
+  // Partial selection sort: only the middle element(s) are needed
+  static double median(double *v, uint8_t n) {
+    uint8_t half = n / 2;
+    for (uint8_t i = 0; i <= half; i++) {
+      uint8_t m = i;
+      for (uint8_t j = i + 1; j < n; j++) {
+        if (v[j] < v[m]) m = j;
+      }
+      double t = v[i];
+      v[i] = v[m];
+      v[m] = t;
+    }
+    return n % 2 ? v[half] : (v[half - 1] + v[half]) / 2;
+  }
+
+  Sample samples_[WINDOW];
+  uint8_t count_;
+  uint8_t next_;
+  bool synced_;
+  int64_t refCtrlUs_;
+  int64_t refOffsetUs_;
+  double drift_;          // d(offset)/d(controller time)
+  uint32_t errorBoundUs_;
+  uint32_t bestRttUs_;
+};
+
+#endif // CLOCK_SYNC_H
@@ -1,7 +1,7 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#include <Arduino.h>
+// Constants only (no includes), so host builds can use them too
 
 // ============================================================================
 // PIN ASSIGNMENTS
@@ -12,6 +12,10 @@
 #define BUZZER_LED_PIN 13    // LED output
 #define BUZZER_SPEAKER_PIN                                                     \
   14 // Reserved for future speaker (not implemented in v1)
+#ifndef BUZZER_BATTERY_PIN
+#define BUZZER_BATTERY_PIN -1 // Battery voltage divider on an ADC1 pin (-1 = not fitted)
+#endif
+#define BATTERY_DIVIDER_RATIO 2 // Battery voltage / pin voltage (two equal resistors)
 
 // Main Controller Pins
 #define CTRL_BUTTON_CORRECT 25 // Correct answer button (with internal pullup)
@@ -23,26 +27,54 @@
 // ============================================================================
 
 #define BLINK_INTERVAL_MS 500 // LED blink rate: 2Hz (500ms on, 500ms off)
-#define DEBOUNCE_DELAY_MS 50  // Button debounce time
+#define DEBOUNCE_DELAY_MS 50  // Bounce lockout after an accepted edge (press itself is not delayed)
 #define RETRY_INTERVAL_MS 10  // ESP-NOW retry interval
 #define MAX_RETRIES 3         // Maximum message retransmission attempts
+#define PRESS_MAX_RETRIES 8   // Press resends after MAC-layer delivery failures
+#define PRESS_STATUS_TIMEOUT_MS 100 // Resend if no send status arrives in time
+#define RX_QUEUE_LENGTH 8     // Node: received frames awaiting loop()
+#define PRESS_QUEUE_LENGTH 4  // Button edges buffered between ISR and loop()
+#define CTRL_RESET_LONG_PRESS_MS 0 // Hold RESET this long to reset (0 = on press)
 
 // Connection monitoring
 #define HEARTBEAT_INTERVAL_MS 2000 // Send heartbeat every 2 seconds
-#define CONNECTION_TIMEOUT_MS 5000 // Consider node disconnected after 5 seconds
+#define CONNECTION_TIMEOUT_MS 5000 // Node: controller lost after 5 seconds of silence
+                                   // (the controller adapts its per-node timeout, see link_quality.h)
+#define HEARTBEAT_MAX_SUPPRESSED 3 // Controller: heartbeats skipped in a row at most while
+                                   // ACKs prove the link (keeps clock sync and status fresh)
 #define DISCONNECT_BLINK_INTERVAL_MS                                           \
   100 // Fast blink when disconnected: 10Hz (100ms on, 100ms off)
 
+// Low-power buzzer node: light sleep whenever nothing is pending, radio
+// listening only around the expected controller heartbeat. Switchable at
+// runtime with the node's POWER serial command.
+#ifndef NODE_LOW_POWER
+#define NODE_LOW_POWER 0             // 1 = nodes boot in low-power mode
+#endif
+#define RADIO_WINDOW_LEAD_MS 20      // Listen this long before the expected heartbeat
+#define RADIO_WINDOW_LATE_MS 50      // ...and this long after it if it is late
+#define RADIO_HOLD_MS 30             // Stay awake after radio traffic or a press
+#define RADIO_SEARCH_PERIOD_MS 10000 // Disconnected: listen one heartbeat interval per period
+#define SERIAL_WAKE_HOLD_MS 5000     // Stay awake after serial input (to finish a command)
+#define LIGHT_SLEEP_MIN_MS 2         // Shorter idle gaps are not worth a sleep
+
+// Current draw used for the POWER estimate (ESP32 datasheet, LED excluded)
+#define NODE_CURRENT_AWAKE_MA 100.0f // CPU running, radio listening
+#define NODE_CURRENT_SLEEP_MA 0.8f   // Light sleep (RTC8M kept on for LEDC)
+
 // PWM/LEDC Configuration for smooth LED control
 // ESP32 LEDC peripheral provides hardware PWM for brightness control
-#define LED_PWM_CHANNEL 0       // LEDC channel (0-15 available)
+// The node drives it in low-speed mode from the RTC8M clock, the one LEDC
+// clock that keeps running in light sleep.
+#define LED_PWM_CHANNEL 0       // Low-speed LEDC channel (0-7)
+#define LED_PWM_TIMER 0         // Low-speed LEDC timer (0-3)
 #define LED_PWM_FREQUENCY 5000  // PWM frequency in Hz (5kHz recommended to avoid flicker)
-#define LED_PWM_RESOLUTION 8    // 8-bit resolution gives 0-255 brightness levels
+#define LED_PWM_RESOLUTION 10   // 10-bit duty (gamma table output, fits RTC8M at 5kHz)
 
 // LED Fade Configuration for breathing effect
 // Breathing effect creates smooth fade in/out during disconnected state
-#define FADE_STEP 5             // Brightness increment per fade step (smaller = smoother)
-#define FADE_INTERVAL_MS 20     // Time between fade steps (achieves ~2-3s per cycle)
+#define BREATHE_FADE_MS 1000    // Hardware fade time each way (~2s per cycle)
+#define LED_LOW_POWER_PIECE_MS 250 // Low-power mode: longer fade pieces, fewer wake-ups
 
 // Two-stage Blink Configuration for pressed buzzer feedback
 // Fast initial blink grabs attention, then transitions to slower sustained blink
@@ -54,13 +86,61 @@
 // ============================================================================
 
 #define SERIAL_BAUD_RATE 115200      // USB serial baud rate
-#define MESSAGE_QUEUE_SIZE 10        // Maximum queued serial messages
+#define MESSAGE_QUEUE_BYTES 1024     // Outbound message arena (serial/BLE events)
+#define MESSAGE_MAX_LENGTH 120       // Longest single outbound message
+#define MESSAGE_QUEUE_POLICY MessageRingBase::DROP_OLDEST // When full: DROP_OLDEST or DROP_NEWEST
 #define ESPNOW_CHANNEL 1             // ESP-NOW WiFi channel (1-13)
 #define SERIAL_INPUT_BUFFER_SIZE 256 // Buffer size for serial command input
+#define SERIAL_TX_BUFFER_SIZE 1024   // Serial output bytes buffered by the UART driver
+#define EVENT_QUEUE_SIZE 32          // Input events awaiting the game task (power of two)
+#define IO_EVENT_QUEUE_SIZE 16       // BLE link events awaiting the I/O task (power of two)
+
+// Logging (src/log.h). LOG_LEVEL: 0 none, 1 error, 2 warn, 3 info, 4 debug;
+// lines above it are compiled out.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3
+#endif
+#define LOG_QUEUE_SIZE 64            // Log lines awaiting the log task (power of two)
+#define LOG_LINE_LENGTH 121          // Longest log line + NUL
+#define LOG_TASK_CORE 0
+#define LOG_TASK_PRIORITY 0          // Idle priority: only runs when nothing else has work
+#define LOG_TASK_STACK_SIZE 3072     // Bytes
+#define LOG_TASK_POLL_MS 10
+
+// Game state journal (controller, NVS partition). The persist task does the
+// flash writes so the game task never waits for them.
+#define PERSIST_NAMESPACE "quizgame"
+#define PERSIST_TASK_CORE 0
+#define PERSIST_TASK_PRIORITY 1      // Below the I/O task, above the log task
+#define PERSIST_TASK_STACK_SIZE 4096 // Bytes
+#define FLASH_QUIET_MS 2000          // No press or transition this long: NVS writes allowed
+                                     // outside LOCKED too (LOCKED allows them at once)
+
+// Event journal (controller, the raw "spiffs" data partition, see
+// src/event_journal.h). Written by the persist task as well.
+#define JOURNAL_PARTITION_LABEL "spiffs"
+#define JOURNAL_BUFFER_SIZE 128      // Records awaiting the persist task (power of two)
+#define JOURNAL_FLUSH_MS 1000        // Longest a record waits in RAM once flash access is allowed
+#define JOURNAL_POLL_MS 100          // Persist task wake-up while a snapshot or records wait, or a sector needs erasing
+
+// Controller FreeRTOS tasks. The WiFi and BLE stacks run on core 0, so the
+// game task gets core 1 to itself and the I/O task shares core 0 with them.
+#define GAME_TASK_CORE 1
+#define GAME_TASK_PRIORITY 5         // Above the I/O task and Arduino's loopTask (1)
+#define GAME_TASK_STACK_SIZE 6144    // Bytes
+#define GAME_TASK_IDLE_MS 100        // Longest sleep (heartbeats, node timeouts)
+#define IO_TASK_CORE 0
+#define IO_TASK_PRIORITY 2
+#define IO_TASK_STACK_SIZE 6144      // Bytes
+#define IO_TASK_POLL_MS 5            // Control button and serial input polling
+#define REPORT_TIMEOUT_MS 250        // I/O task wait for the game task's state copy (CLOCK, HEALTH, ...)
 
 // BLE Configuration
 #define BLE_DEVICE_NAME "QuizBuzzer" // Base name (will append last 4 MAC digits)
 #define BLE_MTU_SIZE 512             // Maximum transmission unit (23-517 bytes)
+#define BLE_MAX_CLIENTS 3            // Concurrent centrals (host app, scoreboard, ...)
+#define BLE_TX_BUFFER_SIZE 1024      // Outbound bytes awaiting notification, per client
+#define BLE_FLUSH_DEADLINE_MS 5      // Longest a partial notification is held back
 
 // Nordic UART Service UUIDs (industry standard)
 #define BLE_SERVICE_UUID "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
@@ -71,6 +151,14 @@
 // GAME CONFIGURATION
 // ============================================================================
 
-#define NUM_BUZZERS 4 // Total number of buzzer nodes
+#ifndef NUM_BUZZERS
+#define NUM_BUZZERS 4 // Total number of buzzer nodes (1-64, see MAX_NODES)
+#endif
+
+// Press arbitration: after the first press, collect presses for this long and
+// award the buzz to the earliest press time (0 = first arrival wins).
+// Adjustable at runtime with the ARBITRATION <ms> serial command.
+#define ARBITRATION_WINDOW_MS 10
+#define ARBITRATION_MAX_WINDOW_MS 100
 
 #endif // CONFIG_H
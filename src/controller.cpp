@@ -1,136 +1,737 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <esp_now.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include <Preferences.h>
 #include "protocol.h"
 #include "config.h"
+#include "game_core.h"
+#include "button.h"
+#include "clock_sync.h"
+#include "event_queue.h"
+#include "message_ring.h"
+#include "frame_codec.h"
+#include "link_scheduler.h"
+#include "replay_window.h"
+#include "latency_histogram.h"
+#include "log.h"
+#include "ble_tx.h"
+#include "event_journal.h"
+
+static_assert(NUM_BUZZERS >= 1 && NUM_BUZZERS <= MAX_NODES,
+              "NUM_BUZZERS must be between 1 and MAX_NODES");
 
 // ============================================================================
-// GAME STATE MACHINE
+// GAME EVENTS
 // ============================================================================
 
-enum GameState {
-  STATE_READY,          // Waiting for first press, all buzzers active
-  STATE_LOCKED,         // One buzzer pressed, all others locked out
-  STATE_PARTIAL_LOCKOUT // Wrong answer given, that buzzer locked, others can try
+// Every input source (ESP-NOW, BLE, serial, buttons) posts decoded events into
+// one lock-free queue; the game task is the only consumer and the only code
+// that touches the game state, so the state machine sees inputs in one order.
+// BLE link events and requests that only concern one BLE client go to
+// ioEvents instead (the I/O task owns the BLE clients).
+enum GameEventType : uint8_t {
+  EVT_BUZZER_PRESS,  // Node button press (node-local edge time)
+  EVT_TIME_SYNC,     // Heartbeat reply with clock sync timestamps and node status
+  EVT_STATE_REQUEST, // Node asks for the current game state
+  EVT_CORRECT,       // Host marked the answer correct
+  EVT_WRONG,         // Host marked the answer wrong
+  EVT_RESET,         // Host requested a full reset
+  EVT_BLE_MODE,      // BLE client switched text/binary mode
+  EVT_BLE_CONNECT,   // BLE client connected
+  EVT_BLE_DISCONNECT, // BLE client disconnected
+  EVT_BLE_MTU,       // BLE client negotiated its MTU
+  EVT_BLE_PARAMS,    // BLE connection interval/latency changed
+  EVT_BLE_NOTIFY,    // BLE client enabled/disabled notifications (arg: 1/0)
+  EVT_BLE_CONGEST,   // BLE stack (un)congested a connection (arg: 1/0)
+  EVT_BLE_SUBSCRIBE, // BLE client chose its events (arg: BleSubscription bits)
+  EVT_ACK,           // Node acknowledged an LED state / state sync
+  EVT_STATS,         // Dump latency histograms (to the requesting link)
+  EVT_STATS_RESET,   // Clear latency histograms (game task: then as EVT_REPORT)
+  EVT_ARBITRATION,   // Host set the arbitration window (arg: ms), then as EVT_REPORT
+  EVT_EXPORT,        // Stream the event journal (to the requesting link)
+  EVT_REPORT         // Copy game-task state into gameReport ([0] = request id)
+};
+
+enum EventSource : uint8_t {
+  SOURCE_ESPNOW,
+  SOURCE_BLE,
+  SOURCE_SERIAL,
+  SOURCE_BUTTON
 };
 
-GameState currentState = STATE_READY;
-uint8_t selectedBuzzer = 0;        // 1-4, or 0 if none
-uint8_t lockedBuzzers = 0;         // Bitmask: bit 0 = buzzer 1, bit 1 = buzzer 2, etc.
-unsigned long lastPressTime = 0;   // For timestamp-based tie breaking
-
-// Known buzzer node MAC addresses (custom MACs set on buzzer nodes)
-uint8_t buzzerMACs[NUM_BUZZERS][6] = {
-  {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x01},
-  {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x02},
-  {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x03},
-  {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x04}
+// Node's view of the link, from its heartbeat reply (TimeSyncMessage)
+struct NodeStatus {
+  int8_t rssi;        // Controller RSSI at the node (dBm, 0 = unknown)
+  uint8_t flags;      // NODE_STATUS_* bits
+  uint16_t hbGaps;    // Heartbeats the node missed
+  uint16_t batteryMv; // 0 = not measured
 };
 
-// Control button state management
-bool lastCorrectState = HIGH;
-bool lastWrongState = HIGH;
-bool lastResetState = HIGH;
-unsigned long lastCorrectDebounce = 0;
-unsigned long lastWrongDebounce = 0;
-unsigned long lastResetDebounce = 0;
+struct GameEvent {
+  uint8_t type;       // GameEventType
+  uint8_t source;     // EventSource
+  uint8_t nodeId;     // Sending node for ESP-NOW events, 0 otherwise
+  uint8_t arg;        // Command argument (EVT_BLE_MODE: LinkMode)
+  uint8_t client;     // BLE client slot (I/O events)
+  int64_t postedUs;   // When the event was queued (for queueing delay)
+  int64_t rxTimeUs;   // Controller receive time (ESP-NOW events)
+  int64_t nodeTimes[3]; // Press: [0] = edge time, [1] = press id;
+                        // time sync: t1, t2, t3;
+                        // ACK: [0] = acknowledged sequence;
+                        // BLE connect: conn id, MTU, interval | latency << 16;
+                        // BLE MTU: [0] = MTU; BLE params: [0] = interval | latency << 16
+  NodeStatus status;  // Time sync: the reply's status fields
+};
+
+EventQueue<GameEvent, EVENT_QUEUE_SIZE> gameEvents;
+EventQueue<GameEvent, IO_EVENT_QUEUE_SIZE> ioEvents;
+uint32_t malformedFrames = 0;     // ESP-NOW frames with unexpected size
+std::atomic<uint32_t> maxEventDelayUs(0); // Worst post -> apply delay seen
+
+// Buzzer node MAC addresses (MAC_BASE + node id, filled in by setup()).
+// ESP-NOW holds a limited number of peers; nodes beyond that are reached
+// through the broadcast peer and pick their frames out by node_id.
+uint8_t buzzerMACs[NUM_BUZZERS][6];
+bool buzzerIsPeer[NUM_BUZZERS] = {};
+uint8_t broadcastMAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Control buttons (leading-edge debounce, non-blocking press/hold/release)
+Button correctButton(DEBOUNCE_DELAY_MS * 1000UL);
+Button wrongButton(DEBOUNCE_DELAY_MS * 1000UL);
+Button resetButton(DEBOUNCE_DELAY_MS * 1000UL, CTRL_RESET_LONG_PRESS_MS * 1000UL);
 
-// Serial message queue
-String messageQueue[MESSAGE_QUEUE_SIZE];
-int queueHead = 0;
-int queueTail = 0;
-int queueCount = 0;
+// Outbound message queue (preallocated byte arena, formatted in place)
+MessageRing<MESSAGE_QUEUE_BYTES, MESSAGE_MAX_LENGTH> messageQueue(MESSAGE_QUEUE_POLICY);
+uint8_t bleTxBuffer[frameEncodedSize(MESSAGE_MAX_LENGTH)]; // Text line or binary frame
 
 // Connection tracking
 unsigned long lastHeartbeatTime = 0;
-unsigned long nodeLastSeen[NUM_BUZZERS] = {0, 0, 0, 0};
-bool nodeConnected[NUM_BUZZERS] = {false, false, false, false};
+unsigned long nodeLastSeen[NUM_BUZZERS] = {};
+
+// The latest status each node reported (and its uptime, t3 of the reply).
+// Heartbeat loss, RSSI and the adaptive timeout are in nodeLinks.
+NodeStatus nodeStatus[NUM_BUZZERS] = {};
+bool nodeStatusValid[NUM_BUZZERS] = {};
+uint32_t nodeUptimeS[NUM_BUZZERS] = {};
+
+// Per-node clock offset/drift estimates (from heartbeat exchanges)
+ClockSync nodeClocks[NUM_BUZZERS];
+
+uint32_t nodeSendFailures[NUM_BUZZERS] = {}; // MAC-layer failures (onDataSent)
+
+// Per-node press ids already seen (node retries are idempotent)
+ReplayWindow pressWindows[NUM_BUZZERS];
+
+// Hot-path latency histograms (µs), dumped by STATS, cleared by STATS_RESET
+LogRing logRing; // Drained by logTask()
+
+// Each is recorded, and cleared, by one task only
+LatencyHistogram rxToApplyHist;     // ESP-NOW receive -> event applied by the game task
+LatencyHistogram rxToLockHist;      // Winning press received -> locked in (game task)
+LatencyHistogram queueToSerialHist; // Message queued -> written to serial (I/O task)
+LatencyHistogram queueToBleHist;    // Message queued -> sent in a BLE notification (I/O task)
+int64_t pressRxUs[NUM_BUZZERS] = {}; // Receive time of each node's latest press
+
+// Game state journal in NVS (see STATE PERSISTENCE)
+struct PersistRecord {
+  uint16_t magic;         // PERSIST_MAGIC
+  uint16_t crc;           // CRC-16 of journalSeq and snapshot (persistRecordCrc)
+  uint32_t journalSeq;    // +1 per record; of the two slots the newer one wins
+  GameSnapshot snapshot;
+};
+
+struct PersistStats {
+  uint32_t writes;
+  uint32_t skipped;       // Transition left the saved state unchanged
+  uint32_t coalesced;     // Replaced by a newer one before it was written
+  uint32_t deferred;      // Persist task passes that held a snapshot back (flashAccess)
+  uint32_t failed;
+  uint32_t lastWriteUs;
+  uint32_t maxWriteUs;
+};
+
+Preferences statePrefs;             // Persist task only (after setup)
+GameSnapshot persistPending;        // Newest snapshot not written yet (persistLock)
+bool persistHasPending = false;     // (persistLock)
+GameSnapshot persistWritten;        // Newest snapshot in flash
+bool persistHaveWritten = false;
+uint32_t persistJournalSeq = 0;    // (persistLock once the tasks run)
+PersistStats persistStats = {};     // (persistLock)
+
+// Boot recovery timing (esp_timer time, i.e. since the app started)
+struct RecoveryStats {
+  bool restored;              // Came back with a saved state
+  GameSnapshot snapshot;      // ...namely this one
+  int64_t publishUs;          // First LED frame (restored or READY) sent
+  uint16_t ledSeq;            // ...with this sequence
+  int64_t ackUs[NUM_BUZZERS]; // Node confirmed it (or a newer state), 0 = not yet
+};
+RecoveryStats recovery = {};
+
+// Game-task state for the CLOCK, LINKS, HEALTH, ARBITRATION and PERSIST
+// reports (see GAME STATE REPORTS)
+struct ClockSummary {
+  bool synced;
+  int64_t offsetUs;
+  double driftPpm;
+  uint32_t errorBoundUs;
+  uint32_t bestRttUs;
+  uint8_t samples;
+};
+
+struct NodeReport {
+  ClockSummary clock;
+  ReliableLink link;
+  ReplayWindow presses;
+  LinkQuality quality;
+  NodeStatus status;
+  bool statusValid;
+  uint32_t uptimeS;
+  bool connected;
+  uint32_t silentMs;
+  int64_t recoveryAckUs;
+};
+
+struct ArbitrationReport {
+  uint32_t windowUs;
+  uint32_t rounds;
+  uint32_t contested;
+  uint32_t reordered;
+};
+
+struct GameReport {
+  NodeReport nodes[NUM_BUZZERS];
+  ArbitrationReport arbitration;
+};
+
+GameReport gameReport;                    // Written by the game task on EVT_REPORT
+std::atomic<uint32_t> reportRequested(0); // Newest request id (I/O task)
+std::atomic<uint32_t> reportFilled(0);    // Request gameReport currently answers
+
+// Event journal in the spiffs partition (see EVENT JOURNAL). The game task
+// appends, the persist task writes, the I/O task exports.
+EventJournal eventJournal;
+
+// When the persist task may program or erase flash (set by the game task)
+enum FlashAccess : uint8_t {
+  FLASH_HOLD,  // Arbitration round open: nothing
+  FLASH_DEFER, // Presses accepted (READY, PARTIAL_LOCKOUT): only to avoid losing journal records
+  FLASH_IDLE   // LOCKED or quiet (no press can be waiting): everything
+};
+std::atomic<uint8_t> flashAccess(FLASH_DEFER); // Until the game task's first pass
+uint32_t journalDeferred = 0; // Persist task passes that left records waiting
+unsigned long lastGameActivity = 0; // Last press or transition, millis (game task)
+
+// EXPORT in progress (I/O task)
+struct JournalExport {
+  bool active;
+  uint8_t source;               // SOURCE_SERIAL or SOURCE_BLE
+  uint8_t client;               // BLE client slot (SOURCE_BLE)
+  EventJournal::Cursor cursor;
+  uint32_t records;
+  int64_t startUs;
+};
+JournalExport journalExport = {};
 
 // Serial command input
 char serialInputBuffer[SERIAL_INPUT_BUFFER_SIZE];
 int serialInputIndex = 0;
 
-// BLE variables
+// BLE variables (per-client state: see OUTPUT CHANNELS)
 BLEServer* pBLEServer = nullptr;
 BLECharacteristic* pTxCharacteristic = nullptr;
 BLECharacteristic* pRxCharacteristic = nullptr;
-bool bleClientConnected = false;
+BLEDescriptor* pTxCccd = nullptr; // Client Characteristic Configuration of TX
 String bleDeviceName = "";
 
+// FreeRTOS tasks (created by setup()). The game task owns the game state,
+// the I/O task owns serial input and BLE output; both sleep until notified.
+TaskHandle_t gameTaskHandle = nullptr;
+TaskHandle_t ioTaskHandle = nullptr;
+TaskHandle_t logTaskHandle = nullptr;
+TaskHandle_t persistTaskHandle = nullptr;
+SemaphoreHandle_t messageQueueLock = nullptr; // Game task queues, I/O task drains
+SemaphoreHandle_t serialLock = nullptr;       // Keeps lines from both tasks whole
+SemaphoreHandle_t persistLock = nullptr;      // Game task posts, persist task writes
+SemaphoreHandle_t reportReady = nullptr;      // Game task filled gameReport
+
 // Forward declarations for BLE callbacks
-void handleCorrectAnswer();
-void handleWrongAnswer();
-void handleFullReset();
+bool postGameEvent(uint8_t type, uint8_t source, uint8_t arg = 0);
+bool postGameEvent(const GameEvent& event);
+bool postIoEvent(const GameEvent& event);
+bool postBleEvent(uint8_t type, uint8_t client, uint8_t arg = 0, int64_t value = 0);
+void reportTasks();
+void reportLog();
+void journalGameState();
+void journalEvent(uint8_t type, uint8_t id, uint32_t value, int64_t timeUs);
+bool requestGameReport(uint8_t type = EVT_REPORT, uint8_t arg = 0);
+
+// ============================================================================
+// OUTPUT CHANNELS (text lines or binary frames)
+// ============================================================================
+
+// Each host link is either newline-delimited ASCII (default) or COBS-framed
+// binary (see frame_codec.h), switched at runtime with MODE TEXT / MODE BINARY.
+// In binary mode debug output is wrapped in FRAME_LOG frames, so host software
+// never has to separate log text from protocol messages.
+enum LinkMode : uint8_t {
+  LINK_TEXT,
+  LINK_BINARY
+};
+
+LinkMode serialMode = LINK_TEXT;
+std::atomic<uint16_t> serialFrameSeq(0);
+
+// Up to BLE_MAX_CLIENTS centrals at once (e.g. the host app and a scoreboard).
+// Each has its own output mode, event subscriptions and TX batch, so a slow or
+// congested client only holds up its own output. The I/O task owns the slots;
+// the BLE callbacks only post link events to it.
+enum BleSubscription : uint8_t {
+  SUB_BUZZ = 0x01,
+  SUB_CORRECT = 0x02,
+  SUB_WRONG = 0x04,
+  SUB_RESET = 0x08,
+  SUB_NODES = 0x10, // RECONNECT / DISCONNECT
+  SUB_STATE = 0x20, // RESTORED
+  SUB_OTHER = 0x80, // Any other event line
+  SUB_ALL = 0xFF
+};
+
+struct NamedSubscription {
+  const char* name;
+  uint8_t bits;
+};
+
+const NamedSubscription SUBSCRIPTION_NAMES[] = {
+  {"BUZZ", SUB_BUZZ}, {"CORRECT", SUB_CORRECT}, {"WRONG", SUB_WRONG},
+  {"RESET", SUB_RESET}, {"NODES", SUB_NODES}, {"STATE", SUB_STATE},
+  {"OTHER", SUB_OTHER}, {"ALL", SUB_ALL},
+};
+
+// Event lines by prefix (anything else is SUB_OTHER)
+const NamedSubscription EVENT_CATEGORIES[] = {
+  {"BUZZ", SUB_BUZZ}, {"CORRECT", SUB_CORRECT}, {"WRONG", SUB_WRONG},
+  {"RESET", SUB_RESET}, {"RECONNECT:", SUB_NODES}, {"DISCONNECT:", SUB_NODES},
+  {"RESTORED:", SUB_STATE},
+};
+
+struct BleClient {
+  BleClient() : tx(23 - 3, BLE_FLUSH_DEADLINE_MS * 1000UL) {}
+
+  bool connected;
+  uint16_t connId;
+  uint16_t mtu;           // Negotiated ATT MTU (23 until exchanged)
+  uint16_t interval;      // Connection interval, 1.25 ms units
+  uint16_t latency;       // Peripheral latency, connection events
+  bool notify;            // Notifications enabled in the client's CCCD
+  bool congested;         // Stack reports the connection congested
+  LinkMode mode;
+  uint16_t frameSeq;
+  uint8_t subscriptions;  // BleSubscription bits of the events it receives
+  BleTxBatcher<BLE_TX_BUFFER_SIZE> tx; // Packed into MTU-sized notifications
+  int64_t batchQueuedUs;  // Queue time of the oldest message awaiting notification
+  int64_t connectedUs;
+  uint32_t deferred;      // Notifications the stack refused (kept and retried)
+  uint32_t reportedBytes; // tx.bytes() at the previous BLE report
+  int64_t reportedAtUs;
+};
+
+BleClient bleClients[BLE_MAX_CLIENTS];
+
+void writeSerialFrame(uint8_t type, uint64_t timeUs, const char* payload, size_t len) {
+  uint8_t scratch[FRAME_HEADER_SIZE + MESSAGE_MAX_LENGTH + FRAME_CRC_SIZE];
+  uint8_t frame[frameEncodedSize(MESSAGE_MAX_LENGTH)];
+  if (len > MESSAGE_MAX_LENGTH) len = MESSAGE_MAX_LENGTH;
+
+  size_t n = encodeFrame(type, serialFrameSeq.fetch_add(1), timeUs,
+                         (const uint8_t*)payload, len, scratch, frame);
+  Serial.write(frame, n);
+}
+
+// Write one line to serial in the current mode
+void writeSerialRecord(uint8_t frameType, uint64_t timeUs, const char* line, size_t len) {
+  xSemaphoreTake(serialLock, portMAX_DELAY);
+  if (serialMode == LINK_BINARY) {
+    writeSerialFrame(frameType, timeUs, line, len);
+  } else {
+    Serial.write((const uint8_t*)line, len);
+    Serial.write('\n');
+  }
+  xSemaphoreGive(serialLock);
+}
+
+void writeSerialLine(uint8_t frameType, const char* line, size_t len) {
+  writeSerialRecord(frameType, (uint64_t)esp_timer_get_time(), line, len);
+}
+
+// Command responses and query output on the serial link
+void serialReply(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void serialReply(const char* fmt, ...) {
+  char line[MESSAGE_MAX_LENGTH + 1];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  if (n <= 0) return;
+  writeSerialLine(FRAME_RESPONSE, line, min((size_t)n, sizeof(line) - 1));
+}
+
+// Fill bleTxBuffer with one line in the client's mode, returns its length
+size_t formatBleLine(BleClient& client, uint8_t frameType, uint64_t timeUs,
+                     const char* line, size_t len) {
+  if (len > MESSAGE_MAX_LENGTH) len = MESSAGE_MAX_LENGTH;
+  if (client.mode == LINK_BINARY) {
+    uint8_t scratch[FRAME_HEADER_SIZE + MESSAGE_MAX_LENGTH + FRAME_CRC_SIZE];
+    return encodeFrame(frameType, client.frameSeq++, timeUs, (const uint8_t*)line,
+                       len, scratch, bleTxBuffer);
+  }
+  memcpy(bleTxBuffer, line, len);
+  bleTxBuffer[len] = '\n';
+  return len + 1;
+}
+
+// Queue one line for a client (sent by flushBleTx). False if its batch is full.
+bool queueBleLine(BleClient& client, uint8_t frameType, uint64_t timeUs,
+                  const char* line, size_t len) {
+  size_t n = formatBleLine(client, frameType, timeUs, line, len);
+  if (client.tx.pendingBytes() == 0) client.batchQueuedUs = (int64_t)timeUs;
+  return client.tx.append(bleTxBuffer, n, esp_timer_get_time());
+}
+
+// Command responses to one BLE client (batched like events)
+void bleReply(BleClient& client, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void bleReply(BleClient& client, const char* fmt, ...) {
+  if (!client.connected || !client.notify) return;
+  char line[MESSAGE_MAX_LENGTH + 1];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  if (n <= 0) return;
+
+  queueBleLine(client, FRAME_RESPONSE, (uint64_t)esp_timer_get_time(), line,
+               min((size_t)n, sizeof(line) - 1));
+}
+
+// "SUBSCRIBE BUZZ,CORRECT" argument -> BleSubscription bits, 0 if a name is unknown
+uint8_t parseSubscriptions(const char* list) {
+  uint8_t bits = 0;
+  while (*list != '\0') {
+    size_t len = strcspn(list, " ,");
+    if (len > 0) {
+      bool known = false;
+      for (const NamedSubscription& sub : SUBSCRIPTION_NAMES) {
+        if (strlen(sub.name) == len && strncmp(list, sub.name, len) == 0) {
+          bits |= sub.bits;
+          known = true;
+          break;
+        }
+      }
+      if (!known) return 0;
+    }
+    list += len;
+    if (*list != '\0') list++;
+  }
+  return bits;
+}
+
+void formatSubscriptions(uint8_t bits, char* out, size_t size) {
+  if (bits == SUB_ALL) {
+    snprintf(out, size, "ALL");
+    return;
+  }
+  size_t used = 0;
+  out[0] = '\0';
+  for (const NamedSubscription& sub : SUBSCRIPTION_NAMES) {
+    if (sub.bits == SUB_ALL || (bits & sub.bits) == 0 || used >= size) continue;
+    used += snprintf(out + used, size - used, "%s%s", used > 0 ? "," : "", sub.name);
+  }
+}
+
+uint8_t eventCategory(const char* line, size_t len) {
+  for (const NamedSubscription& category : EVENT_CATEGORIES) {
+    size_t prefixLen = strlen(category.name);
+    if (len >= prefixLen && memcmp(line, category.name, prefixLen) == 0) {
+      return category.bits;
+    }
+  }
+  return SUB_OTHER;
+}
 
 // ============================================================================
 // BLE CALLBACK CLASSES
 // ============================================================================
 
+// The BLE callbacks all run in the Bluedroid task, which alone owns this
+// connection table; everything else learns about clients through link events.
+struct BleConnection {
+  bool used;
+  uint16_t connId;
+  esp_bd_addr_t bda;
+  LinkMode rxMode; // Mode commands from this client are decoded in
+};
+
+BleConnection bleConnections[BLE_MAX_CLIENTS];
+uint8_t bleConnectionCount = 0;
+
+int bleSlotForConn(uint16_t connId) {
+  for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+    if (bleConnections[i].used && bleConnections[i].connId == connId) return i;
+  }
+  return -1;
+}
+
+int bleSlotForAddress(const esp_bd_addr_t bda) {
+  for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+    if (bleConnections[i].used && memcmp(bleConnections[i].bda, bda, sizeof(esp_bd_addr_t)) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
 class ServerCallbacks: public BLEServerCallbacks {
-  void onConnect(BLEServer* pServer) {
-    bleClientConnected = true;
-    Serial.println("BLE client connected");
+  void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    int slot = -1;
+    for (int i = 0; i < BLE_MAX_CLIENTS && slot < 0; i++) {
+      if (!bleConnections[i].used) slot = i;
+    }
+    if (slot < 0) {
+      LOG_WARN("BLE client rejected: %u clients connected", bleConnectionCount);
+      pServer->disconnect(param->connect.conn_id);
+      return;
+    }
+
+    BleConnection& connection = bleConnections[slot];
+    connection.used = true;
+    connection.connId = param->connect.conn_id;
+    memcpy(connection.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+    connection.rxMode = LINK_TEXT; // Every new client starts in text mode
+    bleConnectionCount++;
+
+    GameEvent event = {};
+    event.type = EVT_BLE_CONNECT;
+    event.source = SOURCE_BLE;
+    event.client = slot;
+    event.nodeTimes[0] = param->connect.conn_id;
+    event.nodeTimes[1] = pServer->getPeerMTU(param->connect.conn_id);
+    event.nodeTimes[2] = param->connect.conn_params.interval |
+                         ((int64_t)param->connect.conn_params.latency << 16);
+    postIoEvent(event);
+    LOG_INFO("BLE client %d connected (%u/%u)", slot, bleConnectionCount, BLE_MAX_CLIENTS);
+
+    // Advertising stops on connect; keep accepting clients while slots are free
+    if (bleConnectionCount < BLE_MAX_CLIENTS) BLEDevice::startAdvertising();
   }
 
-  void onDisconnect(BLEServer* pServer) {
-    bleClientConnected = false;
-    Serial.println("BLE client disconnected");
-    
+  void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    int slot = bleSlotForConn(param->mtu.conn_id);
+    if (slot < 0) return;
+    postBleEvent(EVT_BLE_MTU, slot, 0, param->mtu.mtu);
+    LOG_DEBUG("BLE client %d MTU: %u", slot, param->mtu.mtu);
+  }
+
+  void onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    int slot = bleSlotForConn(param->disconnect.conn_id);
+    if (slot < 0) return; // Rejected as one client too many
+    bleConnections[slot].used = false;
+    bleConnectionCount--;
+    postBleEvent(EVT_BLE_DISCONNECT, slot);
+    LOG_INFO("BLE client %d disconnected", slot);
+
     // Restart advertising for new connections
     BLEDevice::startAdvertising();
-    Serial.println("BLE advertising restarted");
+    LOG_DEBUG("BLE advertising restarted");
   }
 };
 
+// CCCD writes and congestion are per connection; BLE2902 and
+// BLECharacteristic::notify() only know one client, so read them here.
+void bleGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf,
+                   esp_ble_gatts_cb_param_t* param) {
+  switch (event) {
+  case ESP_GATTS_WRITE_EVT: {
+    if (pTxCccd == nullptr || param->write.handle != pTxCccd->getHandle() ||
+        param->write.len < 2) {
+      break;
+    }
+    int slot = bleSlotForConn(param->write.conn_id);
+    if (slot >= 0) postBleEvent(EVT_BLE_NOTIFY, slot, (param->write.value[0] & 0x01) ? 1 : 0);
+    break;
+  }
+  case ESP_GATTS_CONGEST_EVT: {
+    int slot = bleSlotForConn(param->congest.conn_id);
+    if (slot >= 0) postBleEvent(EVT_BLE_CONGEST, slot, param->congest.congested ? 1 : 0);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void bleGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT || param->update_conn_params.status != 0) {
+    return;
+  }
+  int slot = bleSlotForAddress(param->update_conn_params.bda);
+  if (slot < 0) return;
+  postBleEvent(EVT_BLE_PARAMS, slot, 0,
+               param->update_conn_params.conn_int |
+               ((int64_t)param->update_conn_params.latency << 16));
+}
+
 class RxCallbacks: public BLECharacteristicCallbacks {
-  void onWrite(BLECharacteristic *pCharacteristic) {
-    std::string value = pCharacteristic->getValue();
-    
-    if (value.length() > 0) {
-      String command = String(value.c_str());
-      command.trim(); // Remove whitespace and newlines
-      
-      Serial.print("BLE CMD: ");
-      Serial.println(command);
-      
-      // Process command (reuse serial command logic)
-      if (command == "CORRECT") {
-        handleCorrectAnswer();
-      } else if (command == "WRONG") {
-        handleWrongAnswer();
-      } else if (command == "RESET") {
-        handleFullReset();
-      } else if (command.length() > 0) {
-        Serial.print("BLE CMD_ERR:UNKNOWN:");
-        Serial.println(command);
+  void onWrite(BLECharacteristic *pCharacteristic, esp_ble_gatts_cb_param_t* param) {
+    int slot = bleSlotForConn(param->write.conn_id);
+    if (slot < 0) return;
+    // The characteristic's value is only valid until the next write
+    std::string value((const char*)param->write.value, param->write.len);
+    if (value.length() == 0) return;
+
+    String command;
+    if (bleConnections[slot].rxMode == LINK_BINARY) {
+      // One FRAME_COMMAND frame per write, trailing delimiter optional
+      size_t len = value.length();
+      if (value[len - 1] == 0) len--;
+      uint8_t frame[FRAME_HEADER_SIZE + SERIAL_INPUT_BUFFER_SIZE + FRAME_CRC_SIZE];
+      size_t payloadLen = 0;
+      if (len > sizeof(frame) ||
+          !decodeFrame((const uint8_t*)value.data(), len, frame, payloadLen) ||
+          frame[0] != FRAME_COMMAND || payloadLen >= SERIAL_INPUT_BUFFER_SIZE) {
+        LOG_WARN("BLE CMD_ERR:FRAME");
+        return;
       }
+      frame[FRAME_HEADER_SIZE + payloadLen] = '\0';
+      command = String((const char*)&frame[FRAME_HEADER_SIZE]);
+    } else {
+      command = String(value.c_str());
+    }
+    command.trim(); // Remove whitespace and newlines
+    
+    LOG_DEBUG("BLE %d CMD: %s", slot, command.c_str());
+    
+    // Hand the command to the game task (runs in the BLE task)
+    if (command == "CORRECT") {
+      postGameEvent(EVT_CORRECT, SOURCE_BLE);
+    } else if (command == "WRONG") {
+      postGameEvent(EVT_WRONG, SOURCE_BLE);
+    } else if (command == "RESET") {
+      postGameEvent(EVT_RESET, SOURCE_BLE);
+    } else if (command == "STATS") {
+      postBleEvent(EVT_STATS, slot);
+    } else if (command == "STATS_RESET") {
+      postBleEvent(EVT_STATS_RESET, slot);
+    } else if (command == "EXPORT") {
+      postBleEvent(EVT_EXPORT, slot);
+    } else if (command == "MODE TEXT" || command == "MODE BINARY") {
+      // Output switches in the I/O task so it never lands mid-way through a batch
+      LinkMode mode = command == "MODE BINARY" ? LINK_BINARY : LINK_TEXT;
+      bleConnections[slot].rxMode = mode;
+      postBleEvent(EVT_BLE_MODE, slot, mode);
+    } else if (command.startsWith("SUBSCRIBE ")) {
+      // 0 (an unknown name) is answered with CMD_ERR by the I/O task
+      postBleEvent(EVT_BLE_SUBSCRIBE, slot, parseSubscriptions(command.c_str() + 10));
+    } else if (command.length() > 0) {
+      LOG_WARN("BLE CMD_ERR:UNKNOWN:%s", command.c_str());
     }
   }
 };
 
-// Forward declarations
-void handleCorrectAnswer();
-void handleWrongAnswer();
-void handleFullReset();
-
 // ============================================================================
 // MESSAGE BRIDGING (Send to both Serial and BLE)
 // ============================================================================
 
-void sendToAllInterfaces(const String& message) {
+void sendToAllInterfaces(const char* message, size_t len, uint64_t timeUs) {
   // Always send to USB Serial
-  Serial.println(message);
-  
-  // Send to BLE if client connected
-  if (bleClientConnected && pTxCharacteristic != nullptr) {
-    String bleMessage = message + "\n";
-    pTxCharacteristic->setValue(bleMessage.c_str());
-    pTxCharacteristic->notify();
+  writeSerialRecord(FRAME_EVENT, timeUs, message, len);
+  queueToSerialHist.record(esp_timer_get_time() - (int64_t)timeUs);
+
+  // Batch for each subscribed BLE client (sent by flushBleTx)
+  uint8_t category = eventCategory(message, len);
+  for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+    BleClient& client = bleClients[i];
+    if (!client.connected || !client.notify || (client.subscriptions & category) == 0) {
+      continue;
+    }
+    if (!queueBleLine(client, FRAME_EVENT, timeUs, message, len)) {
+      LOG_WARN("BLE client %d TX buffer full, dropping message", i);
+    }
+  }
+}
+
+// I/O task: send every notification that is due, client by client. A client
+// the stack reports congested keeps its batch until the congestion clears.
+void flushBleTx() {
+  if (pTxCharacteristic == nullptr) return;
+  int64_t nowUs = esp_timer_get_time();
+
+  for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+    BleClient& client = bleClients[i];
+    if (!client.connected || client.congested) continue;
+    client.tx.setPayloadLimit(client.mtu - 3);
+
+    const uint8_t* chunk;
+    size_t len;
+    while (client.tx.due(nowUs, chunk, len)) {
+      esp_err_t err = esp_ble_gatts_send_indicate(
+          pBLEServer->getGattsIf(), client.connId, pTxCharacteristic->getHandle(),
+          len, (uint8_t*)chunk, false);
+      if (err != ESP_OK) {
+        // Stack out of buffers: keep the chunk and retry after a deadline
+        client.deferred++;
+        client.tx.holdOff(nowUs);
+        break;
+      }
+      // Bytes left over keep the batch's queue time (an upper bound)
+      queueToBleHist.record(nowUs - client.batchQueuedUs);
+      client.tx.consume(len);
+    }
+  }
+}
+
+void reportBleTx() {
+  uint8_t connected = 0;
+  for (const BleClient& client : bleClients) {
+    if (client.connected) connected++;
+  }
+  serialReply("BLE clients=%u/%u", connected, BLE_MAX_CLIENTS);
+
+  int64_t nowUs = esp_timer_get_time();
+  for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+    BleClient& client = bleClients[i];
+    if (!client.connected) continue;
+
+    char subs[48];
+    formatSubscriptions(client.subscriptions, subs, sizeof(subs));
+    serialReply("BLE_CLIENT:%d conn=%u mode=%s notify=%u subs=%s connected_s=%lu",
+                i, client.connId, client.mode == LINK_BINARY ? "BINARY" : "TEXT",
+                client.notify ? 1 : 0, subs,
+                (unsigned long)((nowUs - client.connectedUs) / 1000000));
+
+    // Throughput since the previous report
+    int64_t elapsedUs = nowUs - client.reportedAtUs;
+    uint32_t sent = client.tx.bytes() - client.reportedBytes;
+    uint32_t bytesPerS = elapsedUs > 0 ? (uint32_t)((uint64_t)sent * 1000000 / elapsedUs) : 0;
+    client.reportedBytes = client.tx.bytes();
+    client.reportedAtUs = nowUs;
+    serialReply("BLE_LINK:%d interval_ms=%u.%02u latency=%u mtu=%u payload=%u bytes_per_s=%lu",
+                i, client.interval * 125 / 100, client.interval * 125 % 100,
+                client.latency, client.mtu, client.tx.payloadLimit(),
+                (unsigned long)bytesPerS);
+    serialReply("BLE_TX:%d pending=%u messages=%u notifications=%u bytes=%u max_chunk=%u dropped=%u deferred=%u congested=%u",
+                i, client.tx.pendingBytes(), client.tx.messages(),
+                client.tx.notifications(), client.tx.bytes(), client.tx.maxChunk(),
+                client.tx.dropped(), client.deferred, client.congested ? 1 : 0);
   }
 }
 
@@ -138,62 +739,191 @@ void sendToAllInterfaces(const String& message) {
 // SERIAL MESSAGE QUEUE
 // ============================================================================
 
-void queueMessage(const String& msg) {
-  if (queueCount < MESSAGE_QUEUE_SIZE) {
-    messageQueue[queueTail] = msg;
-    queueTail = (queueTail + 1) % MESSAGE_QUEUE_SIZE;
-    queueCount++;
-  } else {
-    Serial.println("WARNING: Message queue full, dropping message");
+// printf-style; formats straight into the queue arena without allocating
+void queueMessage(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void queueMessage(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  xSemaphoreTake(messageQueueLock, portMAX_DELAY);
+  bool queued = messageQueue.vformat((uint64_t)esp_timer_get_time(), fmt, args);
+  xSemaphoreGive(messageQueueLock);
+  va_end(args);
+
+  if (!queued) {
+    LOG_WARN("Message queue full, dropping message");
+  } else if (ioTaskHandle != nullptr) {
+    xTaskNotifyGive(ioTaskHandle);
   }
 }
 
+// I/O task: each record is copied out under the lock, so a slow serial or BLE
+// write never holds up the game task
 void processMessageQueue() {
-  while (queueCount > 0) {
-    sendToAllInterfaces(messageQueue[queueHead]);
-    queueHead = (queueHead + 1) % MESSAGE_QUEUE_SIZE;
-    queueCount--;
+  char message[MESSAGE_MAX_LENGTH];
+  const char* record;
+  uint8_t len;
+  uint64_t timeUs;
+  for (;;) {
+    xSemaphoreTake(messageQueueLock, portMAX_DELAY);
+    bool found = messageQueue.peek(record, len, timeUs);
+    if (found) {
+      memcpy(message, record, len);
+      messageQueue.pop();
+    }
+    xSemaphoreGive(messageQueueLock);
+    if (!found) break;
+
+    sendToAllInterfaces(message, len, timeUs);
   }
 }
 
+// I/O task: the game task queues concurrently, so copy under the lock
+void reportMessageQueue() {
+  xSemaphoreTake(messageQueueLock, portMAX_DELAY);
+  uint16_t depth = messageQueue.size();
+  uint16_t used = messageQueue.usedBytes();
+  uint16_t highWater = messageQueue.highWater();
+  uint32_t dropped = messageQueue.dropped();
+  MessageRingBase::Policy policy = messageQueue.policy();
+  xSemaphoreGive(messageQueueLock);
+
+  serialReply("QUEUE depth=%u bytes=%u capacity=%u high_water=%u dropped=%u policy=%s",
+                depth, used, messageQueue.capacityBytes(), highWater, dropped,
+                policy == MessageRingBase::DROP_OLDEST ? "DROP_OLDEST" : "DROP_NEWEST");
+}
+
 // ============================================================================
-// LED CONTROL
+// NODE TRANSMIT
 // ============================================================================
 
-void sendLEDCommand(uint8_t nodeId, LEDState state) {
+// Unicast to a node, or broadcast (addressed by node_id) if it has no peer slot
+void sendToNode(uint8_t nodeId, const uint8_t* data, size_t len) {
   if (nodeId < 1 || nodeId > NUM_BUZZERS) return;
+  const uint8_t* mac = buzzerIsPeer[nodeId - 1] ? buzzerMACs[nodeId - 1] : broadcastMAC;
+  esp_now_send(mac, data, len);
+}
 
-  BuzzerMessage msg;
-  msg.node_id = nodeId;
-  msg.msg_type = MSG_LED_COMMAND;
-  msg.value = state;
-  msg.timestamp = millis();
-
-  esp_now_send(buzzerMACs[nodeId - 1], (uint8_t*)&msg, sizeof(msg));
-}
-
-void updateAllLEDs() {
-  for (uint8_t i = 1; i <= NUM_BUZZERS; i++) {
-    if (currentState == STATE_READY) {
-      // All LEDs on in ready state
-      sendLEDCommand(i, LED_ON);
-    } else if (currentState == STATE_LOCKED) {
-      // Selected buzzer blinks, others off
-      if (i == selectedBuzzer) {
-        sendLEDCommand(i, LED_BLINK);
-      } else {
-        sendLEDCommand(i, LED_OFF);
-      }
-    } else if (currentState == STATE_PARTIAL_LOCKOUT) {
-      // Selected buzzer blinks, locked buzzers off, active buzzers on
-      if (i == selectedBuzzer) {
-        sendLEDCommand(i, LED_BLINK);
-      } else if (lockedBuzzers & (1 << (i - 1))) {
-        sendLEDCommand(i, LED_OFF);
-      } else {
-        sendLEDCommand(i, LED_ON);
-      }
-    }
+void broadcastLEDState(const LedStateMessage& frame) {
+  esp_now_send(broadcastMAC, (const uint8_t*)&frame, sizeof(frame));
+}
+
+// ============================================================================
+// GAME STATE MACHINE
+// ============================================================================
+
+// The state machine and the link scheduler (lib/GameCore) have no hardware
+// dependencies; this adapter gives them the controller's clock, ESP-NOW
+// delivery and serial/BLE output.
+class ControllerGameIO : public GameClock, public GameTransport, public GameOutput,
+                         public LinkTransport {
+public:
+  int64_t nowUs() override { return esp_timer_get_time(); }
+
+  // One broadcast frame for all nodes instead of one unicast per node. Every
+  // connected node must acknowledge it; nodeLinks resends it by unicast to
+  // the ones that have not.
+  void publishLedState(const LedStateMessage& frame) override;
+
+  void sendStateSync(uint8_t nodeId, const StateSyncMessage& msg) override;
+
+  void sendHeartbeat(const HeartbeatMessage& msg) override {
+    // Nodes without a peer slot get theirs by broadcast, so it is addressed:
+    // only node_id answers, and the other nodes' heartbeat numbering is
+    // untouched
+    sendToNode(msg.node_id, (const uint8_t*)&msg, sizeof(msg));
+  }
+
+  void broadcastLedFrame(const LedStateMessage& frame) override {
+    broadcastLEDState(frame);
+  }
+
+  void resendLedFrame(uint8_t nodeId, const LedStateMessage& frame) override {
+    sendToNode(nodeId, (const uint8_t*)&frame, sizeof(frame));
+  }
+
+  void deliveryFailed(uint8_t nodeId, uint16_t seq) override {
+    LOG_WARN("LINK:%u no ACK for LED seq %u, giving up", nodeId, seq);
+  }
+
+  void report(const char* line) override { queueMessage("%s", line); }
+  void debug(const char* line) override { LOG_DEBUG("%s", line); }
+  bool debugEnabled() const override { return LOG_LEVEL >= LOG_LEVEL_DEBUG; }
+
+  void buzzed(uint8_t nodeId, uint64_t pressTimeUs, int64_t marginUs) override {
+    int64_t nowUs = esp_timer_get_time();
+    rxToLockHist.record(nowUs - pressRxUs[nodeId - 1]);
+    uint32_t margin = marginUs < 0 ? JOURNAL_NO_MARGIN
+                                   : (uint32_t)min(marginUs, (int64_t)JOURNAL_NO_MARGIN - 1);
+    journalEvent(JRN_BUZZ, nodeId, margin, nowUs);
+  }
+};
+
+ControllerGameIO gameIO;
+
+// Per-node LED state delivery (ACK tracking, RTT estimate, retransmit
+// timing), heartbeat loss, RSSI and adaptive timeout, and which heartbeats
+// can be skipped
+LinkScheduler<NUM_BUZZERS> nodeLinks(gameIO, gameIO, HEARTBEAT_MAX_SUPPRESSED);
+
+// Near-simultaneous presses are collected for a short window and resolved by
+// press time rather than arrival order (window 0 = first arrival wins).
+// The LED frame it publishes is re-sent with every heartbeat, so a lost
+// broadcast is repaired within one heartbeat interval.
+GameCore<NUM_BUZZERS> game(gameIO, gameIO, gameIO, ARBITRATION_WINDOW_MS * 1000UL);
+
+void ControllerGameIO::publishLedState(const LedStateMessage& frame) {
+  broadcastLEDState(frame);
+  journalGameState(); // Every transition ends here
+  lastGameActivity = millis();
+  nodeLinks.published(frame); // Disconnected nodes get a state sync when they reconnect
+}
+
+void ControllerGameIO::sendStateSync(uint8_t nodeId, const StateSyncMessage& msg) {
+  sendToNode(nodeId, (const uint8_t*)&msg, sizeof(msg));
+  nodeLinks.synced(nodeId, msg.led_seq);
+}
+
+// Game task only
+ArbitrationReport arbitrationReport() {
+  const PressArbiter<NUM_BUZZERS>& arbiter = game.arbiter();
+  ArbitrationReport report;
+  report.windowUs = arbiter.windowUs();
+  report.rounds = arbiter.rounds();
+  report.contested = arbiter.contested();
+  report.reordered = arbiter.reordered();
+  return report;
+}
+
+void reportArbitration(const ArbitrationReport& arbitration) {
+  serialReply("ARBITRATION window_ms=%u rounds=%u contested=%u reordered=%u",
+                arbitration.windowUs / 1000, arbitration.rounds,
+                arbitration.contested, arbitration.reordered);
+}
+
+// ============================================================================
+// LED DELIVERY
+// ============================================================================
+
+void handleAck(uint8_t nodeId, uint16_t seq, int64_t rxTimeUs) {
+  if (nodeId < 1 || nodeId > NUM_BUZZERS) return;
+  nodeLinks.onAck(nodeId, seq, rxTimeUs); // Also makes its next heartbeat skippable
+
+  // Recovery time: first confirmation of the boot-time LED state
+  int64_t& ackUs = recovery.ackUs[nodeId - 1];
+  if (ackUs == 0 && recovery.publishUs != 0 && !isNewerLedSeq(recovery.ledSeq, seq)) {
+    ackUs = rxTimeUs;
+  }
+}
+
+void reportLinks(const GameReport& report) {
+  for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+    const ReliableLink& link = report.nodes[i].link;
+    const ReplayWindow& presses = report.nodes[i].presses;
+    serialReply("LINK:%u sent=%u acked=%u retransmits=%u failed=%u mac_fail=%u srtt_us=%u rttvar_us=%u rto_us=%u pending=%u presses=%u press_dups=%u",
+                i + 1, link.sent(), link.acked(), link.retransmits(),
+                link.failures(), nodeSendFailures[i], link.srttUs(),
+                link.rttvarUs(), link.currentRtoUs(), link.isPending() ? 1 : 0,
+                presses.accepted(), presses.duplicates());
   }
 }
 
@@ -201,16 +931,28 @@ void updateAllLEDs() {
 // CONNECTION MONITORING & HEARTBEAT
 // ============================================================================
 
-void broadcastHeartbeat() {
-  BuzzerMessage msg;
-  msg.node_id = 0; // 0 = broadcast from controller
-  msg.msg_type = MSG_HEARTBEAT;
-  msg.value = 0;
-  msg.timestamp = millis();
+void handleTimeSync(uint8_t nodeId, int64_t t1, int64_t t2, int64_t t3, int64_t t4,
+                    const NodeStatus& status) {
+  if (nodeId < 1 || nodeId > NUM_BUZZERS) return;
+  uint8_t i = nodeId - 1;
 
-  // Send to each buzzer individually (more reliable than broadcast)
-  for (int i = 0; i < NUM_BUZZERS; i++) {
-    esp_now_send(buzzerMACs[i], (uint8_t*)&msg, sizeof(msg));
+  nodeClocks[i].addSample(t1, t2, t3, t4);
+  nodeLinks.onReply(nodeId, t1, status.rssi, status.flags);
+  nodeStatus[i] = status;
+  nodeStatusValid[i] = true;
+  nodeUptimeS[i] = (uint32_t)(t3 / 1000000);
+}
+
+void reportClockSync(const GameReport& report) {
+  for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+    const ClockSummary& clock = report.nodes[i].clock;
+    if (!clock.synced) {
+      serialReply("CLOCK:%u UNSYNCED", i + 1);
+      continue;
+    }
+    serialReply("CLOCK:%u offset=%lld drift=%.2f err=%u rtt=%u samples=%u",
+                  i + 1, (long long)clock.offsetUs, clock.driftPpm,
+                  clock.errorBoundUs, clock.bestRttUs, clock.samples);
   }
 }
 
@@ -218,196 +960,845 @@ void updateNodeConnection(uint8_t nodeId) {
   if (nodeId < 1 || nodeId > NUM_BUZZERS) return;
   
   unsigned long now = millis();
-  bool wasConnected = nodeConnected[nodeId - 1];
+  bool wasConnected = nodeLinks.isConnected(nodeId);
   nodeLastSeen[nodeId - 1] = now;
-  nodeConnected[nodeId - 1] = true;
+  nodeLinks.setConnected(nodeId, true);
 
   if (!wasConnected) {
     // Node reconnected
-    String msg = "RECONNECT:" + String(nodeId);
-    sendToAllInterfaces(msg);
+    queueMessage("RECONNECT:%u", nodeId);
+    journalEvent(JRN_CONNECT, nodeId, 0, esp_timer_get_time());
   }
 }
 
+// Each node's timeout follows its heartbeat loss (see link_quality.h)
 void checkNodeTimeouts() {
   unsigned long now = millis();
   
   for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
-    if (nodeConnected[i]) {
-      if (now - nodeLastSeen[i] > CONNECTION_TIMEOUT_MS) {
-        // Node timed out
-        nodeConnected[i] = false;
-        String msg = "DISCONNECT:" + String(i + 1);
-        sendToAllInterfaces(msg);
+    if (nodeLinks.isConnected(i + 1)) {
+      if (now - nodeLastSeen[i] > nodeLinks.quality(i + 1).timeoutMs(HEARTBEAT_INTERVAL_MS)) {
+        // Node timed out (no more retransmits until it reconnects)
+        nodeLinks.setConnected(i + 1, false);
+        queueMessage("DISCONNECT:%u", i + 1);
+        journalEvent(JRN_DISCONNECT, i + 1, now - nodeLastSeen[i], esp_timer_get_time());
       }
     }
   }
 }
 
-void sendStateSync(uint8_t nodeId) {
-  if (nodeId < 1 || nodeId > NUM_BUZZERS) return;
+// Two lines per node: link quality as measured here, and the status the
+// node last reported
+void reportHealth(const GameReport& report) {
+  for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+    const NodeReport& node = report.nodes[i];
+    const LinkQuality& quality = node.quality;
+    serialReply("HEALTH:%u connected=%u silent_ms=%u timeout_ms=%u loss=%.1f%% rssi_avg=%.1f hb_sent=%u hb_lost=%u hb_skipped=%u",
+                i + 1, node.connected ? 1 : 0, node.silentMs,
+                quality.timeoutMs(HEARTBEAT_INTERVAL_MS),
+                quality.lossRate() * 100.0f, quality.rssiAverage(),
+                quality.sent(), quality.lost(), quality.suppressed());
+    if (!node.statusValid) {
+      serialReply("STATUS:%u UNKNOWN", i + 1);
+      continue;
+    }
+    const NodeStatus& status = node.status;
+    serialReply("STATUS:%u rssi=%d hb_gaps=%u battery_mv=%u uptime_s=%u low_power=%u",
+                i + 1, status.rssi, status.hbGaps, status.batteryMv,
+                node.uptimeS, (status.flags & NODE_STATUS_LOW_POWER) ? 1 : 0);
+  }
+}
 
-  BuzzerMessage msg;
-  msg.node_id = nodeId;
-  msg.msg_type = MSG_STATE_SYNC;
-  msg.timestamp = millis();
-  
-  // Pack game state into value field:
-  // Bits 0-3: locked buzzers bitmask
-  // Bits 4-6: selected buzzer (0-4)
-  // Bit 7: game state mode (0=LOCKED, 1=PARTIAL_LOCKOUT)
-  msg.value = lockedBuzzers | (selectedBuzzer << 4);
-  if (currentState == STATE_PARTIAL_LOCKOUT) {
-    msg.value |= 0x80; // Set bit 7 for PARTIAL_LOCKOUT
+// ============================================================================
+// STATE PERSISTENCE
+// ============================================================================
+//
+// Every game transition is journaled to the NVS partition, so a controller
+// that browns out or is reset by the watchdog mid-round comes back in the
+// same state. The game task only drops the snapshot into a one-slot mailbox
+// (newest wins) and wakes the persist task, which does the flash write off
+// the press path. Records alternate between two keys and carry a journal
+// number and a CRC: a write cut short by a reset leaves the other slot
+// intact. NVS appends every write to its log-structured pages (wear
+// levelling), and transitions that leave the saved state unchanged (RESET in
+// READY, for instance) are not written at all.
+//
+// An NVS write pauses flash for a few ms (more when NVS has to erase a page),
+// so it waits for flashAccess to allow it: LOCKED, or no press and no
+// transition for FLASH_QUIET_MS. Until then only the newest snapshot is kept.
+
+const uint16_t PERSIST_MAGIC = 0x4753; // "GS"
+const char* const PERSIST_KEYS[2] = {"state0", "state1"};
+
+const char* const GAME_STATE_NAMES[] = {"READY", "LOCKED", "PARTIAL_LOCKOUT"};
+
+uint16_t persistRecordCrc(const PersistRecord& record) {
+  // Field by field: struct padding is not covered
+  const GameSnapshot& s = record.snapshot;
+  uint16_t crc = crc16Ccitt((const uint8_t*)&record.journalSeq, sizeof(record.journalSeq));
+  crc = crc16Ccitt(&s.state, sizeof(s.state), crc);
+  crc = crc16Ccitt(&s.selected, sizeof(s.selected), crc);
+  crc = crc16Ccitt((const uint8_t*)&s.ledSeq, sizeof(s.ledSeq), crc);
+  return crc16Ccitt((const uint8_t*)&s.locked, sizeof(s.locked), crc);
+}
+
+bool sameGameState(const GameSnapshot& a, const GameSnapshot& b) {
+  return a.state == b.state && a.selected == b.selected && a.locked == b.locked;
+}
+
+// Game task (and setup): hand the current state to the persist task
+void journalGameState() {
+  GameSnapshot snapshot = game.snapshot();
+  xSemaphoreTake(persistLock, portMAX_DELAY);
+  if (persistHasPending) persistStats.coalesced++;
+  persistPending = snapshot;
+  persistHasPending = true;
+  xSemaphoreGive(persistLock);
+  if (persistTaskHandle != nullptr) {
+    xTaskNotifyGive(persistTaskHandle);
   }
+}
 
-  esp_now_send(buzzerMACs[nodeId - 1], (uint8_t*)&msg, sizeof(msg));
-  
-  Serial.print("STATE_SYNC:");
-  Serial.print(nodeId);
-  Serial.print(" (state=");
-  Serial.print(currentState);
-  Serial.print(", selected=");
-  Serial.print(selectedBuzzer);
-  Serial.print(", locked=0x");
-  Serial.print(lockedBuzzers, HEX);
-  Serial.println(")");
+// Persist task: write one snapshot into the older slot
+void writeGameState(const GameSnapshot& snapshot) {
+  if (persistHaveWritten && sameGameState(snapshot, persistWritten)) {
+    xSemaphoreTake(persistLock, portMAX_DELAY);
+    persistStats.skipped++;
+    xSemaphoreGive(persistLock);
+    return;
+  }
+
+  PersistRecord record = {};
+  record.magic = PERSIST_MAGIC;
+  record.journalSeq = persistJournalSeq + 1;
+  record.snapshot = snapshot;
+  record.crc = persistRecordCrc(record);
+
+  int64_t startUs = esp_timer_get_time();
+  size_t written = statePrefs.putBytes(PERSIST_KEYS[record.journalSeq & 1], &record,
+                                       sizeof(record));
+  uint32_t writeUs = (uint32_t)(esp_timer_get_time() - startUs);
+  bool ok = written == sizeof(record);
+
+  // Stats are read by PERSIST on the I/O task
+  xSemaphoreTake(persistLock, portMAX_DELAY);
+  if (ok) {
+    persistJournalSeq = record.journalSeq;
+    persistStats.writes++;
+    persistStats.lastWriteUs = writeUs;
+    if (writeUs > persistStats.maxWriteUs) persistStats.maxWriteUs = writeUs;
+  } else {
+    persistStats.failed++;
+  }
+  xSemaphoreGive(persistLock);
+
+  if (!ok) {
+    LOG_ERROR("Saving game state failed (journal %u)", record.journalSeq);
+    return;
+  }
+  persistWritten = snapshot;
+  persistHaveWritten = true;
+}
+
+// Setup: open the journal and resume the newest valid record, if any
+bool restoreGameState() {
+  if (!statePrefs.begin(PERSIST_NAMESPACE, false)) {
+    LOG_ERROR("Opening NVS namespace %s failed, game state will not be saved",
+              PERSIST_NAMESPACE);
+    return false;
+  }
+
+  PersistRecord newest;
+  bool found = false;
+  for (const char* key : PERSIST_KEYS) {
+    PersistRecord record;
+    if (statePrefs.getBytes(key, &record, sizeof(record)) != sizeof(record) ||
+        record.magic != PERSIST_MAGIC || record.crc != persistRecordCrc(record)) {
+      continue;
+    }
+    if (!found || (int32_t)(record.journalSeq - newest.journalSeq) > 0) {
+      newest = record;
+      found = true;
+    }
+  }
+  if (!found) return false;
+
+  persistJournalSeq = newest.journalSeq;
+  if (!game.restore(newest.snapshot)) {
+    LOG_WARN("Saved game state (journal %u) is not valid, starting in READY",
+             newest.journalSeq);
+    return false;
+  }
+  persistWritten = newest.snapshot;
+  persistHaveWritten = true;
+  return true;
+}
+
+const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+  case ESP_RST_POWERON: return "POWERON";
+  case ESP_RST_EXT: return "EXTERNAL";
+  case ESP_RST_SW: return "SOFTWARE";
+  case ESP_RST_PANIC: return "PANIC";
+  case ESP_RST_INT_WDT: return "INT_WDT";
+  case ESP_RST_TASK_WDT: return "TASK_WDT";
+  case ESP_RST_WDT: return "WDT";
+  case ESP_RST_DEEPSLEEP: return "DEEPSLEEP";
+  case ESP_RST_BROWNOUT: return "BROWNOUT";
+  case ESP_RST_SDIO: return "SDIO";
+  default: return "UNKNOWN";
+  }
+}
+
+void reportPersist(const GameReport& report) {
+  xSemaphoreTake(persistLock, portMAX_DELAY);
+  PersistStats stats = persistStats;
+  uint32_t journalSeq = persistJournalSeq;
+  xSemaphoreGive(persistLock);
+  serialReply("PERSIST writes=%u skipped=%u coalesced=%u deferred=%u failed=%u journal=%u last_write_us=%u max_write_us=%u",
+              stats.writes, stats.skipped, stats.coalesced, stats.deferred, stats.failed,
+              journalSeq, stats.lastWriteUs, stats.maxWriteUs);
+
+  // Boot -> LED frame sent, and boot -> the last node confirming it
+  uint8_t acked = 0;
+  int64_t lastAckUs = 0;
+  for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+    int64_t ackUs = report.nodes[i].recoveryAckUs;
+    if (ackUs == 0) continue;
+    acked++;
+    if (ackUs > lastAckUs) lastAckUs = ackUs;
+  }
+  serialReply("RECOVERY reset=%s restored=%s publish_us=%u nodes_acked=%u/%u last_ack_us=%u",
+              resetReasonName(esp_reset_reason()),
+              recovery.restored ? GAME_STATE_NAMES[recovery.snapshot.state] : "NO",
+              (uint32_t)recovery.publishUs, acked, NUM_BUZZERS, (uint32_t)lastAckUs);
 }
 
 // ============================================================================
-// GAME STATE HANDLERS
+// EVENT JOURNAL
 // ============================================================================
+//
+// A disputed round can be replayed from flash: every press (with its arrival
+// time and how long it took to arrive), arbitration decision, host command
+// and node connect/disconnect goes into the event journal (event_journal.h)
+// in the spiffs partition, used raw as a ring of sectors.
+//
+// The game task only appends to a RAM buffer. The persist task writes the
+// buffer a flash page at a time and erases the next sector ahead of time.
+// Programming and erasing flash pause code running from flash on both cores,
+// so the game task tells the persist task when that is acceptable
+// (flashAccess): while the game is LOCKED (presses are ignored anyway) or
+// quiet for FLASH_QUIET_MS, whatever the arbitration window. Then records
+// wait at most JOURNAL_FLUSH_MS. While presses are accepted the RAM buffer
+// absorbs them; only when it is about to overflow does the persist task write
+// a page, and never an erase: if the head sector is full and the next one is
+// not erased yet, records are dropped and counted instead. Nothing is written
+// while an arbitration round is open, and flashAccess is checked again
+// before every page.
+//
+// EXPORT streams the journal, oldest record first, to the link it came from
+// (serial or BLE), only as fast as that link's output buffer drains.
+
+// RAM buffer level at which a deferred journal is written anyway
+const uint32_t JOURNAL_PRESSURE = JOURNAL_BUFFER_SIZE * 3 / 4;
+
+// Game task (and setup): queue one record, wake the persist task when the
+// buffer starts filling, when a flash page's worth is waiting and when it
+// nears overflow
+void journalEvent(uint8_t type, uint8_t id, uint32_t value, int64_t timeUs) {
+  if (!eventJournal.append(type, id, value, timeUs)) return;
+  uint32_t pending = eventJournal.pending();
+  if ((pending == 1 || pending == EventJournal::PAGE_RECORDS ||
+       pending == JOURNAL_PRESSURE) &&
+      persistTaskHandle != nullptr) {
+    xTaskNotifyGive(persistTaskHandle);
+  }
+}
 
-void handleBuzzerPress(uint8_t nodeId, uint32_t timestamp) {
-  if (nodeId < 1 || nodeId > NUM_BUZZERS) return;
+// Game task, once per pass: what the persist task may do to flash right now
+void updateFlashAccess() {
+  uint8_t access = FLASH_DEFER;
+  if (game.arbiter().isOpen()) {
+    access = FLASH_HOLD;
+  } else if (game.state() == STATE_LOCKED ||
+             millis() - lastGameActivity >= FLASH_QUIET_MS) {
+    access = FLASH_IDLE;
+  }
+  flashAccess.store(access, std::memory_order_relaxed);
+}
 
-  // Check if this buzzer is locked out
-  if (lockedBuzzers & (1 << (nodeId - 1))) {
-    Serial.print("Buzzer ");
-    Serial.print(nodeId);
-    Serial.println(" is locked out, ignoring press");
+// Persist task: one page at a time, each only if flashAccess still allows it.
+// When idle, write what is due and erase the next sector ahead of time.
+// Otherwise write only to keep the buffer from overflowing, without erasing.
+void serviceEventJournal() {
+  for (;;) {
+    uint8_t access = flashAccess.load(std::memory_order_relaxed);
+    int64_t nowUs = esp_timer_get_time();
+    if (access == FLASH_IDLE) {
+      if (eventJournal.flush(nowUs, JOURNAL_FLUSH_MS * 1000UL, true) > 0) continue;
+      if (!eventJournal.nextPrepared()) eventJournal.prepareNext();
+      return;
+    }
+    if (access == FLASH_DEFER && eventJournal.pending() >= JOURNAL_PRESSURE &&
+        eventJournal.flush(nowUs, 0, false) > 0) {
+      continue;
+    }
+    if (eventJournal.pending() > 0) journalDeferred++;
     return;
   }
+}
 
-  if (currentState == STATE_READY || currentState == STATE_PARTIAL_LOCKOUT) {
-    // Accept the press
-    selectedBuzzer = nodeId;
-    currentState = STATE_LOCKED;
-    lastPressTime = timestamp;
+bool journalNeedsService() {
+  return eventJournal.pending() > 0 ||
+         (eventJournal.isEnabled() && !eventJournal.nextPrepared());
+}
 
-    Serial.print("Buzzer ");
-    Serial.print(nodeId);
-    Serial.println(" pressed and locked in");
+// Records per FRAME_JOURNAL frame
+const uint8_t JOURNAL_EXPORT_FRAME_RECORDS = MESSAGE_MAX_LENGTH / sizeof(JournalRecord);
 
-    // Send to PC/BLE clients
-    queueMessage("BUZZ " + String(nodeId));
+// I/O task: EXPORT from serial or a BLE client
+void startJournalExport(uint8_t source, uint8_t client = 0) {
+  const char* error = nullptr;
+  if (!eventJournal.isEnabled()) {
+    error = "CMD_ERR:UNAVAILABLE:EXPORT";
+  } else if (journalExport.active) {
+    error = "CMD_ERR:BUSY:EXPORT";
+  }
+  if (source == SOURCE_BLE) {
+    bleReply(bleClients[client], "%s", error != nullptr ? error : "CMD_ACK:EXPORT");
+  } else {
+    serialReply("%s", error != nullptr ? error : "CMD_ACK:EXPORT");
+  }
+  if (error != nullptr) return;
+
+  journalExport.active = true;
+  journalExport.source = source;
+  journalExport.client = client;
+  journalExport.records = 0;
+  journalExport.startUs = esp_timer_get_time();
+  eventJournal.openCursor(journalExport.cursor);
+}
 
-    // Update LEDs: selected blinks, others off
-    updateAllLEDs();
-  } else if (currentState == STATE_LOCKED) {
-    // Already locked, ignore subsequent presses
-    Serial.print("System locked, ignoring press from buzzer ");
-    Serial.println(nodeId);
+// One line or frame of export output to the exporting link
+void writeExportRecord(uint8_t frameType, const char* payload, size_t len) {
+  uint64_t nowUs = (uint64_t)esp_timer_get_time();
+  if (journalExport.source == SOURCE_BLE) {
+    queueBleLine(bleClients[journalExport.client], frameType, nowUs, payload, len);
+  } else {
+    writeSerialRecord(frameType, nowUs, payload, len);
   }
 }
 
-void handleCorrectAnswer() {
-  if (selectedBuzzer == 0) {
-    Serial.println("No buzzer selected, ignoring CORRECT command");
+// I/O task, every pass: send as much of the journal as the link's output
+// buffer takes without blocking. Binary links get FRAME_JOURNAL frames of
+// raw records, text links one JOURNAL: line per record.
+void pumpJournalExport() {
+  if (!journalExport.active) return;
+  bool toBle = journalExport.source == SOURCE_BLE;
+  BleClient& client = bleClients[journalExport.client];
+  if (toBle && !client.connected) {
+    journalExport.active = false; // Client gone
     return;
   }
+  bool binary = (toBle ? client.mode : serialMode) == LINK_BINARY;
+  EventJournal::Cursor& cursor = journalExport.cursor;
+
+  for (;;) {
+    size_t room = toBle ? client.tx.freeBytes() : (size_t)Serial.availableForWrite();
+    if (room < frameEncodedSize(MESSAGE_MAX_LENGTH)) return;
+
+    bool more;
+    if (binary) {
+      JournalRecord batch[JOURNAL_EXPORT_FRAME_RECORDS];
+      uint8_t count = 0;
+      while (count < JOURNAL_EXPORT_FRAME_RECORDS && eventJournal.next(cursor, batch[count])) {
+        count++;
+      }
+      if (count > 0) {
+        writeExportRecord(FRAME_JOURNAL, (const char*)batch, count * sizeof(JournalRecord));
+        journalExport.records += count;
+      }
+      more = count == JOURNAL_EXPORT_FRAME_RECORDS;
+    } else {
+      JournalRecord record;
+      more = eventJournal.next(cursor, record);
+      if (more) {
+        char line[MESSAGE_MAX_LENGTH + 1];
+        int n = snprintf(line, sizeof(line), "JOURNAL:%llu,%s,%u,%u",
+                         (unsigned long long)record.timeUs, journalTypeName(record.type),
+                         record.id, record.value);
+        writeExportRecord(FRAME_RESPONSE, line, min((size_t)n, sizeof(line) - 1));
+        journalExport.records++;
+      }
+    }
+    if (!more) break;
+  }
 
-  Serial.println("CORRECT answer - resetting to READY");
-  
-  // Reset to ready state
-  currentState = STATE_READY;
-  selectedBuzzer = 0;
-  lockedBuzzers = 0;
+  char line[MESSAGE_MAX_LENGTH + 1];
+  int n = snprintf(line, sizeof(line), "EXPORT_END records=%u bad=%u lost_sectors=%u duration_ms=%u",
+                   journalExport.records, cursor.bad, cursor.lost,
+                   (uint32_t)((esp_timer_get_time() - journalExport.startUs) / 1000));
+  writeExportRecord(FRAME_RESPONSE, line, min((size_t)n, sizeof(line) - 1));
+  journalExport.active = false;
+}
+
+void reportJournal() {
+  if (!eventJournal.isEnabled()) {
+    serialReply("JOURNAL disabled");
+    return;
+  }
+  serialReply("JOURNAL sectors=%u records_per_sector=%u head_seq=%u head_slot=%u next_erased=%u pending=%u capacity=%u high_water=%u",
+              eventJournal.sectors(), EventJournal::SLOTS, eventJournal.headSeq(),
+              eventJournal.headSlot(), eventJournal.nextPrepared() ? 1 : 0,
+              eventJournal.pending(), eventJournal.bufferCapacity(),
+              eventJournal.bufferHighWater());
+  serialReply("JOURNAL_IO written=%u dropped=%u failed=%u erases=%u deferred=%u blocked=%u max_write_us=%u max_erase_us=%u",
+              eventJournal.written(), eventJournal.dropped(), eventJournal.failed(),
+              eventJournal.erases(), journalDeferred, eventJournal.blocked(),
+              eventJournal.maxWriteUs(),
+              eventJournal.maxEraseUs());
+}
 
-  // Send to PC/BLE clients
-  queueMessage("CORRECT");
+// ============================================================================
+// LATENCY STATISTICS
+// ============================================================================
+
+struct NamedHistogram {
+  const char* name;
+  LatencyHistogram* hist;
+};
+
+const NamedHistogram latencyStats[] = {
+  {"rx_to_apply", &rxToApplyHist},
+  {"rx_to_lock", &rxToLockHist},
+  {"queue_to_serial", &queueToSerialHist},
+  {"queue_to_ble", &queueToBleHist},
+};
 
-  // All LEDs on
-  updateAllLEDs();
+// One line per histogram, to serial (toBle == nullptr) or to one BLE client
+void reportStats(BleClient* toBle) {
+  for (const NamedHistogram& stat : latencyStats) {
+    LatencyHistogram::Summary s = stat.hist->summarize();
+    char line[MESSAGE_MAX_LENGTH + 1];
+    snprintf(line, sizeof(line), "STATS:%s n=%u p50_us=%u p90_us=%u p99_us=%u max_us=%u",
+             stat.name, s.count, s.p50, s.p90, s.p99, s.max);
+    if (toBle != nullptr) {
+      bleReply(*toBle, "%s", line);
+    } else {
+      serialReply("%s", line);
+    }
+  }
 }
 
-void handleWrongAnswer() {
-  if (selectedBuzzer == 0) {
-    Serial.println("No buzzer selected, ignoring WRONG command");
+// I/O task: clear every histogram in the task that records it. The game task
+// clears its own on EVT_STATS_RESET and answers like a report request. False
+// if it did not answer in time (its histograms may still be cleared later).
+bool resetStats() {
+  if (!requestGameReport(EVT_STATS_RESET)) return false;
+  queueToSerialHist.reset();
+  queueToBleHist.reset();
+  return true;
+}
+
+// ============================================================================
+// GAME STATE REPORTS
+// ============================================================================
+//
+// CLOCK, LINKS, HEALTH, ARBITRATION and PERSIST describe state that the game
+// task updates on every frame, so the I/O task running the command must not
+// read it directly. It posts EVT_REPORT and waits; the game task copies what
+// the reports need into gameReport (microseconds, nothing is formatted) and
+// gives reportReady. Formatting and serial output stay on the I/O task.
+//
+// A request the I/O task gave up on is skipped by the game task, and a late
+// answer to it is recognized by its id, so gameReport is never rewritten
+// while the I/O task reads it. Commands that change game-task state (setting
+// the arbitration window) go the same way: the game task applies the change,
+// then fills gameReport, and the I/O task acknowledges from that.
+
+// Game task: answer request `id` unless a newer one replaced it
+void fillGameReport(uint32_t id) {
+  if (id != reportRequested.load(std::memory_order_relaxed)) return;
+
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+    NodeReport& node = gameReport.nodes[i];
+    const ClockSync& clock = nodeClocks[i];
+    node.clock.synced = clock.isSynced();
+    node.clock.offsetUs = clock.offsetUs();
+    node.clock.driftPpm = clock.driftPpm();
+    node.clock.errorBoundUs = clock.errorBoundUs();
+    node.clock.bestRttUs = clock.bestRttUs();
+    node.clock.samples = clock.sampleCount();
+    node.link = nodeLinks.delivery(i + 1);
+    node.presses = pressWindows[i];
+    node.quality = nodeLinks.quality(i + 1);
+    node.status = nodeStatus[i];
+    node.statusValid = nodeStatusValid[i];
+    node.uptimeS = nodeUptimeS[i];
+    node.connected = nodeLinks.isConnected(i + 1);
+    node.silentMs = (uint32_t)(now - nodeLastSeen[i]);
+    node.recoveryAckUs = recovery.ackUs[i];
+  }
+  gameReport.arbitration = arbitrationReport();
+
+  reportFilled.store(id, std::memory_order_release);
+  xSemaphoreGive(reportReady);
+}
+
+// I/O task: refresh gameReport, after the game task has applied `type` (an
+// event that ends in fillGameReport()). False if the game task did not answer
+// within REPORT_TIMEOUT_MS.
+bool requestGameReport(uint8_t type, uint8_t arg) {
+  uint32_t id = reportRequested.load(std::memory_order_relaxed) + 1;
+  reportRequested.store(id, std::memory_order_relaxed);
+
+  GameEvent event = {};
+  event.type = type;
+  event.source = SOURCE_SERIAL;
+  event.arg = arg;
+  event.postedUs = esp_timer_get_time();
+  event.nodeTimes[0] = id;
+  if (!postGameEvent(event)) return false;
+
+  TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(REPORT_TIMEOUT_MS);
+  for (;;) {
+    TickType_t left = deadline - xTaskGetTickCount();
+    if ((int32_t)left <= 0 || xSemaphoreTake(reportReady, left) != pdTRUE) {
+      return false;
+    }
+    if (reportFilled.load(std::memory_order_acquire) == id) return true;
+    // Late answer to an abandoned request: keep waiting for ours
+  }
+}
+
+// I/O task: acknowledge a report command and print it from a fresh copy
+void replyGameReport(const char* name, void (*report)(const GameReport&),
+                     uint8_t type = EVT_REPORT, uint8_t arg = 0) {
+  if (!requestGameReport(type, arg)) {
+    serialReply("CMD_ERR:TIMEOUT:%s", name);
     return;
   }
+  serialReply("CMD_ACK:%s", name);
+  report(gameReport);
+}
 
-  Serial.print("WRONG answer from buzzer ");
-  Serial.print(selectedBuzzer);
-  Serial.println(" - entering PARTIAL_LOCKOUT");
+void reportArbitration(const GameReport& report) {
+  reportArbitration(report.arbitration);
+}
 
-  // Lock out the wrong buzzer
-  lockedBuzzers |= (1 << (selectedBuzzer - 1));
-  
-  // Check if all buzzers are now locked
-  if (lockedBuzzers == 0x0F) { // All 4 buzzers locked (bits 0-3 set)
-    Serial.println("All buzzers locked out, resetting to READY");
-    currentState = STATE_READY;
-    selectedBuzzer = 0;
-    lockedBuzzers = 0;
-  } else {
-    // Enter partial lockout state
-    currentState = STATE_PARTIAL_LOCKOUT;
-    selectedBuzzer = 0; // Clear selection so another buzzer can try
+// ============================================================================
+// GAME EVENT QUEUE
+// ============================================================================
+
+// Posted from any task (WiFi, BLE, I/O); wakes the game task
+bool postGameEvent(const GameEvent& event) {
+  bool queued = gameEvents.push(event);
+  if (gameTaskHandle != nullptr) {
+    xTaskNotifyGive(gameTaskHandle);
   }
+  return queued;
+}
+
+bool postGameEvent(uint8_t type, uint8_t source, uint8_t arg) {
+  GameEvent event = {};
+  event.type = type;
+  event.source = source;
+  event.arg = arg;
+  event.postedUs = esp_timer_get_time();
+  return postGameEvent(event);
+}
 
-  // Send to PC/BLE clients
-  queueMessage("WRONG");
+// Posted from the BLE task; wakes the I/O task
+bool postIoEvent(const GameEvent& event) {
+  bool queued = ioEvents.push(event);
+  if (!queued) LOG_WARN("I/O event queue full, dropping event %u", event.type);
+  if (ioTaskHandle != nullptr) {
+    xTaskNotifyGive(ioTaskHandle);
+  }
+  return queued;
+}
 
-  // Update LEDs
-  updateAllLEDs();
+bool postBleEvent(uint8_t type, uint8_t client, uint8_t arg, int64_t value) {
+  GameEvent event = {};
+  event.type = type;
+  event.source = SOURCE_BLE;
+  event.client = client;
+  event.arg = arg;
+  event.postedUs = esp_timer_get_time();
+  event.nodeTimes[0] = value;
+  return postIoEvent(event);
 }
 
-void handleFullReset() {
-  Serial.println("FULL RESET - clearing all state");
+void applyGameEvent(const GameEvent& event) {
+  switch (event.type) {
+  case EVT_BUZZER_PRESS: {
+    updateNodeConnection(event.nodeId);
+    if (event.nodeId < 1 || event.nodeId > NUM_BUZZERS) break;
+
+    // Map the node's edge time into controller time so presses from
+    // different nodes are comparable. Until the node has completed a sync
+    // exchange, the arrival time is the best we have.
+    int64_t pressTimeUs = event.rxTimeUs;
+    if (nodeClocks[event.nodeId - 1].isSynced()) {
+      pressTimeUs = nodeClocks[event.nodeId - 1].toController(event.nodeTimes[0]);
+    }
+    // A mapped press just after its arrival is clock estimate error: 0
+    int64_t ageUs = event.rxTimeUs - pressTimeUs;
+    uint32_t pressAgeUs = ageUs <= 0 ? 0 : ageUs >= UINT32_MAX ? UINT32_MAX : (uint32_t)ageUs;
+
+    // A resent press whose first copy already arrived
+    if (!pressWindows[event.nodeId - 1].accept((uint32_t)event.nodeTimes[1])) {
+      LOG_DEBUG("Duplicate press %u from buzzer %u ignored",
+               (uint32_t)event.nodeTimes[1], event.nodeId);
+      journalEvent(JRN_PRESS_DUP, event.nodeId, pressAgeUs, event.rxTimeUs);
+      break;
+    }
+
+    journalEvent(JRN_PRESS, event.nodeId, pressAgeUs, event.rxTimeUs);
+    lastGameActivity = millis();
+    pressRxUs[event.nodeId - 1] = event.rxTimeUs;
+    game.press(event.nodeId, (uint64_t)pressTimeUs, event.rxTimeUs);
+    break;
+  }
 
-  // Reset everything
-  currentState = STATE_READY;
-  selectedBuzzer = 0;
-  lockedBuzzers = 0;
+  case EVT_TIME_SYNC:
+    updateNodeConnection(event.nodeId);
+    handleTimeSync(event.nodeId, event.nodeTimes[0], event.nodeTimes[1],
+                   event.nodeTimes[2], event.rxTimeUs, event.status);
+    break;
 
-  // Send to PC/BLE clients
-  queueMessage("RESET");
+  case EVT_STATE_REQUEST:
+    updateNodeConnection(event.nodeId);
+    // Node is requesting current game state (reconnection)
+    LOG_INFO("State request from node %u", event.nodeId);
+    game.syncNode(event.nodeId);
+    break;
+
+  case EVT_CORRECT:
+    journalEvent(JRN_COMMAND, JRN_CMD_CORRECT, event.source << 8, event.postedUs);
+    game.correct();
+    break;
+
+  case EVT_WRONG:
+    journalEvent(JRN_COMMAND, JRN_CMD_WRONG, event.source << 8, event.postedUs);
+    game.wrong();
+    break;
+
+  case EVT_RESET:
+    journalEvent(JRN_COMMAND, JRN_CMD_RESET, event.source << 8, event.postedUs);
+    game.reset();
+    break;
+
+  case EVT_ACK:
+    updateNodeConnection(event.nodeId);
+    handleAck(event.nodeId, (uint16_t)event.nodeTimes[0], event.rxTimeUs);
+    break;
+
+  case EVT_ARBITRATION:
+    journalEvent(JRN_COMMAND, JRN_CMD_ARBITRATION, event.source << 8 | event.arg,
+                 event.postedUs);
+    game.arbiter().setWindowUs((uint32_t)event.arg * 1000UL);
+    fillGameReport((uint32_t)event.nodeTimes[0]);
+    break;
+
+  case EVT_STATS_RESET:
+    rxToApplyHist.reset();
+    rxToLockHist.reset();
+    fillGameReport((uint32_t)event.nodeTimes[0]);
+    break;
+
+  case EVT_REPORT:
+    fillGameReport((uint32_t)event.nodeTimes[0]);
+    break;
+  }
+}
 
-  // All LEDs on
-  updateAllLEDs();
+// Game task: apply every queued event to the state machine in order
+void processGameEvents() {
+  GameEvent event;
+  while (gameEvents.pop(event)) {
+    int64_t nowUs = esp_timer_get_time();
+    uint32_t delayUs = (uint32_t)(nowUs - event.postedUs);
+    if (delayUs > maxEventDelayUs.load(std::memory_order_relaxed)) {
+      maxEventDelayUs.store(delayUs, std::memory_order_relaxed);
+    }
+    if (event.source == SOURCE_ESPNOW) rxToApplyHist.record(nowUs - event.rxTimeUs);
+    applyGameEvent(event);
+  }
+}
+
+// I/O task: BLE link requests
+void processIoEvents() {
+  GameEvent event;
+  while (ioEvents.pop(event)) {
+    if (event.client >= BLE_MAX_CLIENTS) continue;
+    BleClient& client = bleClients[event.client];
+
+    switch (event.type) {
+    case EVT_BLE_CONNECT:
+      // A fresh slot: text mode, every event, silent until it enables notifications
+      client.connected = true;
+      client.connId = (uint16_t)event.nodeTimes[0];
+      client.mtu = (uint16_t)event.nodeTimes[1];
+      client.interval = (uint16_t)event.nodeTimes[2];
+      client.latency = (uint16_t)(event.nodeTimes[2] >> 16);
+      client.notify = false;
+      client.congested = false;
+      client.mode = LINK_TEXT;
+      client.frameSeq = 0;
+      client.subscriptions = SUB_ALL;
+      client.tx.clear();
+      client.tx.resetStats();
+      client.connectedUs = event.postedUs;
+      client.deferred = 0;
+      client.reportedBytes = 0;
+      client.reportedAtUs = event.postedUs;
+      break;
+
+    case EVT_BLE_DISCONNECT:
+      client.connected = false;
+      client.tx.clear();
+      if (journalExport.active && journalExport.source == SOURCE_BLE &&
+          journalExport.client == event.client) {
+        journalExport.active = false;
+      }
+      break;
+
+    case EVT_BLE_MTU:
+      client.mtu = (uint16_t)event.nodeTimes[0];
+      break;
+
+    case EVT_BLE_PARAMS:
+      client.interval = (uint16_t)event.nodeTimes[0];
+      client.latency = (uint16_t)(event.nodeTimes[0] >> 16);
+      break;
+
+    case EVT_BLE_NOTIFY:
+      client.notify = event.arg != 0;
+      if (!client.notify) client.tx.clear();
+      break;
+
+    case EVT_BLE_CONGEST:
+      client.congested = event.arg != 0;
+      break;
+
+    case EVT_BLE_MODE:
+      // Acknowledged in the new mode; earlier batched bytes keep their format
+      client.mode = (LinkMode)event.arg;
+      bleReply(client, "CMD_ACK:MODE");
+      break;
+
+    case EVT_BLE_SUBSCRIBE: {
+      if (event.arg == 0) {
+        bleReply(client, "CMD_ERR:SUBSCRIBE");
+        break;
+      }
+      client.subscriptions = event.arg;
+      char subs[48];
+      formatSubscriptions(client.subscriptions, subs, sizeof(subs));
+      bleReply(client, "CMD_ACK:SUBSCRIBE");
+      bleReply(client, "SUBSCRIBED:%s", subs);
+      break;
+    }
+
+    case EVT_STATS:
+      bleReply(client, "CMD_ACK:STATS");
+      reportStats(&client);
+      break;
+
+    case EVT_STATS_RESET:
+      if (resetStats()) {
+        bleReply(client, "CMD_ACK:STATS_RESET");
+      } else {
+        bleReply(client, "CMD_ERR:TIMEOUT:STATS_RESET");
+      }
+      break;
+
+    case EVT_EXPORT:
+      startJournalExport(SOURCE_BLE, event.client);
+      break;
+    }
+  }
+}
+
+void reportEventQueue() {
+  serialReply("EVENTS depth=%u capacity=%u high_water=%u dropped=%u malformed=%u max_delay_us=%u",
+                gameEvents.size(), gameEvents.capacity(), gameEvents.highWater(),
+                gameEvents.dropped(), malformedFrames,
+                maxEventDelayUs.load(std::memory_order_relaxed));
 }
 
 // ============================================================================
 // ESP-NOW CALLBACKS
 // ============================================================================
 
+// Runs in the WiFi task: decode, timestamp and queue - nothing else
 void onDataReceive(const uint8_t *mac, const uint8_t *data, int len) {
+  // Receive time: t4 of the clock sync exchange, fallback press time
+  int64_t rxTimeUs = esp_timer_get_time();
+
+  GameEvent event = {};
+  event.source = SOURCE_ESPNOW;
+  event.rxTimeUs = rxTimeUs;
+  event.postedUs = rxTimeUs;
+
+  // Heartbeat replies have their own layout
+  if (len == sizeof(TimeSyncMessage) && data[1] == MSG_TIME_SYNC) {
+    TimeSyncMessage sync;
+    memcpy(&sync, data, sizeof(sync));
+    event.type = EVT_TIME_SYNC;
+    event.nodeId = sync.node_id;
+    event.nodeTimes[0] = (int64_t)sync.t1_us;
+    event.nodeTimes[1] = (int64_t)sync.t2_us;
+    event.nodeTimes[2] = (int64_t)sync.t3_us;
+    event.status.rssi = sync.rssi;
+    event.status.flags = sync.flags;
+    event.status.hbGaps = sync.hb_gaps;
+    event.status.batteryMv = sync.battery_mv;
+    postGameEvent(event);
+    return;
+  }
+
+  if (len == sizeof(AckMessage) && data[1] == MSG_ACK) {
+    AckMessage ack;
+    memcpy(&ack, data, sizeof(ack));
+    event.type = EVT_ACK;
+    event.nodeId = ack.node_id;
+    event.nodeTimes[0] = ack.seq;
+    postGameEvent(event);
+    return;
+  }
+
   if (len != sizeof(BuzzerMessage)) {
-    Serial.println("ERROR: Received message with wrong size");
+    malformedFrames++;
     return;
   }
 
   BuzzerMessage msg;
   memcpy(&msg, data, sizeof(msg));
+  event.nodeId = msg.node_id;
 
-  // Update connection tracking for any message from a node
-  updateNodeConnection(msg.node_id);
-
-  // Process message based on type
   if (msg.msg_type == MSG_BUTTON_PRESS) {
-    handleBuzzerPress(msg.node_id, msg.timestamp);
+    event.type = EVT_BUZZER_PRESS;
+    event.nodeTimes[0] = (int64_t)msg.time_us;
+    event.nodeTimes[1] = msg.press_id;
   } else if (msg.msg_type == MSG_STATE_REQUEST) {
-    // Node is requesting current game state (reconnection)
-    Serial.print("State request from node ");
-    Serial.println(msg.node_id);
-    sendStateSync(msg.node_id);
+    event.type = EVT_STATE_REQUEST;
+  } else {
+    return;
   }
+  postGameEvent(event);
 }
 
 void onDataSent(const uint8_t *mac, esp_now_send_status_t status) {
-  // LED commands are fire-and-forget, no need to handle send status
-  // Could add retry logic here if needed
+  // Delivery is confirmed end-to-end by MSG_ACK; MAC-layer failures are only
+  // counted (the WiFi task is the sole writer of nodeSendFailures)
+  if (status == ESP_NOW_SEND_SUCCESS || memcmp(mac, MAC_BASE, 5) != 0) return;
+  uint8_t nodeId = mac[5];
+  if (nodeId >= 1 && nodeId <= NUM_BUZZERS) {
+    nodeSendFailures[nodeId - 1]++;
+  }
 }
 
 // ============================================================================
@@ -415,78 +1806,145 @@ void onDataSent(const uint8_t *mac, esp_now_send_status_t status) {
 // ============================================================================
 
 void handleControlButtons() {
+  unsigned long now = micros();
+
   // Handle CORRECT button
-  int correctReading = digitalRead(CTRL_BUTTON_CORRECT);
-  if (correctReading != lastCorrectState) {
-    lastCorrectDebounce = millis();
+  if (correctButton.update(digitalRead(CTRL_BUTTON_CORRECT), now) ==
+      Button::EVENT_PRESS) {
+    postGameEvent(EVT_CORRECT, SOURCE_BUTTON);
   }
-  if ((millis() - lastCorrectDebounce) > DEBOUNCE_DELAY_MS) {
-    if (correctReading == LOW) { // Button pressed (pullup)
-      handleCorrectAnswer();
-      while (digitalRead(CTRL_BUTTON_CORRECT) == LOW) delay(10); // Wait for release
-    }
-  }
-  lastCorrectState = correctReading;
 
   // Handle WRONG button
-  int wrongReading = digitalRead(CTRL_BUTTON_WRONG);
-  if (wrongReading != lastWrongState) {
-    lastWrongDebounce = millis();
-  }
-  if ((millis() - lastWrongDebounce) > DEBOUNCE_DELAY_MS) {
-    if (wrongReading == LOW) {
-      handleWrongAnswer();
-      while (digitalRead(CTRL_BUTTON_WRONG) == LOW) delay(10);
-    }
+  if (wrongButton.update(digitalRead(CTRL_BUTTON_WRONG), now) ==
+      Button::EVENT_PRESS) {
+    postGameEvent(EVT_WRONG, SOURCE_BUTTON);
   }
-  lastWrongState = wrongReading;
 
-  // Handle RESET button
-  int resetReading = digitalRead(CTRL_BUTTON_RESET);
-  if (resetReading != lastResetState) {
-    lastResetDebounce = millis();
-  }
-  if ((millis() - lastResetDebounce) > DEBOUNCE_DELAY_MS) {
-    if (resetReading == LOW) {
-      handleFullReset();
-      while (digitalRead(CTRL_BUTTON_RESET) == LOW) delay(10);
-    }
+  // Handle RESET button: fires on press by default; a full reset mid-round is
+  // destructive, so it can be configured to require a long press
+  // (CTRL_RESET_LONG_PRESS_MS)
+  Button::Event resetEvent = resetButton.update(digitalRead(CTRL_BUTTON_RESET), now);
+  Button::Event resetTrigger =
+      CTRL_RESET_LONG_PRESS_MS > 0 ? Button::EVENT_LONG_PRESS : Button::EVENT_PRESS;
+  if (resetEvent == resetTrigger) {
+    postGameEvent(EVT_RESET, SOURCE_BUTTON);
   }
-  lastResetState = resetReading;
 }
 
 // ============================================================================
 // SERIAL COMMAND INPUT
 // ============================================================================
 
+void executeSerialCommand(String command) {
+  command.trim(); // Remove any whitespace
+  
+  if (command == "CORRECT") {
+    serialReply("CMD_ACK:CORRECT");
+    postGameEvent(EVT_CORRECT, SOURCE_SERIAL);
+  } else if (command == "WRONG") {
+    serialReply("CMD_ACK:WRONG");
+    postGameEvent(EVT_WRONG, SOURCE_SERIAL);
+  } else if (command == "RESET") {
+    serialReply("CMD_ACK:RESET");
+    postGameEvent(EVT_RESET, SOURCE_SERIAL);
+  } else if (command == "MODE TEXT" || command == "MODE BINARY") {
+    // Acknowledged in the new mode
+    serialMode = command == "MODE BINARY" ? LINK_BINARY : LINK_TEXT;
+    serialReply("CMD_ACK:MODE");
+  } else if (command == "CLOCK") {
+    replyGameReport("CLOCK", reportClockSync);
+  } else if (command == "QUEUE") {
+    serialReply("CMD_ACK:QUEUE");
+    reportMessageQueue();
+  } else if (command == "QUEUE DROP_OLDEST" || command == "QUEUE DROP_NEWEST") {
+    xSemaphoreTake(messageQueueLock, portMAX_DELAY);
+    messageQueue.setPolicy(command == "QUEUE DROP_OLDEST" ? MessageRingBase::DROP_OLDEST
+                                                          : MessageRingBase::DROP_NEWEST);
+    xSemaphoreGive(messageQueueLock);
+    serialReply("CMD_ACK:QUEUE");
+    reportMessageQueue();
+  } else if (command == "LOG") {
+    serialReply("CMD_ACK:LOG");
+    reportLog();
+  } else if (command == "TASKS") {
+    serialReply("CMD_ACK:TASKS");
+    reportTasks();
+  } else if (command == "STATS") {
+    serialReply("CMD_ACK:STATS");
+    reportStats(nullptr);
+  } else if (command == "STATS_RESET") {
+    if (resetStats()) {
+      serialReply("CMD_ACK:STATS_RESET");
+    } else {
+      serialReply("CMD_ERR:TIMEOUT:STATS_RESET");
+    }
+  } else if (command == "EVENTS") {
+    serialReply("CMD_ACK:EVENTS");
+    reportEventQueue();
+  } else if (command == "PERSIST") {
+    replyGameReport("PERSIST", reportPersist);
+  } else if (command == "JOURNAL") {
+    serialReply("CMD_ACK:JOURNAL");
+    reportJournal();
+  } else if (command == "EXPORT") {
+    startJournalExport(SOURCE_SERIAL);
+  } else if (command == "HEALTH") {
+    replyGameReport("HEALTH", reportHealth);
+  } else if (command == "LINKS") {
+    replyGameReport("LINKS", reportLinks);
+  } else if (command == "BLE") {
+    serialReply("CMD_ACK:BLE");
+    reportBleTx();
+  } else if (command == "ARBITRATION") {
+    replyGameReport("ARBITRATION", reportArbitration);
+  } else if (command.startsWith("ARBITRATION ")) {
+    long windowMs = command.substring(12).toInt();
+    if (windowMs < 0 || windowMs > ARBITRATION_MAX_WINDOW_MS) {
+      serialReply("CMD_ERR:RANGE:%s", command.c_str());
+    } else {
+      // Applied by the game task, acknowledged with the new window
+      replyGameReport("ARBITRATION", reportArbitration, EVT_ARBITRATION, (uint8_t)windowMs);
+    }
+  } else if (command.length() > 0) {
+    // Unknown command
+    serialReply("CMD_ERR:UNKNOWN:%s", command.c_str());
+  }
+}
+
+// Binary mode: serialInputBuffer holds one COBS frame (delimiter stripped)
+void executeSerialFrame() {
+  uint8_t frame[SERIAL_INPUT_BUFFER_SIZE];
+  size_t payloadLen = 0;
+  if (!decodeFrame((const uint8_t*)serialInputBuffer, serialInputIndex, frame,
+                   payloadLen) ||
+      frame[0] != FRAME_COMMAND) {
+    serialReply("CMD_ERR:FRAME");
+    return;
+  }
+
+  // Payload is the command text; reuse the input buffer for it
+  memcpy(serialInputBuffer, &frame[FRAME_HEADER_SIZE], payloadLen);
+  serialInputBuffer[payloadLen] = '\0';
+  executeSerialCommand(String(serialInputBuffer));
+}
+
 void handleSerialInput() {
   while (Serial.available() > 0) {
     char c = Serial.read();
     
-    // Handle newline characters (command terminator)
-    if (c == '\n' || c == '\r') {
+    // Text mode: commands end with a newline. Binary mode: frames end with
+    // 0x00 (newlines can appear inside a frame).
+    bool terminator = serialMode == LINK_BINARY ? (c == '\0')
+                                                : (c == '\n' || c == '\r');
+    if (terminator) {
       // Only process if buffer has content
       if (serialInputIndex > 0) {
-        // Null-terminate the command string
-        serialInputBuffer[serialInputIndex] = '\0';
-        
-        // Parse and execute the command
-        String command(serialInputBuffer);
-        command.trim(); // Remove any whitespace
-        
-        if (command == "CORRECT") {
-          Serial.println("CMD_ACK:CORRECT");
-          handleCorrectAnswer();
-        } else if (command == "WRONG") {
-          Serial.println("CMD_ACK:WRONG");
-          handleWrongAnswer();
-        } else if (command == "RESET") {
-          Serial.println("CMD_ACK:RESET");
-          handleFullReset();
-        } else if (command.length() > 0) {
-          // Unknown command
-          Serial.print("CMD_ERR:UNKNOWN:");
-          Serial.println(command);
+        if (serialMode == LINK_BINARY) {
+          executeSerialFrame();
+        } else {
+          // Null-terminate the command string
+          serialInputBuffer[serialInputIndex] = '\0';
+          executeSerialCommand(String(serialInputBuffer));
         }
         
         // Reset buffer for next command
@@ -498,7 +1956,7 @@ void handleSerialInput() {
         serialInputBuffer[serialInputIndex++] = c;
       } else {
         // Buffer overflow - discard and report error
-        Serial.println("CMD_ERR:BUFFER_OVERFLOW");
+        serialReply("CMD_ERR:BUFFER_OVERFLOW");
         serialInputIndex = 0;
       }
     }
@@ -510,10 +1968,8 @@ void handleSerialInput() {
 // ============================================================================
 
 void initBLE() {
-  Serial.println("========================================");
-  Serial.println("INITIALIZING BLE");
-  Serial.println("========================================");
-  
+  LOG_INFO("Initializing BLE");
+
   // Get MAC address to create unique device name
   uint8_t mac[6];
   esp_wifi_get_mac(WIFI_IF_STA, mac);
@@ -524,12 +1980,16 @@ void initBLE() {
            BLE_DEVICE_NAME, mac[4], mac[5]);
   bleDeviceName = String(deviceName);
   
-  Serial.print("BLE Device Name: ");
-  Serial.println(bleDeviceName);
+  LOG_INFO("BLE device name: %s", deviceName);
   
-  // Initialize BLE
+  // Initialize BLE (MTU is what we offer; the client picks the final value)
   BLEDevice::init(bleDeviceName.c_str());
+  BLEDevice::setMTU(BLE_MTU_SIZE);
   
+  // Per-connection CCCD writes, congestion and connection parameters
+  BLEDevice::setCustomGattsHandler(bleGattsEvent);
+  BLEDevice::setCustomGapHandler(bleGapEvent);
+
   // Create BLE Server
   pBLEServer = BLEDevice::createServer();
   pBLEServer->setCallbacks(new ServerCallbacks());
@@ -542,7 +2002,8 @@ void initBLE() {
     BLE_TX_CHAR_UUID,
     BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_READ
   );
-  pTxCharacteristic->addDescriptor(new BLE2902()); // Enable notifications
+  pTxCccd = new BLE2902(); // Enable notifications (tracked per client by bleGattsEvent)
+  pTxCharacteristic->addDescriptor(pTxCccd);
   
   // Create RX Characteristic (Client -> ESP32, write)
   pRxCharacteristic = pService->createCharacteristic(
@@ -553,7 +2014,7 @@ void initBLE() {
   
   // Start service
   pService->start();
-  Serial.println("✓ BLE service started");
+  LOG_INFO("BLE service started");
   
   // Configure advertising
   BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
@@ -564,9 +2025,195 @@ void initBLE() {
   
   // Start advertising
   BLEDevice::startAdvertising();
-  Serial.println("✓ BLE advertising started");
-  Serial.println("Clients can now connect via BLE");
-  Serial.println("========================================");
+  LOG_INFO("BLE advertising started, up to %u clients can connect", BLE_MAX_CLIENTS);
+}
+
+// ============================================================================
+// TASKS
+// ============================================================================
+//
+// Game task (core 1, high priority): input events, arbitration, LED
+// retransmits, heartbeats and node timeouts. The radio stacks live on core 0,
+// so a streaming BLE client cannot delay press handling.
+// I/O task (core 0): control buttons, serial input, BLE link requests and
+// draining the message queue to serial/BLE.
+// Log task (core 0, idle priority): drains the log ring (log.h) to serial,
+// so no other task ever waits on the UART for a log line.
+// Persist task (core 0, low priority): all flash writes, i.e. the game state
+// (STATE PERSISTENCE) and the event journal (EVENT JOURNAL).
+//
+// Both block on their task notification. Every posted event wakes the game
+// task and every queued message wakes the I/O task; the timeouts only cover
+// timers (arbitration window, retransmits, heartbeats, button polling).
+//
+// TASKS reports each task's CPU share since the previous report, wakeups,
+// longest pass and peak stack use. The report runs in the I/O task and reads
+// the game task's counters without locking (diagnostics only).
+
+struct TaskStats {
+  const char* name;
+  TaskHandle_t* handle;
+  uint8_t core;
+  uint32_t stackSize;
+  volatile uint32_t busyUs;    // Time spent in passes (wraps after ~71 min)
+  volatile uint32_t wakeups;
+  volatile uint32_t maxPassUs; // Longest single pass
+  uint32_t reportedBusyUs;     // busyUs at the previous TASKS report
+  int64_t reportedAtUs;
+};
+
+TaskStats gameTaskStats = {"game", &gameTaskHandle, GAME_TASK_CORE, GAME_TASK_STACK_SIZE,
+                           0, 0, 0, 0, 0};
+TaskStats ioTaskStats = {"io", &ioTaskHandle, IO_TASK_CORE, IO_TASK_STACK_SIZE,
+                         0, 0, 0, 0, 0};
+TaskStats logTaskStats = {"log", &logTaskHandle, LOG_TASK_CORE, LOG_TASK_STACK_SIZE,
+                          0, 0, 0, 0, 0};
+TaskStats persistTaskStats = {"persist", &persistTaskHandle, PERSIST_TASK_CORE,
+                              PERSIST_TASK_STACK_SIZE, 0, 0, 0, 0, 0};
+
+void recordTaskPass(TaskStats& stats, int64_t startUs) {
+  uint32_t passUs = (uint32_t)(esp_timer_get_time() - startUs);
+  stats.busyUs += passUs;
+  stats.wakeups++;
+  if (passUs > stats.maxPassUs) stats.maxPassUs = passUs;
+}
+
+// Sleep one tick while an arbitration round or an ACK is pending, otherwise
+// until woken, the next heartbeat or the next housekeeping pass. Heartbeats
+// stay on their period because low-power nodes only listen around them.
+TickType_t gameTaskTimeout() {
+  if (game.arbiter().isOpen() || nodeLinks.isPending()) return 1;
+  unsigned long sinceHeartbeat = millis() - lastHeartbeatTime;
+  unsigned long idleMs = sinceHeartbeat >= HEARTBEAT_INTERVAL_MS
+                             ? 0 : HEARTBEAT_INTERVAL_MS - sinceHeartbeat;
+  if (idleMs > GAME_TASK_IDLE_MS) idleMs = GAME_TASK_IDLE_MS;
+  TickType_t ticks = pdMS_TO_TICKS(idleMs);
+  return ticks > 0 ? ticks : 1;
+}
+
+void gameTask(void* param) {
+  for (;;) {
+    int64_t startUs = esp_timer_get_time();
+
+    processGameEvents();
+    game.poll();
+    nodeLinks.retransmit(game.ledFrame());
+
+    unsigned long now = millis();
+    if (now - lastHeartbeatTime >= HEARTBEAT_INTERVAL_MS) {
+      nodeLinks.heartbeat(game.ledFrame());
+      lastHeartbeatTime = now;
+    }
+
+    // Check for node timeouts (after queued node traffic has been applied)
+    checkNodeTimeouts();
+    updateFlashAccess();
+
+    recordTaskPass(gameTaskStats, startUs);
+    ulTaskNotifyTake(pdTRUE, gameTaskTimeout());
+  }
+}
+
+void ioTask(void* param) {
+  for (;;) {
+    int64_t startUs = esp_timer_get_time();
+
+    handleControlButtons();
+    handleSerialInput();
+    processIoEvents();
+    processMessageQueue();
+    pumpJournalExport();
+    flushBleTx();
+
+    recordTaskPass(ioTaskStats, startUs);
+    // An export refills the output buffers every tick
+    ulTaskNotifyTake(pdTRUE, journalExport.active ? 1 : pdMS_TO_TICKS(IO_TASK_POLL_MS));
+  }
+}
+
+// Log lines go out as FRAME_LOG frames (binary mode) or "LOG:" lines, never
+// as protocol messages
+void writeLogLine(uint64_t timeUs, uint8_t level, const char* text, size_t len) {
+  char line[LOG_LINE_LENGTH + 8];
+  int n = snprintf(line, sizeof(line), "LOG:%c:%.*s", LogRing::levelChar(level),
+                   (int)len, text);
+  if (n > 0) writeSerialRecord(FRAME_LOG, timeUs, line, min((size_t)n, sizeof(line) - 1));
+}
+
+void logTask(void* param) {
+  LogRecord record;
+  for (;;) {
+    int64_t startUs = esp_timer_get_time();
+
+    uint32_t drops = logRing.takeNewDrops();
+    if (drops > 0) {
+      char text[48];
+      int n = snprintf(text, sizeof(text), "%u log lines dropped", drops);
+      writeLogLine((uint64_t)startUs, LOG_LEVEL_WARN, text, n);
+    }
+    while (logRing.pop(record)) {
+      writeLogLine((uint64_t)record.timeUs, record.level, record.text, record.len);
+    }
+
+    recordTaskPass(logTaskStats, startUs);
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_TASK_POLL_MS));
+  }
+}
+
+// Writes the game state journal and the event journal. Sleeps until the game
+// task posts a snapshot or journal records, and polls while a snapshot is
+// held back, records wait in RAM or the next journal sector needs erasing.
+void persistTask(void* param) {
+  bool holding = false; // Snapshot waiting for FLASH_IDLE
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, holding || journalNeedsService()
+                                 ? pdMS_TO_TICKS(JOURNAL_POLL_MS) : portMAX_DELAY);
+    int64_t startUs = esp_timer_get_time();
+
+    // The mailbox keeps only the newest snapshot while it is held back
+    bool writable = flashAccess.load(std::memory_order_relaxed) == FLASH_IDLE;
+    GameSnapshot snapshot;
+    xSemaphoreTake(persistLock, portMAX_DELAY);
+    bool pending = persistHasPending;
+    if (pending && writable) {
+      snapshot = persistPending;
+      persistHasPending = false;
+    } else if (pending) {
+      persistStats.deferred++;
+    }
+    xSemaphoreGive(persistLock);
+    holding = pending && !writable;
+    if (pending && writable) writeGameState(snapshot);
+
+    serviceEventJournal();
+
+    recordTaskPass(persistTaskStats, startUs);
+  }
+}
+
+void reportLog() {
+  serialReply("LOG level=%u depth=%u capacity=%u high_water=%u dropped=%u truncated=%u",
+              LOG_LEVEL, logRing.depth(), logRing.capacity(), logRing.highWater(),
+              logRing.dropped(), logRing.truncated());
+}
+
+void reportTasks() {
+  TaskStats* tasks[] = {&gameTaskStats, &ioTaskStats, &logTaskStats, &persistTaskStats};
+  int64_t nowUs = esp_timer_get_time();
+  for (TaskStats* stats : tasks) {
+    uint32_t busyUs = stats->busyUs;
+    int64_t windowUs = nowUs - stats->reportedAtUs;
+    float cpu = windowUs > 0 ? 100.0f * (uint32_t)(busyUs - stats->reportedBusyUs) / windowUs : 0;
+    uint32_t stackFree = *stats->handle != nullptr
+                             ? uxTaskGetStackHighWaterMark(*stats->handle) : 0;
+
+    serialReply("TASK:%s core=%u cpu=%.1f%% wakeups=%u max_pass_us=%u stack_used=%u/%u",
+                stats->name, stats->core, cpu, stats->wakeups, stats->maxPassUs,
+                stats->stackSize - stackFree, stats->stackSize);
+
+    stats->reportedBusyUs = busyUs;
+    stats->reportedAtUs = nowUs;
+  }
 }
 
 // ============================================================================
@@ -574,13 +2221,29 @@ void initBLE() {
 // ============================================================================
 
 void setup() {
-  // Initialize serial for PC communication
+  messageQueueLock = xSemaphoreCreateMutex();
+  serialLock = xSemaphoreCreateMutex();
+  persistLock = xSemaphoreCreateMutex();
+  reportReady = xSemaphoreCreateBinary();
+
+  // Initialize serial for PC communication; log lines are written by the
+  // log task from here on (and wait in its ring, so no start-up delay).
+  // The TX buffer lets EXPORT keep the UART busy without blocking.
+  Serial.setTxBufferSize(SERIAL_TX_BUFFER_SIZE);
   Serial.begin(SERIAL_BAUD_RATE);
-  delay(1000);
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK_SIZE, nullptr,
+                          LOG_TASK_PRIORITY, &logTaskHandle, LOG_TASK_CORE);
+
+  LOG_INFO("MAIN CONTROLLER (reset reason %s)", resetReasonName(esp_reset_reason()));
 
-  Serial.println("========================================");
-  Serial.println("MAIN CONTROLLER");
-  Serial.println("========================================");
+  // Resume the game a reset interrupted; the LEDs go out as soon as ESP-NOW is up
+  recovery.restored = restoreGameState();
+  recovery.snapshot = game.snapshot();
+  if (!eventJournal.begin(JOURNAL_PARTITION_LABEL)) {
+    LOG_WARN("No \"%s\" partition, event journal disabled", JOURNAL_PARTITION_LABEL);
+  }
+  xTaskCreatePinnedToCore(persistTask, "persist", PERSIST_TASK_STACK_SIZE, nullptr,
+                          PERSIST_TASK_PRIORITY, &persistTaskHandle, PERSIST_TASK_CORE);
 
   // Configure control button pins
   pinMode(CTRL_BUTTON_CORRECT, INPUT_PULLUP);
@@ -589,80 +2252,96 @@ void setup() {
 
   // Set custom MAC address (AA:BB:CC:DD:EE:00 for main controller)
   WiFi.mode(WIFI_STA);
-  uint8_t customMAC[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x00};
+  uint8_t customMAC[6];
+  nodeMAC(0, customMAC);
   esp_err_t macResult = esp_wifi_set_mac(WIFI_IF_STA, customMAC);
 
-  Serial.print("Custom MAC address: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", customMAC[i]);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
-
   if (macResult == ESP_OK) {
-    Serial.println("✓ Custom MAC address set successfully");
+    LOG_INFO("Custom MAC address: %02X:%02X:%02X:%02X:%02X:%02X", customMAC[0],
+             customMAC[1], customMAC[2], customMAC[3], customMAC[4], customMAC[5]);
   } else {
-    Serial.println("✗ ERROR: Failed to set custom MAC address");
+    LOG_ERROR("Failed to set custom MAC address");
   }
 
   // Initialize ESP-NOW
   if (esp_now_init() != ESP_OK) {
-    Serial.println("✗ ERROR: ESP-NOW initialization failed");
+    LOG_ERROR("ESP-NOW initialization failed");
     return;
   }
-  Serial.println("✓ ESP-NOW initialized");
+  LOG_INFO("ESP-NOW initialized");
 
   // Register callbacks
   esp_now_register_send_cb(onDataSent);
   esp_now_register_recv_cb(onDataReceive);
 
-  // Add all buzzer nodes as peers
+  // Add buzzer nodes as peers, keeping one slot for the broadcast peer
   for (int i = 0; i < NUM_BUZZERS; i++) {
+    nodeMAC(i + 1, buzzerMACs[i]);
+    if (i >= ESP_NOW_MAX_TOTAL_PEER_NUM - 1) {
+      continue; // Reached through the broadcast peer
+    }
+
     esp_now_peer_info_t peerInfo = {};
     memcpy(peerInfo.peer_addr, buzzerMACs[i], 6);
     peerInfo.channel = ESPNOW_CHANNEL;
     peerInfo.encrypt = false;
 
     if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-      Serial.print("✗ ERROR: Failed to add buzzer ");
-      Serial.print(i + 1);
-      Serial.println(" as peer");
+      LOG_ERROR("Failed to add buzzer %d as peer", i + 1);
     } else {
-      Serial.print("✓ Buzzer ");
-      Serial.print(i + 1);
-      Serial.println(" added as peer");
+      buzzerIsPeer[i] = true;
+      LOG_INFO("Buzzer %d added as peer", i + 1);
     }
   }
+  if (NUM_BUZZERS > ESP_NOW_MAX_TOTAL_PEER_NUM - 1) {
+    LOG_INFO("Buzzers %d-%d reached via broadcast", ESP_NOW_MAX_TOTAL_PEER_NUM,
+             NUM_BUZZERS);
+  }
+
+  // Broadcast peer for LED state frames
+  esp_now_peer_info_t broadcastPeer = {};
+  memcpy(broadcastPeer.peer_addr, broadcastMAC, 6);
+  broadcastPeer.channel = ESPNOW_CHANNEL;
+  broadcastPeer.encrypt = false;
+  if (esp_now_add_peer(&broadcastPeer) != ESP_OK) {
+    LOG_ERROR("Failed to add broadcast peer");
+  } else {
+    LOG_INFO("Broadcast peer added");
+  }
+
+  // A new epoch per boot: nodes still holding LED sequence numbers from
+  // before a restart resync instead of taking ours for stale repeats
+  game.setEpoch(esp_random());
+  LOG_INFO("State epoch %08X", game.epoch());
+  journalEvent(JRN_BOOT, (uint8_t)esp_reset_reason(), game.epoch(), esp_timer_get_time());
+
+  // Put every LED back (restored state, or all ON in READY) before the
+  // slower BLE start-up. Nodes that miss it get it with the first heartbeat.
+  game.publishLeds();
+  recovery.publishUs = esp_timer_get_time();
+  recovery.ledSeq = game.ledSeq();
+  if (recovery.restored) {
+    const GameSnapshot& restored = recovery.snapshot;
+    queueMessage("RESTORED:%s selected=%u locked=0x%llX", GAME_STATE_NAMES[restored.state],
+                 restored.selected, (unsigned long long)restored.locked);
+    LOG_INFO("Restored %s (journal %u), LEDs sent %lld us after boot",
+             GAME_STATE_NAMES[restored.state], persistJournalSeq,
+             (long long)recovery.publishUs);
+  }
 
   // Initialize BLE
   initBLE();
 
-  Serial.println("========================================");
-  Serial.println("Main controller ready!");
-  Serial.println("- ESP-NOW for buzzer nodes");
-  Serial.println("- USB Serial for commands");
-  Serial.println("- BLE for wireless clients");
-  Serial.println("Initializing all LEDs to ON (READY state)");
-  Serial.println("========================================");
+  LOG_INFO("Main controller ready (ESP-NOW nodes, USB serial and BLE clients)");
 
-  // Initialize all LEDs to ON
-  delay(500); // Give buzzer nodes time to initialize
-  updateAllLEDs();
+  // Everything from here on runs in the two tasks
+  xTaskCreatePinnedToCore(gameTask, "game", GAME_TASK_STACK_SIZE, nullptr,
+                          GAME_TASK_PRIORITY, &gameTaskHandle, GAME_TASK_CORE);
+  xTaskCreatePinnedToCore(ioTask, "io", IO_TASK_STACK_SIZE, nullptr,
+                          IO_TASK_PRIORITY, &ioTaskHandle, IO_TASK_CORE);
 }
 
 void loop() {
-  // Broadcast heartbeat periodically
-  unsigned long now = millis();
-  if (now - lastHeartbeatTime >= HEARTBEAT_INTERVAL_MS) {
-    broadcastHeartbeat();
-    lastHeartbeatTime = now;
-  }
-
-  // Check for node timeouts
-  checkNodeTimeouts();
-
-  handleControlButtons();
-  handleSerialInput();
-  processMessageQueue();
-  delay(1); // Small delay to prevent watchdog issues
+  // Not used: gameTask and ioTask do the work
+  vTaskDelete(nullptr);
 }
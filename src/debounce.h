@@ -0,0 +1,81 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+
+// ============================================================================
+// LEADING-EDGE DEBOUNCER
+// ============================================================================
+//
+// Classic debouncing waits until the input has been stable for the debounce
+// window before reporting anything, which delays every press by that window.
+// This debouncer reports a transition on the very first sample that differs
+// from the debounced state and then ignores the input for `lockout` time
+// units, so contact bounce is swallowed without adding latency to the press.
+//
+// When the lockout expires the raw level is compared against the debounced
+// state again, so a short tap whose release edge fell inside the lockout still
+// produces a RELEASED event as soon as the window closes.
+//
+// The class is plain C++ with no Arduino dependency: time is whatever unit the
+// caller passes in (micros() on the firmware, trace timestamps on the host) and
+// wrap-around is handled with unsigned subtraction. Shared by the buzzer node
+// and the main controller.
+
+class Debouncer {
+public:
+  enum Event : uint8_t {
+    EVENT_NONE = 0,
+    EVENT_PRESSED = 1,
+    EVENT_RELEASED = 2
+  };
+
+  // lockout:   time after an accepted edge during which further edges are
+  //            treated as bounce (same unit as the `now` passed to update())
+  // activeLow: true for buttons wired to GND with a pullup (LOW = pressed)
+  explicit Debouncer(uint32_t lockout, bool activeLow = true)
+      : lockout_(lockout), activeLow_(activeLow), pressed_(false),
+        locked_(false), lastEdge_(0) {}
+
+  // Feed one raw sample. Returns the debounced edge, if any.
+  Event update(int level, uint32_t now) {
+    bool rawPressed = activeLow_ ? (level == 0) : (level != 0);
+
+    if (locked_) {
+      if ((uint32_t)(now - lastEdge_) < lockout_) {
+        return EVENT_NONE; // Still inside the bounce window
+      }
+      locked_ = false;
+    }
+
+    if (rawPressed == pressed_) {
+      return EVENT_NONE;
+    }
+
+    pressed_ = rawPressed;
+    locked_ = true;
+    lastEdge_ = now;
+    return pressed_ ? EVENT_PRESSED : EVENT_RELEASED;
+  }
+
+  // Force the debounced state, e.g. when the edge was already accepted by an
+  // interrupt handler and polling only needs to track the release.
+  void accept(bool pressed, uint32_t now) {
+    pressed_ = pressed;
+    locked_ = true;
+    lastEdge_ = now;
+  }
+
+  bool isPressed() const { return pressed_; }
+  uint32_t lastEdgeTime() const { return lastEdge_; }
+  uint32_t lockout() const { return lockout_; }
+
+private:
+  uint32_t lockout_;
+  bool activeLow_;
+  bool pressed_;   // Debounced state
+  bool locked_;    // True while inside the lockout window
+  uint32_t lastEdge_;
+};
+
+#endif // DEBOUNCE_H
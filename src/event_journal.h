@@ -0,0 +1,386 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "event_queue.h"
+#include "frame_codec.h"
+
+// ============================================================================
+// EVENT JOURNAL (fixed-size binary records in a flash sector ring)
+// ============================================================================
+//
+// Presses, arbitration decisions, host commands and node connects and
+// disconnects are appended as 16-byte records to a data partition that is
+// used raw (no filesystem). The partition is a ring of 4 KB sectors:
+//
+//   sector: [header: magic, seq, ~seq][record 1] ... [record 255]
+//   record: [time_us:8][value:4][type:1][id:1][crc16:2]   (little-endian)
+//
+// The sector with sequence number seq always sits at index seq % sectors, so
+// on boot the newest sector is the valid header with the highest seq and the
+// write position is just past its last programmed slot. When the ring wraps,
+// the oldest sector is erased and its records are gone. A record torn by a
+// reset fails its CRC and is skipped when reading.
+//
+// append() only pushes into a lock-free RAM buffer (event_queue.h), so the
+// producer never touches flash. The writer task calls flush(), which writes
+// at most one flash page (16 records) per call, and prepareNext(), which
+// erases the next sector before it is needed. The caller decides when flash
+// access is acceptable, page by page, and whether an erase is. Readers go through a memory mapping of the
+// partition and may run in another task while the writer works.
+//
+// Sequence numbers are not expected to wrap: the 24 bits available in the
+// published head position outlast the flash's erase endurance many times.
+
+enum JournalType : uint8_t {
+  JRN_BOOT = 1,       // id: reset reason (esp_reset_reason_t), value: state epoch
+  JRN_PRESS = 2,      // id: node, time: arrival, value: arrival - press time (µs, at least 0)
+  JRN_PRESS_DUP = 3,  // Like JRN_PRESS: a resent press that was already counted
+  JRN_BUZZ = 4,       // id: winner, time: decision, value: margin to the runner-up
+                      // (µs, JOURNAL_NO_MARGIN if uncontested)
+  JRN_COMMAND = 5,    // id: JournalCommand, time: received, value: source << 8 | argument
+  JRN_CONNECT = 6,    // id: node
+  JRN_DISCONNECT = 7, // id: node, value: silence before the timeout (ms)
+  JRN_ERASED = 0xFF   // Unwritten slot
+};
+
+enum JournalCommand : uint8_t {
+  JRN_CMD_CORRECT = 1,
+  JRN_CMD_WRONG = 2,
+  JRN_CMD_RESET = 3,
+  JRN_CMD_ARBITRATION = 4 // Argument: window (ms)
+};
+
+const uint32_t JOURNAL_NO_MARGIN = 0xFFFFFFFF;
+
+struct JournalRecord {
+  uint64_t timeUs;  // Controller time (esp_timer, counts from boot)
+  uint32_t value;   // Depends on type (see JournalType)
+  uint8_t type;     // JournalType
+  uint8_t id;       // Node id, command or reset reason
+  uint16_t crc;     // CRC-16/CCITT of the 14 bytes before it (set by the writer)
+};
+
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord must stay 16 bytes");
+
+inline const char* journalTypeName(uint8_t type) {
+  switch (type) {
+  case JRN_BOOT: return "BOOT";
+  case JRN_PRESS: return "PRESS";
+  case JRN_PRESS_DUP: return "PRESS_DUP";
+  case JRN_BUZZ: return "BUZZ";
+  case JRN_COMMAND: return "COMMAND";
+  case JRN_CONNECT: return "CONNECT";
+  case JRN_DISCONNECT: return "DISCONNECT";
+  default: return "UNKNOWN";
+  }
+}
+
+class EventJournal {
+public:
+  static const uint32_t SECTOR_SIZE = SPI_FLASH_SEC_SIZE;
+  static const uint16_t SLOTS = SECTOR_SIZE / sizeof(JournalRecord) - 1; // Slot 0 is the header
+  static const uint16_t PAGE_RECORDS = 256 / sizeof(JournalRecord);      // One program operation
+  static const uint32_t MAGIC = 0x314A5645; // "EVJ1"
+
+  // Read position (see openCursor()/next())
+  struct Cursor {
+    uint32_t seq;     // Sector being read
+    uint16_t slot;    // Next slot in it
+    uint32_t endSeq;  // Head sector when the cursor was opened
+    uint16_t endSlot; // ...and its slots written by then
+    uint32_t bad;     // Records skipped for a CRC mismatch
+    uint32_t lost;    // Sectors the writer erased while they were being read
+  };
+
+  EventJournal()
+      : partition_(nullptr), map_(nullptr), mapHandle_(0), sectors_(0),
+        enabled_(false), headSeq_(0), headSlot_(0), head_(0),
+        nextPrepared_(false), waiting_(false), waitingSinceUs_(0), written_(0),
+        failed_(0), erases_(0), blocked_(0), maxWriteUs_(0), maxEraseUs_(0) {}
+
+  // Setup: find the partition, map it and locate the write position.
+  // Formats the partition if it holds no journal yet.
+  bool begin(const char* label) {
+    partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_DATA_SPIFFS, label);
+    if (partition_ == nullptr) return false;
+    sectors_ = partition_->size / SECTOR_SIZE;
+    if (sectors_ < 2) return false;
+
+    const void* map;
+    if (esp_partition_mmap(partition_, 0, sectors_ * SECTOR_SIZE, SPI_FLASH_MMAP_DATA,
+                           &map, &mapHandle_) != ESP_OK) {
+      return false;
+    }
+    map_ = (const uint8_t*)map;
+
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < sectors_; i++) {
+      const JournalSectorHeader& header = headerAt(i);
+      if (!headerValid(header) || header.seq % sectors_ != i) continue;
+      if (!found || header.seq > newest) {
+        newest = header.seq;
+        found = true;
+      }
+    }
+
+    if (!found) {
+      if (!openSector(0)) return false;
+    } else {
+      uint16_t slot = SLOTS;
+      while (slot > 0 && isErased(*recordAt(newest % sectors_, slot - 1))) slot--;
+      setHead(newest, slot);
+    }
+    enabled_ = true;
+    return true;
+  }
+
+  bool isEnabled() const { return enabled_; }
+
+  // Producer (one task): queue one record. False if the buffer is full (the
+  // record is dropped and counted) or the journal is disabled.
+  bool append(uint8_t type, uint8_t id, uint32_t value, int64_t timeUs) {
+    if (!enabled_) return false;
+    JournalRecord record;
+    record.timeUs = (uint64_t)timeUs;
+    record.value = value;
+    record.type = type;
+    record.id = id;
+    record.crc = 0;
+    return buffer_.push(record);
+  }
+
+  // Writer task: write one page of buffered records once a page's worth is
+  // waiting or the oldest has waited maxAgeUs. Opens the next sector when
+  // the head sector is full, erasing it first only if mayErase (otherwise
+  // nothing is written until prepareNext() has run, and the buffer drops
+  // and counts what overflows meanwhile). Returns records written.
+  uint32_t flush(int64_t nowUs, uint32_t maxAgeUs, bool mayErase) {
+    if (!enabled_ || buffer_.size() == 0) {
+      waiting_ = false;
+      return 0;
+    }
+    if (!waiting_) {
+      waiting_ = true;
+      waitingSinceUs_ = nowUs;
+    }
+    if (buffer_.size() < PAGE_RECORDS && (nowUs - waitingSinceUs_) < (int64_t)maxAgeUs) {
+      return 0;
+    }
+    if (headSlot_ >= SLOTS) {
+      if (!nextPrepared_ && !mayErase) {
+        blocked_++;
+        return 0;
+      }
+      if (!openSector(headSeq_ + 1)) return 0;
+    }
+
+    JournalRecord batch[PAGE_RECORDS];
+    uint16_t room = SLOTS - headSlot_;
+    uint16_t limit = room < PAGE_RECORDS ? room : PAGE_RECORDS;
+    uint16_t count = 0;
+    while (count < limit && buffer_.pop(batch[count])) {
+      batch[count].crc = recordCrc(batch[count]);
+      count++;
+    }
+
+    int64_t startUs = esp_timer_get_time();
+    esp_err_t err = esp_partition_write(partition_, slotOffset(headSeq_, headSlot_),
+                                        batch, count * sizeof(JournalRecord));
+    uint32_t writeUs = (uint32_t)(esp_timer_get_time() - startUs);
+    if (writeUs > maxWriteUs_) maxWriteUs_ = writeUs;
+
+    // On failure the slots may be half programmed: leave them behind
+    if (err == ESP_OK) {
+      written_ += count;
+    } else {
+      failed_ += count;
+    }
+    setHead(headSeq_, headSlot_ + count);
+
+    // What is left keeps the wait it started: it goes out with the next page
+    // or once that reaches maxAgeUs
+    waiting_ = buffer_.size() > 0;
+    return count;
+  }
+
+  // Writer task: erase the sector after the head now, so that opening it
+  // later costs only a header write. Returns true if it erased.
+  bool prepareNext() {
+    if (!enabled_ || nextPrepared_) return false;
+    if (!eraseSector(headSeq_ + 1)) return false;
+    nextPrepared_ = true;
+    return true;
+  }
+
+  bool nextPrepared() const { return nextPrepared_; }
+  uint16_t slotsLeft() const { return SLOTS - headSlot_; }
+
+  // Reader (one task at a time): every record written before this call,
+  // oldest first
+  void openCursor(Cursor& cursor) const {
+    uint32_t head = head_.load(std::memory_order_acquire);
+    cursor.endSeq = head >> 8;
+    cursor.endSlot = head & 0xFF;
+    cursor.seq = cursor.endSeq >= sectors_ - 1 ? cursor.endSeq - (sectors_ - 1) : 0;
+    cursor.slot = 0;
+    cursor.bad = 0;
+    cursor.lost = 0;
+  }
+
+  // Reader: next valid record, false once the cursor's end is reached
+  bool next(Cursor& cursor, JournalRecord& out) const {
+    if (!enabled_) return false;
+    while (cursor.seq <= cursor.endSeq) {
+      uint16_t end = cursor.seq == cursor.endSeq ? cursor.endSlot : SLOTS;
+      if (cursor.slot == 0 && !sectorHolds(cursor.seq)) {
+        cursor.slot = end; // Erased for reuse, or never written
+      }
+      while (cursor.slot < end) {
+        memcpy(&out, recordAt(cursor.seq % sectors_, cursor.slot), sizeof(out));
+        cursor.slot++;
+
+        // The writer may have erased the sector while it was being read
+        if (!sectorHolds(cursor.seq)) {
+          cursor.lost++;
+          break;
+        }
+        if (isErased(out)) continue; // Failed write left behind
+        if (out.crc != recordCrc(out)) {
+          cursor.bad++;
+          continue;
+        }
+        return true;
+      }
+      cursor.seq++;
+      cursor.slot = 0;
+    }
+    return false;
+  }
+
+  uint32_t sectors() const { return sectors_; }
+  uint32_t headSeq() const { return head_.load(std::memory_order_relaxed) >> 8; }
+  uint16_t headSlot() const { return head_.load(std::memory_order_relaxed) & 0xFF; }
+  uint32_t pending() const { return buffer_.size(); }
+  uint16_t bufferCapacity() const { return buffer_.capacity(); }
+  uint32_t bufferHighWater() const { return buffer_.highWater(); }
+  uint32_t dropped() const { return buffer_.dropped(); }
+  uint32_t written() const { return written_; }
+  uint32_t failed() const { return failed_; }
+  uint32_t erases() const { return erases_; }
+  uint32_t blocked() const { return blocked_; }
+  uint32_t maxWriteUs() const { return maxWriteUs_; }
+  uint32_t maxEraseUs() const { return maxEraseUs_; }
+
+  static uint16_t recordCrc(const JournalRecord& record) {
+    return crc16Ccitt((const uint8_t*)&record, offsetof(JournalRecord, crc));
+  }
+
+private:
+  struct JournalSectorHeader {
+    uint32_t magic;    // MAGIC
+    uint32_t seq;      // +1 per sector opened
+    uint32_t seqCheck; // ~seq: a torn header write fails the check
+    uint32_t reserved; // 0xFFFFFFFF
+  };
+
+  static bool headerValid(const JournalSectorHeader& header) {
+    return header.magic == MAGIC && header.seqCheck == ~header.seq;
+  }
+
+  static bool isErased(const JournalRecord& record) {
+    const uint8_t* bytes = (const uint8_t*)&record;
+    for (size_t i = 0; i < sizeof(record); i++) {
+      if (bytes[i] != 0xFF) return false;
+    }
+    return true;
+  }
+
+  const JournalSectorHeader& headerAt(uint32_t sector) const {
+    return *(const JournalSectorHeader*)(map_ + sector * SECTOR_SIZE);
+  }
+
+  const JournalRecord* recordAt(uint32_t sector, uint16_t slot) const {
+    return (const JournalRecord*)(map_ + sector * SECTOR_SIZE +
+                                  (slot + 1) * sizeof(JournalRecord));
+  }
+
+  size_t slotOffset(uint32_t seq, uint16_t slot) const {
+    return (seq % sectors_) * SECTOR_SIZE + (slot + 1) * sizeof(JournalRecord);
+  }
+
+  bool sectorHolds(uint32_t seq) const {
+    JournalSectorHeader header;
+    memcpy(&header, &headerAt(seq % sectors_), sizeof(header));
+    return headerValid(header) && header.seq == seq;
+  }
+
+  bool eraseSector(uint32_t seq) {
+    int64_t startUs = esp_timer_get_time();
+    esp_err_t err = esp_partition_erase_range(partition_, (seq % sectors_) * SECTOR_SIZE,
+                                              SECTOR_SIZE);
+    uint32_t eraseUs = (uint32_t)(esp_timer_get_time() - startUs);
+    if (eraseUs > maxEraseUs_) maxEraseUs_ = eraseUs;
+    if (err != ESP_OK) return false;
+    erases_++;
+    return true;
+  }
+
+  // Erase (unless prepared) and stamp the sector, then make it the head
+  bool openSector(uint32_t seq) {
+    if (!(nextPrepared_ && seq == headSeq_ + 1) && !eraseSector(seq)) return false;
+    nextPrepared_ = false;
+
+    JournalSectorHeader header;
+    header.magic = MAGIC;
+    header.seq = seq;
+    header.seqCheck = ~seq;
+    header.reserved = 0xFFFFFFFF;
+    if (esp_partition_write(partition_, (seq % sectors_) * SECTOR_SIZE, &header,
+                            sizeof(header)) != ESP_OK) {
+      return false;
+    }
+    setHead(seq, 0);
+    return true;
+  }
+
+  // Published for readers as one word: seq << 8 | slot
+  void setHead(uint32_t seq, uint16_t slot) {
+    headSeq_ = seq;
+    headSlot_ = slot;
+    head_.store((seq << 8) | slot, std::memory_order_release);
+  }
+
+  const esp_partition_t* partition_;
+  const uint8_t* map_;
+  spi_flash_mmap_handle_t mapHandle_;
+  uint32_t sectors_;
+  bool enabled_;
+
+  // Writer task only (readers use head_)
+  uint32_t headSeq_;
+  uint16_t headSlot_;
+  std::atomic<uint32_t> head_;
+  bool nextPrepared_;
+  bool waiting_;            // Records have been waiting since waitingSinceUs_
+  int64_t waitingSinceUs_;
+
+  EventQueue<JournalRecord, JOURNAL_BUFFER_SIZE> buffer_;
+
+  uint32_t written_;
+  uint32_t failed_;
+  uint32_t erases_;
+  uint32_t blocked_;        // flush() calls that found the head full and no erase allowed
+  uint32_t maxWriteUs_;
+  uint32_t maxEraseUs_;
+};
+
+#endif // EVENT_JOURNAL_H
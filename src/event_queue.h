@@ -0,0 +1,101 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// ============================================================================
+// LOCK-FREE EVENT QUEUE (bounded, multi-producer / single-consumer)
+// ============================================================================
+//
+// Bounded ring in the style of Dmitry Vyukov's MPMC queue, reduced to a single
+// consumer. Every cell carries a sequence number that tells producers whether
+// the slot is free and tells the consumer whether it has been published, so
+// no lock is ever taken: producers claim a slot with one compare-and-swap and
+// the consumer only does plain loads/stores.
+//
+// Producers may run in any task (ESP-NOW receive callback, BLE callbacks,
+// the I/O task); push() never blocks and returns false when the ring is full.
+// CAPACITY must be a power of two.
+
+template <typename T, uint16_t CAPACITY> class EventQueue {
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0,
+                "EventQueue capacity must be a power of two");
+
+public:
+  EventQueue() : enqueuePos_(0), dequeuePos_(0), dropped_(0), highWater_(0) {
+    for (uint16_t i = 0; i < CAPACITY; i++) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Producer side: safe to call concurrently from several tasks
+  bool push(const T &item) {
+    uint32_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &cells_[pos & (CAPACITY - 1)];
+      uint32_t seq = cell->seq.load(std::memory_order_acquire);
+      int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false; // Full
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = item;
+    cell->seq.store(pos + 1, std::memory_order_release);
+
+    uint32_t depth = pos + 1 - dequeuePos_.load(std::memory_order_relaxed);
+    uint32_t high = highWater_.load(std::memory_order_relaxed);
+    while (depth > high &&
+           !highWater_.compare_exchange_weak(high, depth,
+                                             std::memory_order_relaxed)) {
+    }
+    return true;
+  }
+
+  // Consumer side: only one task may call pop()
+  bool pop(T &out) {
+    uint32_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell &cell = cells_[pos & (CAPACITY - 1)];
+    uint32_t seq = cell.seq.load(std::memory_order_acquire);
+    if ((int32_t)(seq - (pos + 1)) < 0) {
+      return false; // Empty (or the producer has not finished publishing)
+    }
+
+    out = cell.data;
+    cell.seq.store(pos + CAPACITY, std::memory_order_release);
+    dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  uint32_t size() const {
+    return enqueuePos_.load(std::memory_order_relaxed) -
+           dequeuePos_.load(std::memory_order_relaxed);
+  }
+  uint16_t capacity() const { return CAPACITY; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  uint32_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+  struct Cell {
+    std::atomic<uint32_t> seq;
+    T data;
+  };
+
+  Cell cells_[CAPACITY];
+  std::atomic<uint32_t> enqueuePos_;
+  std::atomic<uint32_t> dequeuePos_;
+  std::atomic<uint32_t> dropped_;
+  std::atomic<uint32_t> highWater_;
+};
+
+#endif // EVENT_QUEUE_H
@@ -0,0 +1,136 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// BINARY FRAME CODEC (PC / BLE binary mode)
+// ============================================================================
+//
+// Frame before encoding (multi-byte fields little-endian):
+//
+//   [type:1][seq:2][time_us:8][payload:0..N][crc16:2]
+//
+// The CRC is CRC-16/CCITT-FALSE over type..payload. The whole frame is then
+// COBS-encoded so it contains no zero bytes, and a single 0x00 delimiter is
+// appended. A receiver can resynchronize on the next 0x00 after any error.
+
+enum FrameType : uint8_t {
+  FRAME_EVENT = 1,    // Game event (payload: event line, e.g. "BUZZ 3")
+  FRAME_RESPONSE = 2, // Command response (payload: "CMD_ACK:..." etc.)
+  FRAME_LOG = 3,      // Debug log line (serial only)
+  FRAME_COMMAND = 4,  // Host -> controller command (payload: "CORRECT" etc.)
+  FRAME_JOURNAL = 5   // EXPORT output (payload: raw 16-byte journal records)
+};
+
+static const size_t FRAME_HEADER_SIZE = 11; // type + seq + time_us
+static const size_t FRAME_CRC_SIZE = 2;
+
+// Worst-case encoded size for a payload of `len` bytes (incl. delimiter)
+constexpr size_t frameEncodedSize(size_t len) {
+  return FRAME_HEADER_SIZE + len + FRAME_CRC_SIZE +
+         (FRAME_HEADER_SIZE + len + FRAME_CRC_SIZE) / 254 + 2;
+}
+
+inline uint16_t crc16Ccitt(const uint8_t *data, size_t len,
+                           uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// COBS-encode `len` bytes into `out` (no delimiter). Returns encoded length.
+inline size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t codeIndex = 0;
+  size_t outIndex = 1;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[codeIndex] = code;
+      codeIndex = outIndex++;
+      code = 1;
+    } else {
+      out[outIndex++] = in[i];
+      code++;
+      if (code == 0xFF) {
+        out[codeIndex] = code;
+        codeIndex = outIndex++;
+        code = 1;
+      }
+    }
+  }
+  out[codeIndex] = code;
+  return outIndex;
+}
+
+// Decode one COBS block (without delimiter) into `out`.
+// Returns decoded length, or 0 on malformed input.
+inline size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t inIndex = 0;
+  size_t outIndex = 0;
+
+  while (inIndex < len) {
+    uint8_t code = in[inIndex++];
+    if (code == 0 || inIndex + code - 1 > len) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; i++) {
+      out[outIndex++] = in[inIndex++];
+    }
+    if (code != 0xFF && inIndex < len) {
+      out[outIndex++] = 0;
+    }
+  }
+  return outIndex;
+}
+
+// Build a complete encoded frame (including the trailing 0x00) into `out`,
+// which must hold frameEncodedSize(len) bytes. `scratch` must hold
+// FRAME_HEADER_SIZE + len + FRAME_CRC_SIZE bytes. Returns bytes written.
+inline size_t encodeFrame(uint8_t type, uint16_t seq, uint64_t timeUs,
+                          const uint8_t *payload, size_t len, uint8_t *scratch,
+                          uint8_t *out) {
+  size_t n = 0;
+  scratch[n++] = type;
+  scratch[n++] = (uint8_t)(seq & 0xFF);
+  scratch[n++] = (uint8_t)(seq >> 8);
+  for (uint8_t i = 0; i < 8; i++) {
+    scratch[n++] = (uint8_t)(timeUs >> (8 * i));
+  }
+  for (size_t i = 0; i < len; i++) {
+    scratch[n++] = payload[i];
+  }
+  uint16_t crc = crc16Ccitt(scratch, n);
+  scratch[n++] = (uint8_t)(crc & 0xFF);
+  scratch[n++] = (uint8_t)(crc >> 8);
+
+  size_t encoded = cobsEncode(scratch, n, out);
+  out[encoded++] = 0;
+  return encoded;
+}
+
+// Decode and validate a frame received without its 0x00 delimiter. On
+// success `frame` holds the raw frame and the payload is
+// frame[FRAME_HEADER_SIZE .. FRAME_HEADER_SIZE + payloadLen).
+inline bool decodeFrame(const uint8_t *in, size_t len, uint8_t *frame,
+                        size_t &payloadLen) {
+  size_t n = cobsDecode(in, len, frame);
+  if (n < FRAME_HEADER_SIZE + FRAME_CRC_SIZE) {
+    return false;
+  }
+  uint16_t crc = crc16Ccitt(frame, n - FRAME_CRC_SIZE);
+  uint16_t received = (uint16_t)(frame[n - 2] | (frame[n - 1] << 8));
+  if (crc != received) {
+    return false;
+  }
+  payloadLen = n - FRAME_HEADER_SIZE - FRAME_CRC_SIZE;
+  return true;
+}
+
+#endif // FRAME_CODEC_H
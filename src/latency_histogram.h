@@ -0,0 +1,105 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <atomic>
+
+// ============================================================================
+// LATENCY HISTOGRAM (fixed-size, lock-free, microsecond resolution)
+// ============================================================================
+//
+// Log-linear buckets: values below 16µs get one bucket each, every power of
+// two above that is split into 8 sub-buckets, so any value up to ~71 minutes
+// is kept with at most 12.5% error (1µs below 16µs). 240 counters, no
+// allocation.
+//
+// record() is one count-leading-zeros, one relaxed atomic add and (rarely) a
+// compare-exchange for the maximum. It is safe from any task, cheap enough to
+// leave on in production, and never blocks the hot path. summarize() takes a
+// snapshot; a concurrent record() lands in this snapshot or the next one.
+
+class LatencyHistogram {
+public:
+  static const uint8_t LINEAR = 16;   // Exact buckets for 0-15µs
+  static const uint8_t SUB_BITS = 3;  // 2^3 sub-buckets per power of two
+  static const uint16_t BUCKETS = LINEAR + (32 - 4) * (1 << SUB_BITS);
+
+  struct Summary {
+    uint32_t count;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+  };
+
+  LatencyHistogram() : max_(0) { reset(); }
+
+  void record(int64_t us) {
+    uint32_t v = us < 0 ? 0 : (us > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+    counts_[bucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t seen = max_.load(std::memory_order_relaxed);
+    while (v > seen &&
+           !max_.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {
+    }
+  }
+
+  void reset() {
+    for (uint16_t i = 0; i < BUCKETS; i++) {
+      counts_[i].store(0, std::memory_order_relaxed);
+    }
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  // Percentiles are bucket midpoints (never above the recorded maximum)
+  Summary summarize() const {
+    uint32_t counts[BUCKETS];
+    Summary summary = {};
+    for (uint16_t i = 0; i < BUCKETS; i++) {
+      counts[i] = counts_[i].load(std::memory_order_relaxed);
+      summary.count += counts[i];
+    }
+    summary.max = max_.load(std::memory_order_relaxed);
+    if (summary.count == 0) return summary;
+
+    summary.p50 = percentile(counts, summary.count, 50, summary.max);
+    summary.p90 = percentile(counts, summary.count, 90, summary.max);
+    summary.p99 = percentile(counts, summary.count, 99, summary.max);
+    return summary;
+  }
+
+private:
+  static uint16_t bucketOf(uint32_t v) {
+    if (v < LINEAR) return (uint16_t)v;
+    uint8_t exp = 31 - __builtin_clz(v); // 4..31
+    uint8_t sub = (v >> (exp - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+    return LINEAR + (exp - 4) * (1 << SUB_BITS) + sub;
+  }
+
+  static uint32_t bucketMid(uint16_t bucket) {
+    if (bucket < LINEAR) return bucket;
+    uint8_t exp = (bucket - LINEAR) / (1 << SUB_BITS) + 4;
+    uint8_t sub = (bucket - LINEAR) % (1 << SUB_BITS);
+    uint32_t width = (uint32_t)1 << (exp - SUB_BITS);
+    return ((1u << SUB_BITS) + sub) * width + width / 2;
+  }
+
+  static uint32_t percentile(const uint32_t* counts, uint32_t total,
+                             uint8_t pct, uint32_t max) {
+    uint32_t rank = (uint32_t)(((uint64_t)total * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < BUCKETS; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint32_t mid = bucketMid(i);
+        return mid < max ? mid : max;
+      }
+    }
+    return max;
+  }
+
+  std::atomic<uint32_t> counts_[BUCKETS];
+  std::atomic<uint32_t> max_;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,153 @@
+#ifndef LED_PATTERN_H
+#define LED_PATTERN_H
+
+#include <stdint.h>
+
+// ============================================================================
+// LED PATTERNS (declarative segments for the LEDC hardware fade unit)
+// ============================================================================
+//
+// A pattern is a list of segments played in order: fade to a brightness
+// level over fadeMs (0 = jump), then hold it for holdMs. The list is played
+// repeat times (0 = forever) and then hands over to the next pattern. If there
+// is no next pattern, the last level stays on. A pattern that repeats forever
+// needs a non-zero total duration.
+//
+// Levels are perceptual (0-255) and pass through a gamma 2.2 table into
+// 10-bit duty. The hardware fades linearly in duty, so a fade is split into
+// pieces of at most MAX_PIECE_MS (or what setMaxPieceMs() chose) through
+// gamma-corrected intermediate levels. Between step boundaries the LEDC
+// hardware does all the work.
+//
+// This class only keeps time and walks the segments; the caller writes each
+// Step to the hardware.
+
+struct LedSegment {
+  uint8_t level;   // Target brightness (0-255, perceptual)
+  uint16_t fadeMs; // Time to reach it (0 = immediately)
+  uint16_t holdMs; // Time to stay there afterwards
+};
+
+struct LedPattern {
+  const LedSegment* segments;
+  uint8_t count;
+  uint8_t repeat;          // Passes through the segments (0 = forever)
+  const LedPattern* next;  // Played after the last pass (nullptr = hold)
+};
+
+// round(1023 * (level / 255)^2.2)
+constexpr uint16_t LED_GAMMA[256] = {
+     0,    0,    0,    0,    0,    0,    0,    0,    1,    1,    1,    1,    1,    1,    2,    2,
+     2,    3,    3,    3,    4,    4,    5,    5,    6,    6,    7,    7,    8,    9,    9,   10,
+    11,   11,   12,   13,   14,   15,   16,   16,   17,   18,   19,   20,   21,   23,   24,   25,
+    26,   27,   28,   30,   31,   32,   34,   35,   36,   38,   39,   41,   42,   44,   46,   47,
+    49,   51,   52,   54,   56,   58,   60,   61,   63,   65,   67,   69,   71,   73,   76,   78,
+    80,   82,   84,   87,   89,   91,   94,   96,   98,  101,  103,  106,  109,  111,  114,  117,
+   119,  122,  125,  128,  130,  133,  136,  139,  142,  145,  148,  151,  155,  158,  161,  164,
+   167,  171,  174,  177,  181,  184,  188,  191,  195,  198,  202,  206,  209,  213,  217,  221,
+   225,  228,  232,  236,  240,  244,  248,  252,  257,  261,  265,  269,  274,  278,  282,  287,
+   291,  295,  300,  304,  309,  314,  318,  323,  328,  333,  337,  342,  347,  352,  357,  362,
+   367,  372,  377,  382,  387,  393,  398,  403,  408,  414,  419,  425,  430,  436,  441,  447,
+   452,  458,  464,  470,  475,  481,  487,  493,  499,  505,  511,  517,  523,  529,  535,  542,
+   548,  554,  561,  567,  573,  580,  586,  593,  599,  606,  613,  619,  626,  633,  640,  647,
+   653,  660,  667,  674,  681,  689,  696,  703,  710,  717,  725,  732,  739,  747,  754,  762,
+   769,  777,  784,  792,  800,  807,  815,  823,  831,  839,  847,  855,  863,  871,  879,  887,
+   895,  903,  912,  920,  928,  937,  945,  954,  962,  971,  979,  988,  997, 1005, 1014, 1023,
+};
+
+class LedPatternPlayer {
+public:
+  static const uint16_t MAX_PIECE_MS = 100; // Longest single hardware fade (default)
+
+  struct Step {
+    uint16_t duty;   // 10-bit LEDC duty
+    uint16_t fadeMs; // Hardware fade time to reach it (0 = set immediately)
+  };
+
+  LedPatternPlayer()
+      : pattern_(nullptr), segment_(0), pass_(0), piece_(0), pieces_(1), level_(0),
+        from_(0), dueMs_(0), active_(false), maxPieceMs_(MAX_PIECE_MS) {}
+
+  // Longer pieces mean fewer CPU wake-ups per fade and a coarser gamma curve.
+  // Applies from the next segment.
+  void setMaxPieceMs(uint16_t ms) { maxPieceMs_ = ms > 0 ? ms : 1; }
+
+  // Play from the first segment; the first step is due at once
+  void start(const LedPattern* pattern, uint32_t nowMs) {
+    pattern_ = pattern;
+    segment_ = 0;
+    pass_ = 0;
+    piece_ = 0;
+    from_ = level_;
+    dueMs_ = nowMs;
+    active_ = pattern != nullptr && pattern->count > 0;
+  }
+
+  bool isDue(uint32_t nowMs) const {
+    return active_ && (int32_t)(nowMs - dueMs_) >= 0;
+  }
+
+  // Milliseconds until the next step (UINT32_MAX once the pattern is holding)
+  uint32_t msUntilDue(uint32_t nowMs) const {
+    if (!active_) return UINT32_MAX;
+    int32_t wait = (int32_t)(dueMs_ - nowMs);
+    return wait > 0 ? (uint32_t)wait : 0;
+  }
+
+  // Take the step that is due and schedule the next one
+  Step step(uint32_t nowMs) {
+    const LedSegment& seg = pattern_->segments[segment_];
+    if (piece_ == 0) {
+      pieces_ = (seg.fadeMs + maxPieceMs_ - 1) / maxPieceMs_;
+      if (pieces_ == 0) pieces_ = 1;
+    }
+    uint16_t pieces = pieces_;
+
+    piece_++;
+    level_ = (uint8_t)(from_ + ((int16_t)seg.level - from_) * piece_ / pieces);
+    uint16_t pieceMs = seg.fadeMs / pieces;
+    Step step = {LED_GAMMA[level_], pieceMs};
+
+    if (piece_ < pieces) {
+      dueMs_ = nowMs + pieceMs;
+    } else {
+      dueMs_ = nowMs + (seg.fadeMs - pieceMs * (pieces - 1)) + seg.holdMs;
+      nextSegment();
+    }
+    return step;
+  }
+
+  const LedPattern* pattern() const { return pattern_; }
+  uint8_t level() const { return level_; }
+
+private:
+  void nextSegment() {
+    piece_ = 0;
+    from_ = level_;
+    if (++segment_ < pattern_->count) return;
+
+    segment_ = 0;
+    pass_++;
+    if (pattern_->repeat == 0 || pass_ < pattern_->repeat) return;
+
+    pass_ = 0;
+    if (pattern_->next != nullptr) {
+      pattern_ = pattern_->next;
+    } else {
+      active_ = false; // Hold the last level
+    }
+  }
+
+  const LedPattern* pattern_;
+  uint8_t segment_;
+  uint8_t pass_;
+  uint16_t piece_;
+  uint16_t pieces_; // Pieces of the current segment's fade
+  uint8_t level_; // Level of the last step written
+  uint8_t from_;  // Level at the start of the current segment
+  uint32_t dueMs_;
+  bool active_;
+  uint16_t maxPieceMs_;
+};
+
+#endif // LED_PATTERN_H
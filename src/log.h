@@ -0,0 +1,123 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <esp_timer.h>
+#include "config.h"
+#include "event_queue.h"
+
+// ============================================================================
+// ASYNC LOGGING (level-filtered, lock-free, drained by a low-priority task)
+// ============================================================================
+//
+// LOG_ERROR / LOG_WARN / LOG_INFO / LOG_DEBUG format one line into a
+// fixed-size record and push it into a lock-free ring (event_queue.h). They
+// never touch the UART, so radio callbacks and the press path never wait
+// for serial. Levels above LOG_LEVEL compile to nothing: their arguments are
+// type-checked but never evaluated. When the ring is full the new line is
+// dropped and counted.
+//
+// Each firmware defines the global logRing and drains it from a low-priority
+// task, writing the records as log output (never as protocol lines):
+//
+//   LOG:<E|W|I|D>:<text>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+struct LogRecord {
+  int64_t timeUs;
+  uint8_t level;
+  uint8_t len;
+  char text[LOG_LINE_LENGTH];
+};
+
+class LogRing {
+public:
+  LogRing() : reportedDrops_(0), truncated_(0) {}
+
+  // Any task (not ISRs): format and queue one line
+  __attribute__((format(printf, 3, 4))) bool write(uint8_t level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    bool queued = vwrite(level, fmt, args);
+    va_end(args);
+    return queued;
+  }
+
+  bool vwrite(uint8_t level, const char* fmt, va_list args) {
+    LogRecord record;
+    record.timeUs = esp_timer_get_time();
+    record.level = level;
+
+    int n = vsnprintf(record.text, sizeof(record.text), fmt, args);
+    if (n < 0) return false;
+    if (n >= (int)sizeof(record.text)) {
+      n = sizeof(record.text) - 1;
+      truncated_.fetch_add(1, std::memory_order_relaxed);
+    }
+    record.len = (uint8_t)n;
+    return queue_.push(record);
+  }
+
+  // Drain task only
+  bool pop(LogRecord& out) { return queue_.pop(out); }
+
+  // Drain task only: lines dropped since the previous call
+  uint32_t takeNewDrops() {
+    uint32_t dropped = queue_.dropped();
+    uint32_t fresh = dropped - reportedDrops_;
+    reportedDrops_ = dropped;
+    return fresh;
+  }
+
+  static char levelChar(uint8_t level) {
+    static const char LETTERS[] = "-EWID";
+    return level <= LOG_LEVEL_DEBUG ? LETTERS[level] : '?';
+  }
+
+  uint32_t depth() const { return queue_.size(); }
+  uint16_t capacity() const { return queue_.capacity(); }
+  uint32_t highWater() const { return queue_.highWater(); }
+  uint32_t dropped() const { return queue_.dropped(); }
+  uint32_t truncated() const { return truncated_.load(std::memory_order_relaxed); }
+
+private:
+  EventQueue<LogRecord, LOG_QUEUE_SIZE> queue_;
+  uint32_t reportedDrops_;
+  std::atomic<uint32_t> truncated_;
+};
+
+extern LogRing logRing;
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logRing.write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do { if (0) logRing.write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logRing.write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { if (0) logRing.write(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logRing.write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { if (0) logRing.write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logRing.write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do { if (0) logRing.write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#endif
+
+#endif // LOG_H
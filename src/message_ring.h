@@ -0,0 +1,157 @@
+#ifndef MESSAGE_RING_H
+#define MESSAGE_RING_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// ============================================================================
+// OUTBOUND MESSAGE RING (fixed byte arena, no heap)
+// ============================================================================
+//
+// Variable-length text records stored back to back in a preallocated arena,
+// each stamped with the time it was queued:
+//
+//   [len][time_us:8][bytes...][len][time_us:8][bytes...][0 = wrap marker]...
+//
+// Records never straddle the end of the arena. When a record does not fit in
+// the tail space, a wrap marker is written and the record starts at offset 0.
+// Messages are formatted directly into their slot with vsnprintf, so queueing
+// an event costs no allocation and no intermediate copy. Records are not
+// NUL-terminated; consumers get a pointer and a length.
+//
+// When the arena is full the backpressure policy decides what is lost:
+// DROP_NEWEST rejects the new record, DROP_OLDEST evicts queued records until
+// it fits. Either way the drop counter records it.
+//
+// Not thread-safe: DROP_OLDEST evicts records from the producer side, so a
+// producer and consumer in different tasks must share a lock.
+
+class MessageRingBase {
+public:
+  enum Policy : uint8_t {
+    DROP_NEWEST = 0,
+    DROP_OLDEST = 1
+  };
+};
+
+template <uint16_t ARENA_SIZE, uint8_t MAX_RECORD>
+class MessageRing : public MessageRingBase {
+  static const uint16_t HEADER_SIZE = 1 + sizeof(uint64_t); // len + time_us
+
+  static_assert(MAX_RECORD > 0 && HEADER_SIZE + MAX_RECORD + 1 <= ARENA_SIZE,
+                "MessageRing record must fit in the arena");
+
+public:
+  explicit MessageRing(Policy policy = DROP_OLDEST)
+      : policy_(policy), head_(0), tail_(0), count_(0), wrapped_(false),
+        dropped_(0), highWater_(0) {}
+
+  // Format a record in place. Output longer than MAX_RECORD is truncated.
+  bool format(uint64_t timeUs, const char *fmt, ...)
+      __attribute__((format(printf, 3, 4))) {
+    va_list args;
+    va_start(args, fmt);
+    bool ok = vformat(timeUs, fmt, args);
+    va_end(args);
+    return ok;
+  }
+
+  bool vformat(uint64_t timeUs, const char *fmt, va_list args) {
+    // One extra byte for vsnprintf's terminator; it lands where the next
+    // record header will go and is never counted as payload
+    char *slot = reserve(MAX_RECORD + 1);
+    if (slot == nullptr) return false;
+
+    int n = vsnprintf(slot, MAX_RECORD + 1, fmt, args);
+    if (n <= 0) return false; // Empty records would read as a wrap marker
+    if (n > MAX_RECORD) n = MAX_RECORD;
+    commit((uint8_t)n, timeUs);
+    return true;
+  }
+
+  // Oldest record, without removing it. Returns false when empty.
+  bool peek(const char *&data, uint8_t &len, uint64_t &timeUs) {
+    if (count_ == 0) return false;
+    if (head_ >= ARENA_SIZE || arena_[head_] == 0) {
+      head_ = 0; // Reader follows the writer's wrap
+      wrapped_ = false;
+    }
+    len = arena_[head_];
+    memcpy(&timeUs, &arena_[head_ + 1], sizeof(timeUs));
+    data = (const char *)&arena_[head_ + HEADER_SIZE];
+    return true;
+  }
+
+  void pop() {
+    const char *data;
+    uint8_t len;
+    uint64_t timeUs;
+    if (!peek(data, len, timeUs)) return;
+    head_ += HEADER_SIZE + len;
+    count_--;
+    if (count_ == 0) {
+      head_ = tail_ = 0; // Empty: restart at the front for maximum room
+      wrapped_ = false;
+    }
+  }
+
+  void setPolicy(Policy policy) { policy_ = policy; }
+  Policy policy() const { return policy_; }
+  uint16_t size() const { return count_; }
+  uint16_t capacityBytes() const { return ARENA_SIZE; }
+  uint16_t usedBytes() const {
+    if (count_ == 0) return 0;
+    return wrapped_ ? (uint16_t)(ARENA_SIZE - head_ + tail_)
+                    : (uint16_t)(tail_ - head_);
+  }
+  uint32_t dropped() const { return dropped_; }
+  uint16_t highWater() const { return highWater_; }
+
+private:
+  // Contiguous room for the record header + len bytes, or nullptr when full
+  char *reserve(uint16_t len) {
+    uint16_t need = HEADER_SIZE + len;
+    for (;;) {
+      if (!wrapped_) {
+        if (ARENA_SIZE - tail_ >= need) break;
+        if (head_ >= need) {
+          if (tail_ < ARENA_SIZE) arena_[tail_] = 0; // Wrap marker
+          tail_ = 0;
+          wrapped_ = true;
+          break;
+        }
+      } else if (head_ - tail_ >= need) {
+        break;
+      }
+
+      // Full: apply the backpressure policy
+      dropped_++;
+      if (policy_ == DROP_NEWEST || count_ == 0) {
+        return nullptr;
+      }
+      pop();
+    }
+    return (char *)&arena_[tail_ + HEADER_SIZE];
+  }
+
+  void commit(uint8_t len, uint64_t timeUs) {
+    arena_[tail_] = len;
+    memcpy(&arena_[tail_ + 1], &timeUs, sizeof(timeUs));
+    tail_ += HEADER_SIZE + len;
+    count_++;
+    if (count_ > highWater_) highWater_ = count_;
+  }
+
+  uint8_t arena_[ARENA_SIZE];
+  Policy policy_;
+  uint16_t head_;   // Oldest record
+  uint16_t tail_;   // Next write position
+  uint16_t count_;  // Records queued
+  bool wrapped_;    // Writer is behind the reader (wrapped to the front)
+  uint32_t dropped_;
+  uint16_t highWater_;
+};
+
+#endif // MESSAGE_RING_H
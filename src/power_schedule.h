@@ -0,0 +1,41 @@
+#ifndef POWER_SCHEDULE_H
+#define POWER_SCHEDULE_H
+
+#include "config.h"
+#include <stdint.h>
+
+// ============================================================================
+// LOW-POWER SCHEDULE (buzzer node)
+// ============================================================================
+//
+// Whether a low-power node may light-sleep after a loop() pass, and for how
+// long. Kept free of hardware calls so the host tests can check that a press
+// never waits for a sleep to end (see test/test_power_schedule).
+
+// Milliseconds until the radio must listen again (0 = now). Heartbeats come
+// every HEARTBEAT_INTERVAL_MS, so the window stays in phase with the last one
+// received even when some are missed.
+inline uint32_t radioNextWindowMs(uint32_t sinceHeartbeatMs, bool connected) {
+  if (!connected) {
+    // Searching: listen for a full heartbeat interval once per period
+    uint32_t phase = sinceHeartbeatMs % RADIO_SEARCH_PERIOD_MS;
+    uint32_t window = HEARTBEAT_INTERVAL_MS + RADIO_WINDOW_LEAD_MS + RADIO_WINDOW_LATE_MS;
+    return phase < window ? 0 : RADIO_SEARCH_PERIOD_MS - phase;
+  }
+
+  uint32_t phase = sinceHeartbeatMs % HEARTBEAT_INTERVAL_MS;
+  bool late = sinceHeartbeatMs >= HEARTBEAT_INTERVAL_MS && phase < RADIO_WINDOW_LATE_MS;
+  if (late || phase >= HEARTBEAT_INTERVAL_MS - RADIO_WINDOW_LEAD_MS) return 0;
+  return HEARTBEAT_INTERVAL_MS - RADIO_WINDOW_LEAD_MS - phase;
+}
+
+// Light-sleep length for this pass (0 = stay awake). A node that is not idle
+// (press queued, in flight or held, frames or serial input waiting) never
+// sleeps, so its press takes the same path as in active mode.
+inline uint32_t lightSleepMs(bool idle, uint32_t radioMs, uint32_t ledMs) {
+  if (!idle) return 0;
+  uint32_t sleepMs = radioMs < ledMs ? radioMs : ledMs;
+  return sleepMs >= LIGHT_SLEEP_MIN_MS ? sleepMs : 0;
+}
+
+#endif // POWER_SCHEDULE_H
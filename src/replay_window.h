@@ -0,0 +1,90 @@
+#ifndef REPLAY_WINDOW_H
+#define REPLAY_WINDOW_H
+
+#include <stdint.h>
+
+// ============================================================================
+// PRESS REPLAY WINDOW (per-node duplicate suppression)
+// ============================================================================
+//
+// Nodes resend a press with the same press_id until the MAC layer confirms
+// delivery, so the controller can receive the same press more than once (the
+// frame arrived but its MAC ACK was lost). This is the sliding-window check
+// used for anti-replay in IPsec: the highest id seen plus a bitmap of the
+// SIZE ids below it.
+//
+//   id above the highest    new press, slide the window forward
+//   id inside the window    new unless its bit is already set
+//   id far below the window node restarted (ids start at a random value on
+//                           every boot), so restart the window there
+//
+// Retries span milliseconds, so an id older than the window can never be a
+// genuine duplicate.
+
+class ReplayWindow {
+public:
+  static const uint8_t SIZE = 32;
+
+  ReplayWindow()
+      : started_(false), highest_(0), seen_(0), accepted_(0), duplicates_(0),
+        restarts_(0) {}
+
+  // True if the id has not been seen before (and records it)
+  bool accept(uint32_t id) {
+    if (!started_) {
+      restartAt(id);
+      return true;
+    }
+
+    int32_t ahead = (int32_t)(id - highest_);
+    if (ahead > 0) {
+      seen_ = ahead >= (int32_t)SIZE ? 1 : (seen_ << ahead) | 1;
+      highest_ = id;
+      accepted_++;
+      return true;
+    }
+
+    uint32_t behind = (uint32_t)(-ahead);
+    if (behind < SIZE) {
+      uint32_t bit = (uint32_t)1 << behind;
+      if (seen_ & bit) {
+        duplicates_++;
+        return false;
+      }
+      seen_ |= bit;
+      accepted_++;
+      return true;
+    }
+
+    restarts_++;
+    restartAt(id);
+    return true;
+  }
+
+  uint32_t accepted() const { return accepted_; }
+  uint32_t duplicates() const { return duplicates_; }
+  uint32_t restarts() const { return restarts_; }
+
+  void resetStats() {
+    accepted_ = 0;
+    duplicates_ = 0;
+    restarts_ = 0;
+  }
+
+private:
+  void restartAt(uint32_t id) {
+    started_ = true;
+    highest_ = id;
+    seen_ = 1;
+    accepted_++;
+  }
+
+  bool started_;
+  uint32_t highest_; // Highest press id seen
+  uint32_t seen_;    // Bit n set: id (highest_ - n) was seen
+  uint32_t accepted_;
+  uint32_t duplicates_;
+  uint32_t restarts_;
+};
+
+#endif // REPLAY_WINDOW_H
@@ -0,0 +1,803 @@
+// ============================================================================
+// DISCRETE-EVENT SIMULATOR (host build: pio run -e native)
+// ============================================================================
+//
+// Runs the controller's game logic (GameCore, PressArbiter, ClockSync,
+// LinkScheduler, ReplayWindow - the same code the firmware runs) against
+// NUM_BUZZERS simulated buzzer nodes, a virtual clock and a virtual ESP-NOW
+// medium with latency, jitter, loss, lost MAC ACKs and reordering. Nodes run
+// buzzer_node.cpp's protocol code (NodeLink: LED frame dedup and ACKs, state
+// sync, heartbeat replies) and model its press path: ISR edge timestamps,
+// press retries on send failure.
+//
+// Everything is driven from one event heap ordered by (time, insertion), so a
+// run is fully reproducible from its seed. Nothing sleeps and idle periods
+// cost nothing, so thousands of games run per wall-clock second.
+//
+//   .pio/build/native/program --games 10000 --loss 0.05 --reorder 0.1
+//
+// Reports press-to-BUZZ and state-change-to-LED latency distributions,
+// whether the truly earliest press won each round, and what was dropped.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <vector>
+#include "config.h"
+#include "protocol.h"
+#include "game_core.h"
+#include "clock_sync.h"
+#include "link_scheduler.h"
+#include "node_link.h"
+#include "replay_window.h"
+
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+
+struct SimConfig {
+  uint64_t seed = 1;
+  uint32_t games = 1000;
+  uint32_t latencyUs = 1000;     // One-way air + stack latency
+  uint32_t jitterUs = 500;       // Uniform extra latency 0..jitter
+  double loss = 0.0;             // Frame lost after MAC retries
+  double ackLoss = 0.0;          // Frame arrived but the sender saw a failure
+  double reorder = 0.0;          // Frame held back by up to reorderUs
+  uint32_t reorderUs = 3000;
+  uint32_t spreadUs = 1000;      // "press *": presses spread over this window
+  double driftPpm = 20.0;        // Node crystal error, uniform +-driftPpm
+  uint32_t windowMs = ARBITRATION_WINDOW_MS;
+  uint32_t tickUs = 500;         // Controller loop period while it has work
+  uint32_t settleMs = 100;       // Idle time after a game's last action
+  uint32_t warmupMs = 3 * HEARTBEAT_INTERVAL_MS; // Clock sync before game 1
+  const char* scenario = "race";
+  bool verbose = false;
+};
+
+// ============================================================================
+// DETERMINISTIC RANDOM NUMBERS (splitmix64)
+// ============================================================================
+
+class SimRandom {
+public:
+  explicit SimRandom(uint64_t seed) : state_(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+  int64_t below(uint64_t n) { return n > 0 ? (int64_t)(next() % n) : 0; }
+  bool chance(double p) { return p > 0 && uniform() < p; }
+
+private:
+  uint64_t state_;
+};
+
+// ============================================================================
+// SCENARIOS
+// ============================================================================
+//
+// A game is a list of actions at offsets from the game start. Script files
+// have one action per line, '#' starts a comment:
+//
+//   0     press *      every node presses, spread over --spread-us
+//   0.25  press 2      node 2 presses 250µs into the game
+//   100   wrong        host commands: correct / wrong / reset
+//
+// Times are in milliseconds. Games run back to back, each lasting until its
+// last action plus --settle-ms.
+
+enum ActionType : uint8_t { ACT_PRESS, ACT_CORRECT, ACT_WRONG, ACT_RESET };
+
+struct ScriptAction {
+  int64_t atUs;
+  uint8_t type;  // ActionType
+  uint8_t node;  // ACT_PRESS: node id, 0 = every node
+};
+
+struct Scenario {
+  std::vector<ScriptAction> actions;
+  int64_t lengthUs = 0;
+};
+
+bool parseAction(const char* line, ScriptAction& action) {
+  char verb[16];
+  char target[8] = "";
+  double ms;
+  if (sscanf(line, "%lf %15s %7s", &ms, verb, target) < 2 || ms < 0) return false;
+
+  action.atUs = (int64_t)(ms * 1000.0);
+  action.node = 0;
+  if (strcmp(verb, "press") == 0) {
+    action.type = ACT_PRESS;
+    if (strcmp(target, "*") != 0) {
+      int node = atoi(target);
+      if (node < 1 || node > NUM_BUZZERS) return false;
+      action.node = (uint8_t)node;
+    }
+  } else if (strcmp(verb, "correct") == 0) {
+    action.type = ACT_CORRECT;
+  } else if (strcmp(verb, "wrong") == 0) {
+    action.type = ACT_WRONG;
+  } else if (strcmp(verb, "reset") == 0) {
+    action.type = ACT_RESET;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool loadScenario(const char* name, uint32_t settleMs, Scenario& scenario) {
+  // Built-in scenarios
+  static const char* const race[] = {"0 press *", "100 reset", nullptr};
+  static const char* const lockout[] = {"0 press *", "100 wrong", "120 press *",
+                                        "220 correct", nullptr};
+  const char* const* lines = nullptr;
+  if (strcmp(name, "race") == 0) lines = race;
+  if (strcmp(name, "lockout") == 0) lines = lockout;
+
+  ScriptAction action;
+  if (lines) {
+    for (; *lines; lines++) {
+      parseAction(*lines, action);
+      scenario.actions.push_back(action);
+    }
+  } else {
+    FILE* file = fopen(name, "r");
+    if (!file) {
+      fprintf(stderr, "Cannot open scenario %s\n", name);
+      return false;
+    }
+    char line[128];
+    unsigned lineNo = 0;
+    while (fgets(line, sizeof(line), file)) {
+      lineNo++;
+      char* comment = strchr(line, '#');
+      if (comment) *comment = '\0';
+      if (strspn(line, " \t\r\n") == strlen(line)) continue;
+      if (!parseAction(line, action)) {
+        fprintf(stderr, "%s:%u: bad action\n", name, lineNo);
+        fclose(file);
+        return false;
+      }
+      scenario.actions.push_back(action);
+    }
+    fclose(file);
+  }
+
+  std::stable_sort(scenario.actions.begin(), scenario.actions.end(),
+                   [](const ScriptAction& a, const ScriptAction& b) { return a.atUs < b.atUs; });
+  int64_t last = scenario.actions.empty() ? 0 : scenario.actions.back().atUs;
+  scenario.lengthUs = last + (int64_t)settleMs * 1000;
+  return true;
+}
+
+// ============================================================================
+// METRICS
+// ============================================================================
+
+class Distribution {
+public:
+  void add(int64_t us) { samples_.push_back(us < 0 ? 0 : (uint32_t)us); }
+
+  void report(const char* name) {
+    if (samples_.empty()) {
+      printf("%s n=0\n", name);
+      return;
+    }
+    std::sort(samples_.begin(), samples_.end());
+    uint64_t sum = 0;
+    for (uint32_t s : samples_) sum += s;
+    printf("%s n=%u min=%u p50=%u p90=%u p99=%u max=%u mean=%llu\n", name,
+           (unsigned)samples_.size(), samples_.front(), at(0.50), at(0.90),
+           at(0.99), samples_.back(), (unsigned long long)(sum / samples_.size()));
+  }
+
+private:
+  uint32_t at(double q) const { return samples_[(size_t)(q * (samples_.size() - 1))]; }
+
+  std::vector<uint32_t> samples_;
+};
+
+struct SimMetrics {
+  Distribution pressToBuzz;  // Physical press of the winner -> BUZZ at controller
+  Distribution stateToLed;   // LED frame published -> node holds that state
+  uint32_t rounds = 0;       // BUZZ lines
+  uint32_t contested = 0;    // Rounds where 2+ eligible nodes had pressed
+  uint32_t correct = 0;      // Winner's press was the earliest eligible press
+  uint32_t wrong = 0;
+  int64_t worstWrongGapUs = 0; // Largest lead the true first press lost by
+  uint32_t presses = 0;      // Physical presses
+  uint32_t pressQueueFull = 0; // Edges dropped by a node (press queue full)
+  uint32_t pressGaveUp = 0;  // Presses abandoned after PRESS_MAX_RETRIES
+  uint32_t framesSent = 0;
+  uint32_t framesLost = 0;
+  uint32_t macAcksLost = 0;  // Delivered, but the sender was told it failed
+};
+
+// ============================================================================
+// SIMULATION
+// ============================================================================
+
+enum SimEventType : uint8_t {
+  SIM_DELIVER,         // Frame arrives at dst (0 = controller)
+  SIM_SEND_STATUS,     // Press send callback on node dst (arg: delivered)
+  SIM_PRESS_RETRY,     // Node dst's resend timer
+  SIM_CONTROLLER_TICK, // One controller loop() pass
+  SIM_HEARTBEAT,
+  SIM_GAME_START,
+  SIM_ACTION           // Scenario action (arg: ActionType, node: dst)
+};
+
+static const uint8_t SIM_FRAME_MAX = 32;
+static_assert(sizeof(TimeSyncMessage) <= SIM_FRAME_MAX &&
+              sizeof(HeartbeatMessage) <= SIM_FRAME_MAX &&
+              sizeof(BuzzerMessage) <= SIM_FRAME_MAX &&
+              sizeof(LedStateMessage) <= SIM_FRAME_MAX &&
+              sizeof(StateSyncMessage) <= SIM_FRAME_MAX,
+              "frames must fit a simulator event");
+
+struct SimEvent {
+  int64_t atUs;
+  uint64_t order;   // Insertion order: ties run first-scheduled first
+  uint8_t type;     // SimEventType
+  uint8_t dst;
+  uint8_t arg;
+  uint8_t len;
+  uint8_t data[SIM_FRAME_MAX];
+};
+
+struct LaterEvent {
+  bool operator()(const SimEvent& a, const SimEvent& b) const {
+    return a.atUs != b.atUs ? a.atUs > b.atUs : a.order > b.order;
+  }
+};
+
+struct SimNode {
+  uint8_t id;
+  int64_t offsetUs;   // Node clock = true time * (1 + drift) + offset
+  double drift;
+  uint32_t nextPressId;
+
+  bool pressInFlight;
+  BuzzerMessage pressMsg;
+  uint8_t pressAttempts;
+  int64_t queuedEdges[PRESS_QUEUE_LENGTH]; // ISR queue (node-local edge times)
+  uint8_t queuedCount;
+
+  int64_t localUs(int64_t trueUs) const {
+    return trueUs + offsetUs + (int64_t)((double)trueUs * drift);
+  }
+};
+
+struct RoundPress {
+  uint8_t node;
+  int64_t trueUs;
+};
+
+class Simulation : public GameClock, public GameTransport, public GameOutput,
+                   public LinkTransport {
+public:
+  explicit Simulation(const SimConfig& config, const Scenario& scenario)
+      : config_(config), scenario_(scenario), rng_(config.seed), nowUs_(0),
+        order_(0), gamesStarted_(0), tickArmed_(false),
+        links_(*this, *this, HEARTBEAT_MAX_SUPPRESSED),
+        game_(*this, *this, *this, config.windowMs * 1000UL), publishedUs_() {
+    nodeIO_.reserve(NUM_BUZZERS); // NodeLinks keep references into it
+    nodeLinks_.reserve(NUM_BUZZERS);
+    for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+      SimNode& node = nodes_[i];
+      memset(&node, 0, sizeof(node));
+      node.id = i + 1;
+      node.offsetUs = rng_.below(1000000000ULL); // Booted up to 1000s apart
+      node.drift = (rng_.uniform() * 2 - 1) * config.driftPpm * 1e-6;
+      node.nextPressId = (uint32_t)rng_.next();
+      nodeIO_.emplace_back(*this, node);
+      nodeLinks_.emplace_back(node.id, nodeIO_[i], nodeIO_[i]);
+    }
+    game_.setEpoch(1); // One controller boot per run
+  }
+
+  void run() {
+    schedule(0, SIM_HEARTBEAT, 0);
+    schedule((int64_t)config_.warmupMs * 1000, SIM_GAME_START, 0);
+
+    while (!events_.empty()) {
+      SimEvent event = events_.top();
+      events_.pop();
+      nowUs_ = event.atUs;
+      dispatch(event);
+      if (gamesStarted_ > config_.games) break;
+    }
+  }
+
+  void printReport(double wallSeconds) {
+    uint32_t games = std::min(gamesStarted_, config_.games);
+    printf("SIM nodes=%u games=%u seed=%llu scenario=%s sim_s=%.1f wall_s=%.3f games_per_s=%.0f\n",
+           NUM_BUZZERS, games, (unsigned long long)config_.seed, config_.scenario,
+           nowUs_ / 1e6, wallSeconds, wallSeconds > 0 ? games / wallSeconds : 0.0);
+    printf("MEDIUM latency_us=%u jitter_us=%u loss=%.3f ack_loss=%.3f reorder=%.3f reorder_us=%u\n",
+           config_.latencyUs, config_.jitterUs, config_.loss, config_.ackLoss,
+           config_.reorder, config_.reorderUs);
+    metrics_.pressToBuzz.report("PRESS_TO_BUZZ_US");
+    metrics_.stateToLed.report("STATE_TO_LED_US");
+
+    const PressArbiter<NUM_BUZZERS>& arbiter = game_.arbiter();
+    printf("TIES rounds=%u contested=%u correct=%u wrong=%u worst_wrong_gap_us=%lld arb_rounds=%u arb_reordered=%u\n",
+           metrics_.rounds, metrics_.contested, metrics_.correct, metrics_.wrong,
+           (long long)metrics_.worstWrongGapUs, arbiter.rounds(), arbiter.reordered());
+
+    uint32_t dups = 0, ledSent = 0, ledRetransmits = 0, ledGaveUp = 0;
+    for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+      const ReliableLink& link = links_.delivery(i + 1);
+      dups += pressWindows_[i].duplicates();
+      ledSent += link.sent();
+      ledRetransmits += link.retransmits();
+      ledGaveUp += link.failures();
+    }
+    printf("DROPS frames=%u lost=%u mac_ack_lost=%u presses=%u press_queue_full=%u press_gave_up=%u press_dups=%u led_sent=%u led_retransmits=%u led_gave_up=%u\n",
+           metrics_.framesSent, metrics_.framesLost, metrics_.macAcksLost,
+           metrics_.presses, metrics_.pressQueueFull, metrics_.pressGaveUp, dups,
+           ledSent, ledRetransmits, ledGaveUp);
+  }
+
+  // ==========================================================================
+  // GameCore hooks (same job as ControllerGameIO in controller.cpp)
+  // ==========================================================================
+
+  int64_t nowUs() override { return nowUs_; }
+
+  void publishLedState(const LedStateMessage& frame) override {
+    publishedUs_[frame.seq & 0xFF] = nowUs_;
+    broadcastLedFrame(frame);
+    links_.published(frame);
+  }
+
+  void sendStateSync(uint8_t nodeId, const StateSyncMessage& msg) override {
+    transmit(0, nodeId, &msg, sizeof(msg), false);
+    links_.synced(nodeId, msg.led_seq);
+  }
+
+  void buzzed(uint8_t nodeId, uint64_t /* pressTimeUs */, int64_t /* marginUs */) override {
+    scoreRound(nodeId);
+  }
+
+  void report(const char* line) override {
+    if (config_.verbose) printf("%10.3f ms  %s\n", nowUs_ / 1000.0, line);
+  }
+
+  bool debugEnabled() const override { return config_.verbose; }
+
+  void debug(const char* line) override {
+    if (config_.verbose) printf("%10.3f ms  . %s\n", nowUs_ / 1000.0, line);
+  }
+
+  // ==========================================================================
+  // LinkScheduler hooks
+  // ==========================================================================
+
+  void sendHeartbeat(const HeartbeatMessage& msg) override {
+    transmit(0, msg.node_id, &msg, sizeof(msg), false);
+  }
+
+  // A broadcast reaches (or misses) each node independently
+  void broadcastLedFrame(const LedStateMessage& frame) override {
+    for (uint8_t i = 1; i <= NUM_BUZZERS; i++) {
+      transmit(0, i, &frame, sizeof(frame), false);
+    }
+  }
+
+  void resendLedFrame(uint8_t nodeId, const LedStateMessage& frame) override {
+    transmit(0, nodeId, &frame, sizeof(frame), false);
+  }
+
+private:
+  // One node's clock (node time) and radio for its NodeLink. The LED is not
+  // modelled beyond the state the link holds.
+  class NodeIO : public GameClock, public NodeLinkIO {
+  public:
+    NodeIO(Simulation& sim, const SimNode& node) : sim_(sim), node_(node) {}
+
+    int64_t nowUs() override { return node_.localUs(sim_.nowUs_); }
+
+    void sendToController(const void* data, size_t len) override {
+      sim_.transmit(node_.id, 0, data, (uint8_t)len, false);
+    }
+
+    void showLed(LEDState /* state */, int64_t /* rxTimeUs */) override {}
+
+    void log(const char* line) override {
+      printf("%10.3f ms  node %u: %s\n", sim_.nowUs_ / 1000.0, node_.id, line);
+    }
+    bool logEnabled() const override { return sim_.config_.verbose; }
+
+  private:
+    Simulation& sim_;
+    const SimNode& node_;
+  };
+
+  // ==========================================================================
+  // Event heap and medium
+  // ==========================================================================
+
+  void schedule(int64_t atUs, uint8_t type, uint8_t dst, uint8_t arg = 0,
+                const void* data = nullptr, uint8_t len = 0) {
+    SimEvent event;
+    event.atUs = atUs;
+    event.order = order_++;
+    event.type = type;
+    event.dst = dst;
+    event.arg = arg;
+    event.len = len;
+    if (len) memcpy(event.data, data, len);
+    events_.push(event);
+  }
+
+  // src/dst: 0 = controller, 1..N = node. Only press sends from a node get a
+  // send callback (the node matches no other completions).
+  void transmit(uint8_t src, uint8_t dst, const void* data, uint8_t len, bool isPress) {
+    metrics_.framesSent++;
+    int64_t airUs = config_.latencyUs + rng_.below(config_.jitterUs + 1);
+    if (rng_.chance(config_.reorder)) airUs += rng_.below(config_.reorderUs + 1);
+
+    bool lost = rng_.chance(config_.loss);
+    if (lost) {
+      metrics_.framesLost++;
+    } else {
+      schedule(nowUs_ + airUs, SIM_DELIVER, dst, src, data, len);
+    }
+
+    if (isPress) {
+      bool acked = !lost && !rng_.chance(config_.ackLoss);
+      if (!lost && !acked) metrics_.macAcksLost++;
+      schedule(nowUs_ + airUs, SIM_SEND_STATUS, src, acked ? 1 : 0);
+    }
+  }
+
+  void dispatch(const SimEvent& event) {
+    switch (event.type) {
+    case SIM_DELIVER:
+      if (event.dst == 0) {
+        controllerReceive(event.data);
+      } else {
+        nodeReceive(event.dst, event);
+      }
+      break;
+    case SIM_SEND_STATUS:
+      nodeSendStatus(nodes_[event.dst - 1], event.arg != 0);
+      break;
+    case SIM_PRESS_RETRY:
+      nodePressRetry(nodes_[event.dst - 1]);
+      break;
+    case SIM_CONTROLLER_TICK:
+      controllerTick();
+      break;
+    case SIM_HEARTBEAT:
+      controllerHeartbeat();
+      break;
+    case SIM_GAME_START:
+      startGame();
+      break;
+    case SIM_ACTION:
+      runAction(event.arg, event.dst);
+      break;
+    }
+  }
+
+  // ==========================================================================
+  // Scenario driver
+  // ==========================================================================
+
+  void startGame() {
+    gamesStarted_++;
+    if (gamesStarted_ > config_.games) return;
+
+    for (const ScriptAction& action : scenario_.actions) {
+      if (action.type == ACT_PRESS && action.node == 0) {
+        for (uint8_t i = 1; i <= NUM_BUZZERS; i++) {
+          schedule(nowUs_ + action.atUs + rng_.below(config_.spreadUs + 1),
+                   SIM_ACTION, i, ACT_PRESS);
+        }
+      } else {
+        schedule(nowUs_ + action.atUs, SIM_ACTION, action.node, action.type);
+      }
+    }
+    schedule(nowUs_ + scenario_.lengthUs, SIM_GAME_START, 0);
+  }
+
+  void runAction(uint8_t type, uint8_t node) {
+    switch (type) {
+    case ACT_PRESS:
+      nodePress(nodes_[node - 1]);
+      return;
+    case ACT_CORRECT:
+      game_.correct();
+      break;
+    case ACT_WRONG:
+      game_.wrong();
+      break;
+    case ACT_RESET:
+      game_.reset();
+      break;
+    }
+    roundPresses_.clear(); // Host command ends the round
+    armTick();
+  }
+
+  // The truly earliest press by a node that was not locked out should win
+  void scoreRound(uint8_t winner) {
+    metrics_.rounds++;
+
+    const RoundPress* first = nullptr;
+    const RoundPress* winning = nullptr;
+    NodeSet<NUM_BUZZERS> pressed;
+    for (const RoundPress& press : roundPresses_) {
+      if (game_.locked().test(press.node)) continue;
+      pressed.set(press.node);
+      if (!first || press.trueUs < first->trueUs) first = &press;
+      if (press.node == winner && (!winning || press.trueUs < winning->trueUs)) {
+        winning = &press;
+      }
+    }
+    if (!winning) return; // Cannot happen: the winner must have pressed
+
+    metrics_.pressToBuzz.add(nowUs_ - winning->trueUs);
+    if (pressed.count() >= 2) metrics_.contested++;
+    if (winning->trueUs == first->trueUs) {
+      metrics_.correct++;
+    } else {
+      metrics_.wrong++;
+      int64_t gap = winning->trueUs - first->trueUs;
+      if (gap > metrics_.worstWrongGapUs) metrics_.worstWrongGapUs = gap;
+      if (config_.verbose) {
+        printf("%10.3f ms  ! buzzer %u won, buzzer %u pressed %lld us earlier\n",
+               nowUs_ / 1000.0, winner, first->node, (long long)gap);
+      }
+    }
+  }
+
+  // ==========================================================================
+  // Controller (mirrors controller.cpp's event handling)
+  // ==========================================================================
+
+  void controllerReceive(const uint8_t* data) {
+    uint8_t nodeId = data[0];
+    if (nodeId < 1 || nodeId > NUM_BUZZERS) return;
+    uint8_t i = nodeId - 1;
+    links_.setConnected(nodeId, true); // The model never times a node out
+
+    switch (data[1]) {
+    case MSG_BUTTON_PRESS: {
+      BuzzerMessage msg;
+      memcpy(&msg, data, sizeof(msg));
+      if (!pressWindows_[i].accept(msg.press_id)) break;
+
+      int64_t pressTimeUs = nowUs_;
+      if (clocks_[i].isSynced()) {
+        pressTimeUs = clocks_[i].toController((int64_t)msg.time_us);
+      }
+      game_.press(nodeId, (uint64_t)pressTimeUs, nowUs_);
+      break;
+    }
+    case MSG_TIME_SYNC: {
+      TimeSyncMessage msg;
+      memcpy(&msg, data, sizeof(msg));
+      clocks_[i].addSample((int64_t)msg.t1_us, (int64_t)msg.t2_us,
+                           (int64_t)msg.t3_us, nowUs_);
+      links_.onReply(nodeId, (int64_t)msg.t1_us, msg.rssi, msg.flags);
+      break;
+    }
+    case MSG_STATE_REQUEST:
+      game_.syncNode(nodeId);
+      break;
+    case MSG_ACK: {
+      AckMessage msg;
+      memcpy(&msg, data, sizeof(msg));
+      links_.onAck(nodeId, msg.seq, nowUs_);
+      break;
+    }
+    }
+    armTick();
+  }
+
+  // loop() only has work while a round is arbitrated or an ACK is awaited
+  void armTick() {
+    if (tickArmed_) return;
+    if (game_.arbiter().isOpen() || links_.isPending()) {
+      tickArmed_ = true;
+      schedule(nowUs_ + config_.tickUs, SIM_CONTROLLER_TICK, 0);
+    }
+  }
+
+  void controllerTick() {
+    tickArmed_ = false;
+    game_.poll();
+    links_.retransmit(game_.ledFrame());
+    armTick();
+  }
+
+  void controllerHeartbeat() {
+    links_.heartbeat(game_.ledFrame());
+    schedule(nowUs_ + HEARTBEAT_INTERVAL_MS * 1000LL, SIM_HEARTBEAT, 0);
+  }
+
+  // ==========================================================================
+  // Buzzer nodes (mirrors buzzer_node.cpp's protocol behaviour)
+  // ==========================================================================
+
+  // The frame is handled by the node's NodeLink at its receive time in
+  // node time. An LED frame it applies completes that state's delivery.
+  void nodeReceive(uint8_t nodeId, const SimEvent& event) {
+    NodeLink& link = nodeLinks_[nodeId - 1];
+    bool hadSeq = link.hasLedSeq();
+    uint16_t heldSeq = link.ledSeq();
+    link.onFrame(event.data, event.len, nodes_[nodeId - 1].localUs(nowUs_));
+
+    bool applied = link.hasLedSeq() && (!hadSeq || link.ledSeq() != heldSeq);
+    if (applied && event.data[1] == MSG_LED_STATE) {
+      metrics_.stateToLed.add(nowUs_ - publishedUs_[link.ledSeq() & 0xFF]);
+    }
+  }
+
+  // GPIO edge: timestamped now, sent when no other press is in flight
+  void nodePress(SimNode& node) {
+    metrics_.presses++;
+    roundPresses_.push_back(RoundPress{node.id, nowUs_});
+
+    int64_t edgeUs = node.localUs(nowUs_);
+    if (!node.pressInFlight) {
+      startPress(node, edgeUs);
+    } else if (node.queuedCount < PRESS_QUEUE_LENGTH) {
+      node.queuedEdges[node.queuedCount++] = edgeUs;
+    } else {
+      metrics_.pressQueueFull++;
+    }
+  }
+
+  void startPress(SimNode& node, int64_t edgeUs) {
+    BuzzerMessage& msg = node.pressMsg;
+    msg.node_id = node.id;
+    msg.msg_type = MSG_BUTTON_PRESS;
+    msg.value = 1;
+    msg.timestamp = (uint32_t)(node.localUs(nowUs_) / 1000);
+    msg.press_id = node.nextPressId++;
+    msg.time_us = (uint64_t)edgeUs;
+
+    node.pressInFlight = true;
+    node.pressAttempts = 0;
+    transmit(node.id, 0, &msg, sizeof(msg), true);
+  }
+
+  void finishPress(SimNode& node) {
+    node.pressInFlight = false;
+    if (node.queuedCount > 0) {
+      int64_t edgeUs = node.queuedEdges[0];
+      memmove(node.queuedEdges, node.queuedEdges + 1,
+              (node.queuedCount - 1) * sizeof(node.queuedEdges[0]));
+      node.queuedCount--;
+      startPress(node, edgeUs);
+    }
+  }
+
+  void nodeSendStatus(SimNode& node, bool delivered) {
+    if (!node.pressInFlight) return;
+    if (delivered) {
+      finishPress(node);
+    } else {
+      schedule(nowUs_ + RETRY_INTERVAL_MS * 1000LL, SIM_PRESS_RETRY, node.id);
+    }
+  }
+
+  void nodePressRetry(SimNode& node) {
+    if (!node.pressInFlight) return;
+    if (node.pressAttempts >= PRESS_MAX_RETRIES) {
+      metrics_.pressGaveUp++;
+      finishPress(node);
+      return;
+    }
+    node.pressAttempts++;
+    transmit(node.id, 0, &node.pressMsg, sizeof(node.pressMsg), true);
+  }
+
+  const SimConfig& config_;
+  const Scenario& scenario_;
+  SimRandom rng_;
+  int64_t nowUs_;
+  uint64_t order_;
+  uint32_t gamesStarted_;
+  std::priority_queue<SimEvent, std::vector<SimEvent>, LaterEvent> events_;
+
+  // Controller
+  bool tickArmed_;
+  ClockSync clocks_[NUM_BUZZERS];
+  LinkScheduler<NUM_BUZZERS> links_;
+  ReplayWindow pressWindows_[NUM_BUZZERS];
+  GameCore<NUM_BUZZERS> game_;
+
+  // Nodes: press path state, and each node's protocol code with its clock
+  // and radio
+  SimNode nodes_[NUM_BUZZERS];
+  std::vector<NodeIO> nodeIO_;
+  std::vector<NodeLink> nodeLinks_;
+
+  SimMetrics metrics_;
+  std::vector<RoundPress> roundPresses_;
+  int64_t publishedUs_[256]; // By LED seq (low byte)
+};
+
+// ============================================================================
+// COMMAND LINE
+// ============================================================================
+
+void usage() {
+  fprintf(stderr,
+          "usage: program [options]\n"
+          "  --games N          games to simulate (1000)\n"
+          "  --seed N           random seed (1)\n"
+          "  --scenario S       race | lockout | script file (race)\n"
+          "  --latency-us N     one-way latency (1000)\n"
+          "  --jitter-us N      extra latency 0..N (500)\n"
+          "  --loss P           frame loss probability (0)\n"
+          "  --ack-loss P       lost MAC ACK probability (0)\n"
+          "  --reorder P        probability a frame is held back (0)\n"
+          "  --reorder-us N     longest hold back (3000)\n"
+          "  --spread-us N      'press *' spread (1000)\n"
+          "  --drift-ppm X      node clock error +-X ppm (20)\n"
+          "  --window-ms N      arbitration window (%u)\n"
+          "  --tick-us N        controller loop period (500)\n"
+          "  --verbose          print every report/debug line\n",
+          ARBITRATION_WINDOW_MS);
+}
+
+bool parseArgs(int argc, char** argv, SimConfig& config) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--verbose") == 0) {
+      config.verbose = true;
+      continue;
+    }
+    if (i + 1 >= argc) return false;
+    const char* value = argv[++i];
+
+    if (strcmp(arg, "--games") == 0) config.games = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--seed") == 0) config.seed = strtoull(value, nullptr, 10);
+    else if (strcmp(arg, "--scenario") == 0) config.scenario = value;
+    else if (strcmp(arg, "--latency-us") == 0) config.latencyUs = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--jitter-us") == 0) config.jitterUs = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--loss") == 0) config.loss = atof(value);
+    else if (strcmp(arg, "--ack-loss") == 0) config.ackLoss = atof(value);
+    else if (strcmp(arg, "--reorder") == 0) config.reorder = atof(value);
+    else if (strcmp(arg, "--reorder-us") == 0) config.reorderUs = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--spread-us") == 0) config.spreadUs = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--drift-ppm") == 0) config.driftPpm = atof(value);
+    else if (strcmp(arg, "--window-ms") == 0) config.windowMs = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--tick-us") == 0) config.tickUs = strtoul(value, nullptr, 10);
+    else return false;
+  }
+  return config.tickUs > 0;
+}
+
+int main(int argc, char** argv) {
+  SimConfig config;
+  if (!parseArgs(argc, argv, config)) {
+    usage();
+    return 2;
+  }
+
+  Scenario scenario;
+  if (!loadScenario(config.scenario, config.settleMs, scenario)) return 2;
+
+  Simulation sim(config, scenario);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  sim.run();
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+  sim.printReport(wall.count());
+  return 0;
+}
@@ -0,0 +1,149 @@
+// BleTxBatcher: deadline and MTU triggers, batching, splitting, overflow,
+// congestion hold-off, and byte-exact reassembly on the client side.
+
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "ble_tx.h"
+
+const uint32_t DEADLINE_US = 5000;
+typedef BleTxBatcher<256> Batcher;
+
+bool appendLine(Batcher& tx, const char* line, int64_t nowUs) {
+  return tx.append((const uint8_t*)line, strlen(line), nowUs);
+}
+
+// Send every due chunk at `nowUs`, appending what went out to `client`
+int drain(Batcher& tx, int64_t nowUs, std::string& client) {
+  const uint8_t* data;
+  size_t len;
+  int sent = 0;
+  while (tx.due(nowUs, data, len)) {
+    client.append((const char*)data, len);
+    tx.consume(len);
+    sent++;
+  }
+  return sent;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_small_message_waits_for_deadline() {
+  Batcher tx(20, DEADLINE_US);
+  std::string client;
+  TEST_ASSERT_TRUE(appendLine(tx, "BUZZ 1\n", 1000));
+  TEST_ASSERT_EQUAL(0, drain(tx, 1000 + DEADLINE_US - 1, client));
+  TEST_ASSERT_EQUAL(1, drain(tx, 1000 + DEADLINE_US, client));
+  TEST_ASSERT_EQUAL_STRING("BUZZ 1\n", client.c_str());
+  TEST_ASSERT_EQUAL_UINT16(0, tx.pendingBytes());
+}
+
+void test_messages_within_deadline_share_a_notification() {
+  Batcher tx(32, DEADLINE_US);
+  std::string client;
+  appendLine(tx, "BUZZ 1\n", 0);
+  appendLine(tx, "WRONG\n", 1000);
+  appendLine(tx, "BUZZ 2\n", 2000);
+  // Age counts from the oldest message
+  TEST_ASSERT_EQUAL(0, drain(tx, DEADLINE_US - 1, client));
+  TEST_ASSERT_EQUAL(1, drain(tx, DEADLINE_US, client));
+  TEST_ASSERT_EQUAL_STRING("BUZZ 1\nWRONG\nBUZZ 2\n", client.c_str());
+  TEST_ASSERT_EQUAL_UINT32(3, tx.messages());
+  TEST_ASSERT_EQUAL_UINT32(1, tx.notifications());
+  TEST_ASSERT_EQUAL_UINT16(20, tx.maxChunk());
+}
+
+void test_full_payload_goes_out_immediately() {
+  Batcher tx(20, DEADLINE_US);
+  std::string client;
+  appendLine(tx, "0123456789", 0);
+  TEST_ASSERT_EQUAL(0, drain(tx, 0, client));
+  appendLine(tx, "abcdefghijKLM", 0);
+  // One full MTU now; the 3-byte remainder waits for the deadline
+  TEST_ASSERT_EQUAL(1, drain(tx, 0, client));
+  TEST_ASSERT_EQUAL_STRING("0123456789abcdefghij", client.c_str());
+  TEST_ASSERT_EQUAL_UINT16(3, tx.pendingBytes());
+  TEST_ASSERT_EQUAL(1, drain(tx, DEADLINE_US, client));
+  TEST_ASSERT_EQUAL_STRING("0123456789abcdefghijKLM", client.c_str());
+}
+
+void test_long_message_split_across_notifications() {
+  Batcher tx(20, DEADLINE_US);
+  std::string client;
+  std::string line(95, 'x');
+  line += '\n';
+  TEST_ASSERT_TRUE(appendLine(tx, line.c_str(), 0));
+  TEST_ASSERT_EQUAL(4, drain(tx, 0, client)); // 4 full chunks now
+  TEST_ASSERT_EQUAL(1, drain(tx, DEADLINE_US, client));
+  TEST_ASSERT_TRUE(client == line);
+  TEST_ASSERT_EQUAL_UINT32(96, tx.bytes());
+}
+
+void test_overflow_rejects_whole_message() {
+  BleTxBatcher<16> tx(20, DEADLINE_US);
+  TEST_ASSERT_TRUE(tx.append((const uint8_t*)"0123456789", 10, 0));
+  TEST_ASSERT_FALSE(tx.append((const uint8_t*)"abcdefg", 7, 0));
+  TEST_ASSERT_EQUAL_UINT16(10, tx.pendingBytes());
+  TEST_ASSERT_EQUAL_UINT16(6, tx.freeBytes());
+  TEST_ASSERT_EQUAL_UINT32(1, tx.dropped());
+}
+
+void test_hold_off_after_congestion() {
+  Batcher tx(20, DEADLINE_US);
+  std::string client;
+  appendLine(tx, "BUZZ 1\n", 0);
+  tx.holdOff(DEADLINE_US); // Stack refused the chunk
+  TEST_ASSERT_EQUAL(0, drain(tx, 2 * DEADLINE_US - 1, client));
+  TEST_ASSERT_EQUAL(1, drain(tx, 2 * DEADLINE_US, client));
+  TEST_ASSERT_EQUAL_STRING("BUZZ 1\n", client.c_str());
+}
+
+void test_clear_and_payload_limit() {
+  Batcher tx(20, DEADLINE_US);
+  appendLine(tx, "BUZZ 1\n", 0);
+  tx.holdOff(0);
+  tx.clear();
+  TEST_ASSERT_EQUAL_UINT16(0, tx.pendingBytes());
+
+  tx.setPayloadLimit(0);
+  TEST_ASSERT_EQUAL_UINT16(1, tx.payloadLimit());
+  tx.setPayloadLimit(1000);
+  TEST_ASSERT_EQUAL_UINT16(256, tx.payloadLimit());
+
+  // A cleared hold-off does not delay the next client
+  std::string client;
+  tx.setPayloadLimit(20);
+  appendLine(tx, "RESET\n", 0);
+  TEST_ASSERT_EQUAL(1, drain(tx, DEADLINE_US, client));
+}
+
+void test_stream_reassembles_byte_exact() {
+  Batcher tx(23, DEADLINE_US); // Default ATT MTU payload
+  std::string expected, client;
+  int64_t now = 0;
+  for (int i = 0; i < 500; i++) {
+    char line[32];
+    snprintf(line, sizeof(line), "BUZZ %d MARGIN_US:%d\n", i % 64 + 1, i * 7);
+    if (appendLine(tx, line, now)) expected += line;
+    now += 700;
+    drain(tx, now, client);
+  }
+  drain(tx, now + DEADLINE_US, client);
+  TEST_ASSERT_TRUE(client == expected);
+  TEST_ASSERT_TRUE(tx.maxChunk() <= 23);
+  TEST_ASSERT_TRUE(tx.notifications() < tx.messages()); // Batching helped
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_small_message_waits_for_deadline);
+  RUN_TEST(test_messages_within_deadline_share_a_notification);
+  RUN_TEST(test_full_payload_goes_out_immediately);
+  RUN_TEST(test_long_message_split_across_notifications);
+  RUN_TEST(test_overflow_rejects_whole_message);
+  RUN_TEST(test_hold_off_after_congestion);
+  RUN_TEST(test_clear_and_payload_limit);
+  RUN_TEST(test_stream_reassembles_byte_exact);
+  return UNITY_END();
+}
@@ -0,0 +1,113 @@
+// Button: press/long-press/release events and the loop-latency guarantee
+// that a held button never stalls the caller's loop.
+
+#include <chrono>
+#include <vector>
+#include <unity.h>
+#include "button.h"
+
+const uint32_t LOCKOUT_US = 50000;
+const uint32_t LONG_PRESS_US = 1000000;
+const uint32_t LOOP_PERIOD_US = 1000;     // Simulated loop iteration spacing
+const uint32_t HEARTBEAT_US = 100000;     // Periodic work the loop must keep doing
+const int64_t MAX_ITERATION_NS = 1000000; // Wall-clock budget per iteration (1 ms)
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_press_long_press_release_sequence() {
+  Button button(LOCKOUT_US, LONG_PRESS_US);
+  TEST_ASSERT_EQUAL(Button::EVENT_PRESS, button.update(0, 1000));
+  TEST_ASSERT_EQUAL(Button::EVENT_NONE, button.update(0, 1000 + LONG_PRESS_US - 1));
+  TEST_ASSERT_EQUAL(Button::EVENT_LONG_PRESS, button.update(0, 1000 + LONG_PRESS_US));
+  TEST_ASSERT_TRUE(button.wasLongPress());
+  // Fires once per hold
+  TEST_ASSERT_EQUAL(Button::EVENT_NONE, button.update(0, 1000 + 3 * LONG_PRESS_US));
+  TEST_ASSERT_EQUAL(Button::EVENT_RELEASE, button.update(1, 1000 + 3 * LONG_PRESS_US + 1));
+
+  // The next press re-arms it
+  uint32_t next = 1000 + 4 * LONG_PRESS_US;
+  TEST_ASSERT_EQUAL(Button::EVENT_PRESS, button.update(0, next));
+  TEST_ASSERT_FALSE(button.wasLongPress());
+  TEST_ASSERT_EQUAL(Button::EVENT_LONG_PRESS, button.update(0, next + LONG_PRESS_US));
+}
+
+void test_short_press_never_fires_long_press() {
+  Button button(LOCKOUT_US, LONG_PRESS_US);
+  TEST_ASSERT_EQUAL(Button::EVENT_PRESS, button.update(0, 0));
+  TEST_ASSERT_EQUAL(Button::EVENT_RELEASE, button.update(1, LOCKOUT_US));
+  TEST_ASSERT_EQUAL(Button::EVENT_NONE, button.update(1, 2 * LONG_PRESS_US));
+  TEST_ASSERT_FALSE(button.wasLongPress());
+}
+
+void test_long_press_disabled_by_default() {
+  Button button(LOCKOUT_US);
+  TEST_ASSERT_EQUAL(Button::EVENT_PRESS, button.update(0, 0));
+  for (uint32_t t = LOOP_PERIOD_US; t < 10 * LONG_PRESS_US; t += LOOP_PERIOD_US) {
+    TEST_ASSERT_EQUAL(Button::EVENT_NONE, button.update(0, t));
+  }
+  TEST_ASSERT_TRUE(button.isPressed());
+}
+
+// The controller's input loop: three buttons, then the periodic work that
+// used to stall while a button was held (heartbeats, timeouts, serial).
+void test_loop_latency_bounded_while_button_held() {
+  Button correct(LOCKOUT_US);
+  Button wrong(LOCKOUT_US);
+  Button reset(LOCKOUT_US, LONG_PRESS_US);
+
+  const uint32_t holdStart = 10000;
+  const uint32_t holdEnd = holdStart + 5000000; // CORRECT and RESET held 5 s
+  const uint32_t runEnd = holdEnd + 500000;
+
+  std::vector<Button::Event> correctEvents, resetEvents;
+  uint32_t heartbeats = 0;
+  uint32_t lastHeartbeat = 0;
+  uint32_t maxHeartbeatGap = 0;
+  int64_t maxIterationNs = 0;
+
+  for (uint32_t now = 0; now <= runEnd; now += LOOP_PERIOD_US) {
+    bool held = now >= holdStart && now < holdEnd;
+    auto start = std::chrono::steady_clock::now();
+
+    Button::Event e = correct.update(held ? 0 : 1, now);
+    if (e != Button::EVENT_NONE) correctEvents.push_back(e);
+    wrong.update(1, now);
+    e = reset.update(held ? 0 : 1, now);
+    if (e != Button::EVENT_NONE) resetEvents.push_back(e);
+
+    if (now - lastHeartbeat >= HEARTBEAT_US) {
+      if (now - lastHeartbeat > maxHeartbeatGap) maxHeartbeatGap = now - lastHeartbeat;
+      lastHeartbeat = now;
+      heartbeats++;
+    }
+
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    if (ns > maxIterationNs) maxIterationNs = ns;
+  }
+
+  // Every iteration returned promptly, and periodic work never slipped
+  TEST_ASSERT_TRUE(maxIterationNs < MAX_ITERATION_NS);
+  TEST_ASSERT_EQUAL_UINT32(HEARTBEAT_US, maxHeartbeatGap);
+  TEST_ASSERT_EQUAL_UINT32(runEnd / HEARTBEAT_US, heartbeats);
+
+  // Edges were still reported on time around the hold
+  TEST_ASSERT_EQUAL(2, (int)correctEvents.size());
+  TEST_ASSERT_EQUAL(Button::EVENT_PRESS, correctEvents[0]);
+  TEST_ASSERT_EQUAL(Button::EVENT_RELEASE, correctEvents[1]);
+  TEST_ASSERT_EQUAL(3, (int)resetEvents.size());
+  TEST_ASSERT_EQUAL(Button::EVENT_PRESS, resetEvents[0]);
+  TEST_ASSERT_EQUAL(Button::EVENT_LONG_PRESS, resetEvents[1]);
+  TEST_ASSERT_EQUAL(Button::EVENT_RELEASE, resetEvents[2]);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_press_long_press_release_sequence);
+  RUN_TEST(test_short_press_never_fires_long_press);
+  RUN_TEST(test_long_press_disabled_by_default);
+  RUN_TEST(test_loop_latency_bounded_while_button_held);
+  return UNITY_END();
+}
@@ -0,0 +1,175 @@
+// ClockSync: offset and drift estimation from simulated heartbeat
+// exchanges with a node whose crystal runs fast.
+
+#include <unity.h>
+#include "clock_sync.h"
+
+// Node clock model: node = ctrl * (1 + ppm / 1e6) + offset
+struct NodeClock {
+  int64_t offsetUs;
+  double ppm;
+  int64_t at(int64_t ctrlUs) const {
+    return ctrlUs + offsetUs + (int64_t)((double)ctrlUs * ppm / 1e6);
+  }
+};
+
+// One heartbeat exchange starting at controller time t1, with the given
+// one-way delays and node turnaround
+bool exchange(ClockSync& sync, const NodeClock& node, int64_t t1, int64_t upUs,
+              int64_t downUs, int64_t turnaroundUs = 200) {
+  int64_t t2 = node.at(t1 + upUs);
+  int64_t t3 = node.at(t1 + upUs + turnaroundUs);
+  int64_t t4 = t1 + upUs + turnaroundUs + downUs;
+  return sync.addSample(t1, t2, t3, t4);
+}
+
+const int64_t HEARTBEAT_US = 2000000; // HEARTBEAT_INTERVAL_MS
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_unsynced_until_first_sample() {
+  ClockSync sync;
+  TEST_ASSERT_FALSE(sync.isSynced());
+  NodeClock node = {123456, 0};
+  TEST_ASSERT_TRUE(exchange(sync, node, 1000000, 800, 800));
+  TEST_ASSERT_TRUE(sync.isSynced());
+  TEST_ASSERT_EQUAL_UINT8(1, sync.sampleCount());
+  TEST_ASSERT_EQUAL_INT64(123456, sync.offsetUs());
+  TEST_ASSERT_EQUAL_UINT32(1600, sync.bestRttUs());
+}
+
+void test_asymmetric_delay_stays_within_error_bound() {
+  ClockSync sync;
+  NodeClock node = {-50000, 0};
+  exchange(sync, node, 1000000, 300, 1300);
+
+  int64_t error = sync.offsetUs() - node.offsetUs;
+  if (error < 0) error = -error;
+  TEST_ASSERT_TRUE(error > 0); // Asymmetry is invisible to the exchange...
+  TEST_ASSERT_TRUE(error <= (int64_t)sync.errorBoundUs()); // ...but bounded
+}
+
+void test_tracks_crystal_drift() {
+  ClockSync sync;
+  NodeClock node = {250000, 40.0}; // 40 ppm fast
+  int64_t t1 = 0;
+  for (int i = 0; i < ClockSync::WINDOW; i++) {
+    t1 = 1000000LL + i * HEARTBEAT_US;
+    TEST_ASSERT_TRUE(exchange(sync, node, t1, 900, 900));
+    // No drift until the samples span several heartbeats
+    if (t1 - 1000000LL < (int64_t)ClockSync::MIN_DRIFT_SPAN_US) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)sync.driftPpm());
+    }
+  }
+
+  TEST_ASSERT_TRUE(sync.driftPpm() > 39.0 && sync.driftPpm() < 41.0);
+
+  // A press stamped on the node 3 s after the last heartbeat maps back to
+  // controller time within a few µs
+  int64_t ctrlPress = t1 + 3000000LL;
+  int64_t mapped = sync.toController(node.at(ctrlPress));
+  int64_t error = mapped - ctrlPress;
+  if (error < 0) error = -error;
+  TEST_ASSERT_TRUE(error <= 5);
+}
+
+void test_queued_samples_do_not_move_estimate() {
+  ClockSync sync;
+  NodeClock node = {10000, 0};
+  for (int i = 0; i < 8; i++) {
+    exchange(sync, node, 1000000LL * (i + 1), 500, 500);
+  }
+  int64_t before = sync.offsetUs();
+  uint32_t bound = sync.errorBoundUs();
+
+  // Reply sat in a busy queue: large RTT, heavily asymmetric
+  TEST_ASSERT_TRUE(exchange(sync, node, 9000000, 500, 9000));
+  TEST_ASSERT_EQUAL_INT64(before, sync.offsetAt(9000000 + 5100));
+  TEST_ASSERT_EQUAL_UINT32(bound, sync.errorBoundUs());
+  TEST_ASSERT_EQUAL_UINT32(1000, sync.bestRttUs());
+}
+
+void test_rejects_impossible_round_trips() {
+  ClockSync sync;
+  NodeClock node = {0, 0};
+  TEST_ASSERT_FALSE(exchange(sync, node, 1000000, 15000, 15000)); // > MAX_RTT_US
+  // Node turnaround longer than the whole exchange: negative RTT
+  TEST_ASSERT_FALSE(sync.addSample(1000000, 1000100, 1005000, 1001000));
+  TEST_ASSERT_FALSE(sync.isSynced());
+  TEST_ASSERT_EQUAL_UINT8(0, sync.sampleCount());
+}
+
+void test_node_reboot_restarts_estimate() {
+  ClockSync sync;
+  NodeClock node = {5000000, 0};
+  for (int i = 0; i < 5; i++) {
+    exchange(sync, node, 1000000LL * (i + 1), 700, 700);
+  }
+  TEST_ASSERT_EQUAL_UINT8(5, sync.sampleCount());
+
+  // Node restarts: its clock is back near zero
+  NodeClock rebooted = {-6000000, 0};
+  TEST_ASSERT_TRUE(exchange(sync, rebooted, 6000000, 700, 700));
+  TEST_ASSERT_EQUAL_UINT8(1, sync.sampleCount());
+  TEST_ASSERT_EQUAL_INT64(-6000000, sync.offsetUs());
+}
+
+void test_window_holds_last_samples() {
+  ClockSync sync;
+  NodeClock node = {0, 0};
+  for (int i = 0; i < ClockSync::WINDOW + 5; i++) {
+    exchange(sync, node, 1000000LL * (i + 1), 600, 600);
+  }
+  TEST_ASSERT_EQUAL_UINT8(ClockSync::WINDOW, sync.sampleCount());
+}
+
+// Uniform jitter of up to 500 µs on each leg, the kind BLE connection events
+// add. The mapped time of a press 1 s after each heartbeat stays within 1 ms,
+// for a crystal on time and one near the edge of its tolerance.
+void test_jittered_exchanges_stay_within_1ms() {
+  const double ppms[] = {0, 20, 40, -40};
+  uint32_t seed = 12345;
+  for (double ppm : ppms) {
+    for (int run = 0; run < 20; run++) {
+      ClockSync sync;
+      NodeClock node = {-3000000LL + run * 77777LL, ppm};
+      for (int i = 0; i < 60; i++) {
+        int64_t t1 = 1000000LL + i * HEARTBEAT_US;
+        seed = seed * 1103515245u + 12345u;
+        int64_t up = 1000 + (seed >> 8) % 501;
+        seed = seed * 1103515245u + 12345u;
+        int64_t down = 1000 + (seed >> 8) % 501;
+        TEST_ASSERT_TRUE(exchange(sync, node, t1, up, down));
+
+        int64_t ctrlPress = t1 + 1000000LL;
+        int64_t error = sync.toController(node.at(ctrlPress)) - ctrlPress;
+        if (error < 0) error = -error;
+        TEST_ASSERT_TRUE(error < 1000);
+      }
+    }
+  }
+}
+
+void test_drift_clamped_to_crystal_tolerance() {
+  ClockSync sync;
+  NodeClock node = {0, 500.0}; // No crystal is this far off
+  for (int i = 0; i < ClockSync::WINDOW; i++) {
+    exchange(sync, node, 1000000LL + i * HEARTBEAT_US, 900, 900);
+  }
+  TEST_ASSERT_EQUAL_FLOAT((float)ClockSync::MAX_DRIFT_PPM, (float)sync.driftPpm());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_unsynced_until_first_sample);
+  RUN_TEST(test_asymmetric_delay_stays_within_error_bound);
+  RUN_TEST(test_tracks_crystal_drift);
+  RUN_TEST(test_queued_samples_do_not_move_estimate);
+  RUN_TEST(test_rejects_impossible_round_trips);
+  RUN_TEST(test_node_reboot_restarts_estimate);
+  RUN_TEST(test_window_holds_last_samples);
+  RUN_TEST(test_jittered_exchanges_stay_within_1ms);
+  RUN_TEST(test_drift_clamped_to_crystal_tolerance);
+  return UNITY_END();
+}
@@ -0,0 +1,188 @@
+// Debouncer: replays recorded-style bounce and glitch traces and checks
+// that presses are accepted on the leading edge and that further edges are
+// ignored for exactly the lockout interval.
+
+#include <vector>
+#include <unity.h>
+#include "debounce.h"
+
+const uint32_t LOCKOUT_US = 5000;
+const uint32_t SAMPLE_US = 50; // Polling period used to replay a trace
+
+// One raw level change in a trace (active low: 0 = pressed)
+struct Edge {
+  uint32_t timeUs;
+  int level;
+};
+
+struct Accepted {
+  Debouncer::Event event;
+  uint32_t timeUs;
+};
+
+// Sample the trace every SAMPLE_US from `start` to `end`, holding the level
+// between edges, and collect the debounced events.
+std::vector<Accepted> replay(Debouncer& debouncer, const std::vector<Edge>& trace,
+                             uint32_t start, uint32_t end) {
+  std::vector<Accepted> events;
+  size_t next = 0;
+  int level = 1;
+  for (uint32_t now = start; (int32_t)(end - now) >= 0; now += SAMPLE_US) {
+    while (next < trace.size() && (int32_t)(now - trace[next].timeUs) >= 0) {
+      level = trace[next++].level;
+    }
+    Debouncer::Event event = debouncer.update(level, now);
+    if (event != Debouncer::EVENT_NONE) {
+      Accepted accepted = {event, now};
+      events.push_back(accepted);
+    }
+  }
+  return events;
+}
+
+// A press that chatters for ~3 ms, held, then a release that chatters too
+std::vector<Edge> bouncyPressTrace() {
+  return {
+      {1000, 0}, {1150, 1}, {1300, 0}, {1700, 1}, {1750, 0}, {2400, 1}, {2450, 0},
+      {3900, 1}, {3950, 0}, // Late bounce, still inside the lockout
+      {50000, 1}, {50100, 0}, {50400, 1}, {51000, 0}, {51050, 1},
+  };
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bouncy_press_reports_one_event_per_edge() {
+  Debouncer debouncer(LOCKOUT_US);
+  std::vector<Accepted> events = replay(debouncer, bouncyPressTrace(), 0, 100000);
+
+  TEST_ASSERT_EQUAL(2, (int)events.size());
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_PRESSED, events[0].event);
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, events[1].event);
+  TEST_ASSERT_FALSE(debouncer.isPressed());
+}
+
+void test_press_accepted_on_leading_edge() {
+  Debouncer debouncer(LOCKOUT_US);
+  std::vector<Accepted> events = replay(debouncer, bouncyPressTrace(), 0, 100000);
+
+  // No added latency: the first sample at or after the first edge
+  TEST_ASSERT_EQUAL_UINT32(1000, events[0].timeUs);
+  TEST_ASSERT_EQUAL_UINT32(50000, events[1].timeUs);
+  TEST_ASSERT_EQUAL_UINT32(50000, debouncer.lastEdgeTime());
+}
+
+void test_edges_ignored_for_lockout_interval() {
+  Debouncer debouncer(LOCKOUT_US);
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_PRESSED, debouncer.update(0, 1000));
+
+  // Released and re-pressed while locked out: nothing
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_NONE, debouncer.update(1, 1001));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_NONE, debouncer.update(1, 1000 + LOCKOUT_US - 1));
+  TEST_ASSERT_TRUE(debouncer.isPressed());
+
+  // The window closes exactly `lockout` after the accepted edge
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, debouncer.update(1, 1000 + LOCKOUT_US));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_NONE, debouncer.update(0, 1000 + LOCKOUT_US + 1));
+}
+
+void test_accepted_edges_never_closer_than_lockout() {
+  // Worst case chatter: the level toggles every sample for 40 ms
+  std::vector<Edge> trace;
+  for (uint32_t t = 1000; t < 41000; t += SAMPLE_US) {
+    Edge edge = {t, (int)((t / SAMPLE_US) & 1)};
+    trace.push_back(edge);
+  }
+  Debouncer debouncer(LOCKOUT_US);
+  std::vector<Accepted> events = replay(debouncer, trace, 0, 60000);
+
+  TEST_ASSERT_TRUE(events.size() >= 2);
+  TEST_ASSERT_TRUE(events.size() <= 40000 / LOCKOUT_US + 2);
+  for (size_t i = 1; i < events.size(); i++) {
+    TEST_ASSERT_TRUE(events[i].timeUs - events[i - 1].timeUs >= LOCKOUT_US);
+    TEST_ASSERT_TRUE(events[i].event != events[i - 1].event); // Strictly alternating
+  }
+}
+
+void test_short_tap_release_reported_when_lockout_expires() {
+  // 1 ms tap: the release edge falls inside the lockout
+  std::vector<Edge> trace = {{2000, 0}, {3000, 1}};
+  Debouncer debouncer(LOCKOUT_US);
+  std::vector<Accepted> events = replay(debouncer, trace, 0, 20000);
+
+  TEST_ASSERT_EQUAL(2, (int)events.size());
+  TEST_ASSERT_EQUAL_UINT32(2000, events[0].timeUs);
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, events[1].event);
+  TEST_ASSERT_EQUAL_UINT32(2000 + LOCKOUT_US, events[1].timeUs);
+}
+
+void test_glitch_yields_at_most_one_pair_per_lockout() {
+  // Single-sample EMI spikes 1 ms apart while the button is idle
+  std::vector<Edge> trace = {
+      {1000, 0}, {1050, 1}, {2000, 0}, {2050, 1}, {3000, 0}, {3050, 1},
+  };
+  Debouncer debouncer(LOCKOUT_US);
+  std::vector<Accepted> events = replay(debouncer, trace, 0, 20000);
+
+  // The first spike is indistinguishable from a press; the rest are swallowed
+  TEST_ASSERT_EQUAL(2, (int)events.size());
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_PRESSED, events[0].event);
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, events[1].event);
+  TEST_ASSERT_EQUAL_UINT32(1000 + LOCKOUT_US, events[1].timeUs);
+}
+
+void test_dropout_on_held_button_recovers_after_lockout() {
+  std::vector<Edge> trace = {{1000, 0}, {20000, 1}, {20050, 0}, {40000, 1}};
+  Debouncer debouncer(LOCKOUT_US);
+  std::vector<Accepted> events = replay(debouncer, trace, 0, 60000);
+
+  // A 50 µs dropout on the held button reads as a release (leading edge);
+  // the level is back by the time the lockout expires, so it re-presses
+  // exactly then and the real release follows normally
+  TEST_ASSERT_EQUAL(4, (int)events.size());
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, events[1].event);
+  TEST_ASSERT_EQUAL_UINT32(20000, events[1].timeUs);
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_PRESSED, events[2].event);
+  TEST_ASSERT_EQUAL_UINT32(20000 + LOCKOUT_US, events[2].timeUs);
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, events[3].event);
+  TEST_ASSERT_EQUAL_UINT32(40000, events[3].timeUs);
+}
+
+void test_active_high_input() {
+  Debouncer debouncer(LOCKOUT_US, false);
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_NONE, debouncer.update(0, 0));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_PRESSED, debouncer.update(1, 100));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, debouncer.update(0, 100 + LOCKOUT_US));
+}
+
+void test_lockout_across_timer_wrap() {
+  Debouncer debouncer(LOCKOUT_US);
+  uint32_t edge = 0xFFFFFFFFu - 1000;
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_PRESSED, debouncer.update(0, edge));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_NONE, debouncer.update(1, edge + LOCKOUT_US - 1));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, debouncer.update(1, edge + LOCKOUT_US));
+}
+
+void test_accept_starts_lockout() {
+  Debouncer debouncer(LOCKOUT_US);
+  debouncer.accept(true, 500); // Edge already taken by the ISR
+  TEST_ASSERT_TRUE(debouncer.isPressed());
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_NONE, debouncer.update(0, 600));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_NONE, debouncer.update(1, 500 + LOCKOUT_US - 1));
+  TEST_ASSERT_EQUAL(Debouncer::EVENT_RELEASED, debouncer.update(1, 500 + LOCKOUT_US));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bouncy_press_reports_one_event_per_edge);
+  RUN_TEST(test_press_accepted_on_leading_edge);
+  RUN_TEST(test_edges_ignored_for_lockout_interval);
+  RUN_TEST(test_accepted_edges_never_closer_than_lockout);
+  RUN_TEST(test_short_tap_release_reported_when_lockout_expires);
+  RUN_TEST(test_glitch_yields_at_most_one_pair_per_lockout);
+  RUN_TEST(test_dropout_on_held_button_recovers_after_lockout);
+  RUN_TEST(test_active_high_input);
+  RUN_TEST(test_lockout_across_timer_wrap);
+  RUN_TEST(test_accept_starts_lockout);
+  return UNITY_END();
+}
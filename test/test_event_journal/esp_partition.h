@@ -0,0 +1,90 @@
+#ifndef FAKE_ESP_PARTITION_H
+#define FAKE_ESP_PARTITION_H
+
+// Host stand-in for the ESP-IDF partition API used by event_journal.h: one
+// data partition backed by RAM that behaves like NOR flash (erase sets every
+// bit of a sector, programming can only clear bits). Tests reach the
+// contents and the operation counts through fakeFlash.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum { ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82 } esp_partition_subtype_t;
+typedef enum { SPI_FLASH_MMAP_DATA } spi_flash_mmap_memory_t;
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t size;
+  const char* label;
+} esp_partition_t;
+
+struct FakeFlash {
+  static const uint32_t MAX_SECTORS = 8;
+  uint8_t data[MAX_SECTORS * SPI_FLASH_SEC_SIZE];
+  esp_partition_t partition;
+  uint32_t writes;
+  uint32_t erases;
+
+  // Blank (erased) partition of the given size
+  void reset(uint32_t sectors) {
+    memset(data, 0xFF, sizeof(data));
+    partition.type = ESP_PARTITION_TYPE_DATA;
+    partition.subtype = ESP_PARTITION_SUBTYPE_DATA_SPIFFS;
+    partition.size = sectors * SPI_FLASH_SEC_SIZE;
+    partition.label = "spiffs";
+    writes = 0;
+    erases = 0;
+  }
+};
+
+static FakeFlash fakeFlash;
+
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
+                                                       esp_partition_subtype_t subtype,
+                                                       const char* label) {
+  const esp_partition_t& p = fakeFlash.partition;
+  if (type != p.type || subtype != p.subtype || strcmp(label, p.label) != 0) return nullptr;
+  return &p;
+}
+
+inline esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+                                    spi_flash_mmap_memory_t, const void** out,
+                                    spi_flash_mmap_handle_t* handle) {
+  if (offset + size > partition->size) return ESP_ERR_INVALID_ARG;
+  *out = fakeFlash.data + offset;
+  *handle = 1;
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset,
+                                     const void* src, size_t size) {
+  if (offset + size > partition->size) return ESP_ERR_INVALID_ARG;
+  const uint8_t* bytes = (const uint8_t*)src;
+  for (size_t i = 0; i < size; i++) fakeFlash.data[offset + i] &= bytes[i];
+  fakeFlash.writes++;
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset,
+                                           size_t size) {
+  if (offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE ||
+      offset + size > partition->size) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(fakeFlash.data + offset, 0xFF, size);
+  fakeFlash.erases++;
+  return ESP_OK;
+}
+
+#endif // FAKE_ESP_PARTITION_H
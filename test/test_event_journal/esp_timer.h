@@ -0,0 +1,12 @@
+#ifndef FAKE_ESP_TIMER_H
+#define FAKE_ESP_TIMER_H
+
+// Host stand-in for esp_timer: time only moves when a test sets it
+
+#include <stdint.h>
+
+static int64_t fakeNowUs = 0;
+
+inline int64_t esp_timer_get_time() { return fakeNowUs; }
+
+#endif // FAKE_ESP_TIMER_H
@@ -0,0 +1,246 @@
+// EventJournal on a RAM-backed partition (esp_partition.h and esp_timer.h
+// in this directory): batching in the RAM buffer, one page per flush(), the
+// sector ring and its rebuild on boot, CRC checks, and what happens when the
+// buffer fills while erasing is not allowed.
+
+#include <unity.h>
+#include "event_journal.h"
+
+const uint32_t SECTORS = 3;
+const uint16_t PAGE = EventJournal::PAGE_RECORDS;
+
+void setUp(void) {
+  fakeFlash.reset(SECTORS);
+  fakeNowUs = 0;
+}
+void tearDown(void) {}
+
+// Records n..n+count-1: time and value both n, so order is easy to check
+void appendRecords(EventJournal& journal, uint32_t n, uint32_t count) {
+  for (uint32_t i = n; i < n + count; i++) {
+    TEST_ASSERT_TRUE(journal.append(JRN_PRESS, 1, i, i));
+  }
+}
+
+// Write everything buffered, erasing as needed
+void drain(EventJournal& journal) {
+  while (journal.flush(fakeNowUs, 0, true) > 0) {}
+}
+
+// Append and write any number of records, a page at a time
+void writeRecords(EventJournal& journal, uint32_t n, uint32_t count) {
+  for (uint32_t i = 0; i < count; i += PAGE) {
+    appendRecords(journal, n + i, count - i < PAGE ? count - i : PAGE);
+    drain(journal);
+  }
+}
+
+// Read the whole journal back: count, first and last value, and that the
+// values run on without a gap
+struct ReadBack {
+  uint32_t count;
+  uint32_t first;
+  uint32_t last;
+  bool contiguous;
+  uint32_t bad;
+};
+
+ReadBack readBack(const EventJournal& journal) {
+  ReadBack r = {0, 0, 0, true, 0};
+  EventJournal::Cursor cursor;
+  journal.openCursor(cursor);
+  JournalRecord record;
+  while (journal.next(cursor, record)) {
+    if (r.count == 0) {
+      r.first = record.value;
+    } else if (record.value != r.last + 1) {
+      r.contiguous = false;
+    }
+    TEST_ASSERT_EQUAL_UINT64(record.value, record.timeUs);
+    r.last = record.value;
+    r.count++;
+  }
+  r.bad = cursor.bad;
+  return r;
+}
+
+void test_blank_partition_is_formatted() {
+  EventJournal journal;
+  TEST_ASSERT_TRUE(journal.begin("spiffs"));
+  TEST_ASSERT_TRUE(journal.isEnabled());
+  TEST_ASSERT_EQUAL_UINT32(SECTORS, journal.sectors());
+  TEST_ASSERT_EQUAL_UINT32(0, journal.headSeq());
+  TEST_ASSERT_EQUAL_UINT16(0, journal.headSlot());
+  TEST_ASSERT_EQUAL_UINT32(1, fakeFlash.erases);
+  TEST_ASSERT_EQUAL_UINT32(0, readBack(journal).count);
+
+  EventJournal missing;
+  TEST_ASSERT_FALSE(missing.begin("nvs"));
+  TEST_ASSERT_FALSE(missing.append(JRN_PRESS, 1, 0, 0));
+}
+
+void test_records_wait_for_a_page_or_max_age() {
+  EventJournal journal;
+  journal.begin("spiffs");
+  appendRecords(journal, 0, 3);
+  fakeNowUs = 1000;
+  TEST_ASSERT_EQUAL_UINT32(0, journal.flush(fakeNowUs, 5000, true)); // Starts the wait
+  fakeNowUs = 5999;
+  TEST_ASSERT_EQUAL_UINT32(0, journal.flush(fakeNowUs, 5000, true));
+  TEST_ASSERT_EQUAL_UINT32(3, journal.pending());
+  fakeNowUs = 6000;
+  TEST_ASSERT_EQUAL_UINT32(3, journal.flush(fakeNowUs, 5000, true));
+  TEST_ASSERT_EQUAL_UINT32(0, journal.pending());
+
+  // A full page goes out without waiting
+  appendRecords(journal, 3, PAGE);
+  TEST_ASSERT_EQUAL_UINT32(PAGE, journal.flush(fakeNowUs, 5000, true));
+
+  ReadBack r = readBack(journal);
+  TEST_ASSERT_EQUAL_UINT32(3 + PAGE, r.count);
+  TEST_ASSERT_TRUE(r.contiguous);
+  TEST_ASSERT_EQUAL_UINT32(3 + PAGE, journal.written());
+}
+
+void test_flush_writes_one_page_per_call() {
+  EventJournal journal;
+  journal.begin("spiffs");
+  uint32_t writesBefore = fakeFlash.writes;
+  appendRecords(journal, 0, 2 * PAGE + 5);
+
+  TEST_ASSERT_EQUAL_UINT32(PAGE, journal.flush(fakeNowUs, 1000000, true));
+  TEST_ASSERT_EQUAL_UINT32(writesBefore + 1, fakeFlash.writes);
+  TEST_ASSERT_EQUAL_UINT32(PAGE, journal.flush(fakeNowUs, 1000000, true));
+  // The rest is less than a page: it waits out the max age it started with
+  TEST_ASSERT_EQUAL_UINT32(0, journal.flush(fakeNowUs, 1000000, true));
+  fakeNowUs = 1000000;
+  TEST_ASSERT_EQUAL_UINT32(5, journal.flush(fakeNowUs, 1000000, true));
+  TEST_ASSERT_EQUAL_UINT32(0, journal.flush(fakeNowUs, 1000000, true));
+  TEST_ASSERT_EQUAL_UINT32(writesBefore + 3, fakeFlash.writes);
+  TEST_ASSERT_EQUAL_UINT32(2 * PAGE + 5, readBack(journal).count);
+}
+
+void test_reboot_finds_the_write_position() {
+  {
+    EventJournal journal;
+    journal.begin("spiffs");
+    writeRecords(journal, 0, EventJournal::SLOTS + 20); // Into the second sector
+    TEST_ASSERT_EQUAL_UINT32(1, journal.headSeq());
+    TEST_ASSERT_EQUAL_UINT16(20, journal.headSlot());
+  }
+
+  EventJournal journal;
+  TEST_ASSERT_TRUE(journal.begin("spiffs"));
+  TEST_ASSERT_EQUAL_UINT32(1, journal.headSeq());
+  TEST_ASSERT_EQUAL_UINT16(20, journal.headSlot());
+  TEST_ASSERT_EQUAL_UINT32(2, fakeFlash.erases); // Nothing reformatted
+
+  // New records continue right after the old ones
+  appendRecords(journal, EventJournal::SLOTS + 20, 10);
+  drain(journal);
+  ReadBack r = readBack(journal);
+  TEST_ASSERT_EQUAL_UINT32(EventJournal::SLOTS + 30, r.count);
+  TEST_ASSERT_EQUAL_UINT32(0, r.first);
+  TEST_ASSERT_TRUE(r.contiguous);
+}
+
+void test_wrap_around_erases_the_oldest_sector() {
+  EventJournal journal;
+  journal.begin("spiffs");
+  uint32_t total = SECTORS * EventJournal::SLOTS + 50;
+  writeRecords(journal, 0, total);
+  TEST_ASSERT_EQUAL_UINT32(SECTORS, journal.headSeq());
+  TEST_ASSERT_EQUAL_UINT16(50, journal.headSlot());
+
+  // Sector 0 was reused for seq 3: the ring holds seqs 1..3
+  ReadBack r = readBack(journal);
+  TEST_ASSERT_EQUAL_UINT32((SECTORS - 1) * EventJournal::SLOTS + 50, r.count);
+  TEST_ASSERT_EQUAL_UINT32(EventJournal::SLOTS, r.first);
+  TEST_ASSERT_EQUAL_UINT32(total - 1, r.last);
+  TEST_ASSERT_TRUE(r.contiguous);
+
+  // ...and a reboot finds the wrapped head
+  EventJournal rebooted;
+  rebooted.begin("spiffs");
+  TEST_ASSERT_EQUAL_UINT32(SECTORS, rebooted.headSeq());
+  TEST_ASSERT_EQUAL_UINT16(50, rebooted.headSlot());
+  TEST_ASSERT_EQUAL_UINT32(r.count, readBack(rebooted).count);
+}
+
+void test_bad_crc_is_skipped() {
+  EventJournal journal;
+  journal.begin("spiffs");
+  appendRecords(journal, 0, 5);
+  drain(journal);
+
+  // Clear a bit of record 2's value (slot 0 is the header), as a torn write
+  // might
+  size_t offset = 3 * sizeof(JournalRecord) + offsetof(JournalRecord, value);
+  fakeFlash.data[offset] &= 0xFD;
+
+  ReadBack r = readBack(journal);
+  TEST_ASSERT_EQUAL_UINT32(4, r.count);
+  TEST_ASSERT_EQUAL_UINT32(1, r.bad);
+  TEST_ASSERT_FALSE(r.contiguous);
+  TEST_ASSERT_EQUAL_UINT32(4, r.last);
+}
+
+void test_full_buffer_drops_rather_than_erase() {
+  EventJournal journal;
+  journal.begin("spiffs");
+  writeRecords(journal, 0, EventJournal::SLOTS); // Fill the head sector exactly
+  TEST_ASSERT_EQUAL_UINT16(EventJournal::SLOTS, journal.headSlot());
+  uint32_t erases = fakeFlash.erases;
+  uint32_t writes = fakeFlash.writes;
+
+  // Presses keep coming while erasing is not allowed
+  uint16_t capacity = journal.bufferCapacity();
+  appendRecords(journal, EventJournal::SLOTS, capacity);
+  TEST_ASSERT_FALSE(journal.append(JRN_PRESS, 1, 0, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, journal.flush(fakeNowUs, 0, false));
+  TEST_ASSERT_EQUAL_UINT32(1, journal.blocked());
+  TEST_ASSERT_EQUAL_UINT32(1, journal.dropped());
+  TEST_ASSERT_EQUAL_UINT32(erases, fakeFlash.erases);
+  TEST_ASSERT_EQUAL_UINT32(writes, fakeFlash.writes);
+
+  // Once the next sector is erased ahead of time, pages go out without an
+  // erase of their own
+  TEST_ASSERT_TRUE(journal.prepareNext());
+  TEST_ASSERT_EQUAL_UINT32(erases + 1, fakeFlash.erases);
+  TEST_ASSERT_EQUAL_UINT32(PAGE, journal.flush(fakeNowUs, 0, false));
+  while (journal.flush(fakeNowUs, 0, false) > 0) {}
+  TEST_ASSERT_EQUAL_UINT32(erases + 1, fakeFlash.erases);
+  TEST_ASSERT_EQUAL_UINT32(0, journal.pending());
+
+  ReadBack r = readBack(journal);
+  TEST_ASSERT_EQUAL_UINT32(EventJournal::SLOTS + capacity, r.count);
+  TEST_ASSERT_TRUE(r.contiguous); // The dropped record was the newest
+}
+
+void test_prepared_sector_is_opened_without_erasing() {
+  EventJournal journal;
+  journal.begin("spiffs");
+  TEST_ASSERT_TRUE(journal.prepareNext());
+  TEST_ASSERT_TRUE(journal.nextPrepared());
+  TEST_ASSERT_FALSE(journal.prepareNext()); // Already done
+  uint32_t erases = fakeFlash.erases;
+
+  writeRecords(journal, 0, EventJournal::SLOTS + 1);
+  TEST_ASSERT_EQUAL_UINT32(1, journal.headSeq());
+  TEST_ASSERT_FALSE(journal.nextPrepared());
+  TEST_ASSERT_EQUAL_UINT32(erases, fakeFlash.erases);
+  TEST_ASSERT_EQUAL_UINT32(erases, journal.erases());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_blank_partition_is_formatted);
+  RUN_TEST(test_records_wait_for_a_page_or_max_age);
+  RUN_TEST(test_flush_writes_one_page_per_call);
+  RUN_TEST(test_reboot_finds_the_write_position);
+  RUN_TEST(test_wrap_around_erases_the_oldest_sector);
+  RUN_TEST(test_bad_crc_is_skipped);
+  RUN_TEST(test_full_buffer_drops_rather_than_erase);
+  RUN_TEST(test_prepared_sector_is_opened_without_erasing);
+  return UNITY_END();
+}
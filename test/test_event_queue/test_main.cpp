@@ -0,0 +1,113 @@
+// EventQueue: FIFO order, overflow accounting, sequence wrap and a
+// multi-producer stress run with a single consumer.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unity.h>
+#include "event_queue.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fifo_order() {
+  EventQueue<uint32_t, 8> queue;
+  uint32_t out;
+  TEST_ASSERT_FALSE(queue.pop(out));
+  for (uint32_t i = 0; i < 5; i++) TEST_ASSERT_TRUE(queue.push(i));
+  TEST_ASSERT_EQUAL_UINT32(5, queue.size());
+  for (uint32_t i = 0; i < 5; i++) {
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(i, out);
+  }
+  TEST_ASSERT_FALSE(queue.pop(out));
+  TEST_ASSERT_EQUAL_UINT32(0, queue.size());
+}
+
+void test_full_queue_drops_newest() {
+  EventQueue<uint32_t, 4> queue;
+  for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_TRUE(queue.push(i));
+  TEST_ASSERT_FALSE(queue.push(99));
+  TEST_ASSERT_FALSE(queue.push(100));
+  TEST_ASSERT_EQUAL_UINT32(2, queue.dropped());
+  TEST_ASSERT_EQUAL_UINT32(4, queue.highWater());
+
+  // Queued items are untouched, and space frees up after a pop
+  uint32_t out;
+  TEST_ASSERT_TRUE(queue.pop(out));
+  TEST_ASSERT_EQUAL_UINT32(0, out);
+  TEST_ASSERT_TRUE(queue.push(5));
+  for (uint32_t expected = 1; expected <= 3; expected++) {
+    queue.pop(out);
+    TEST_ASSERT_EQUAL_UINT32(expected, out);
+  }
+  queue.pop(out);
+  TEST_ASSERT_EQUAL_UINT32(5, out);
+}
+
+void test_wraps_around_many_times() {
+  EventQueue<uint32_t, 4> queue;
+  uint32_t out;
+  for (uint32_t i = 0; i < 10000; i++) {
+    TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_TRUE(queue.push(i + 1000000));
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(i, out);
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(i + 1000000, out);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, queue.dropped());
+  TEST_ASSERT_EQUAL_UINT32(2, queue.highWater());
+}
+
+struct Item {
+  uint8_t producer;
+  uint32_t seq;
+};
+
+void test_concurrent_producers_lose_nothing() {
+  const int PRODUCERS = 4;
+  const uint32_t PER_PRODUCER = 50000;
+  EventQueue<Item, 64> queue;
+  std::atomic<bool> go(false);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < PRODUCERS; p++) {
+    producers.emplace_back([&queue, &go, p, PER_PRODUCER] {
+      while (!go.load()) {
+      }
+      for (uint32_t i = 0; i < PER_PRODUCER; i++) {
+        Item item = {(uint8_t)p, i};
+        while (!queue.push(item)) std::this_thread::yield(); // Retry when full
+      }
+    });
+  }
+
+  go.store(true);
+  uint32_t next[PRODUCERS] = {0};
+  uint32_t received = 0;
+  bool ordered = true;
+  Item item;
+  while (received < PRODUCERS * PER_PRODUCER) {
+    if (!queue.pop(item)) continue;
+    // Each producer's items arrive in its own order, none missing or repeated
+    if (item.seq != next[item.producer]) ordered = false;
+    next[item.producer] = item.seq + 1;
+    received++;
+  }
+  for (std::thread& t : producers) t.join();
+
+  TEST_ASSERT_TRUE(ordered);
+  for (int p = 0; p < PRODUCERS; p++) TEST_ASSERT_EQUAL_UINT32(PER_PRODUCER, next[p]);
+  TEST_ASSERT_FALSE(queue.pop(item));
+  TEST_ASSERT_TRUE(queue.highWater() <= 64);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fifo_order);
+  RUN_TEST(test_full_queue_drops_newest);
+  RUN_TEST(test_wraps_around_many_times);
+  RUN_TEST(test_concurrent_producers_lose_nothing);
+  return UNITY_END();
+}
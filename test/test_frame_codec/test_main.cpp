@@ -0,0 +1,170 @@
+// Binary frame codec: CRC-16/CCITT-FALSE, COBS vectors and long runs,
+// frame round trip, corruption detection and resync on the delimiter.
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "frame_codec.h"
+
+std::vector<uint8_t> cobs(const std::vector<uint8_t>& in) {
+  std::vector<uint8_t> out(in.size() + in.size() / 254 + 2);
+  out.resize(cobsEncode(in.data(), in.size(), out.data()));
+  return out;
+}
+
+std::vector<uint8_t> uncobs(const std::vector<uint8_t>& in) {
+  std::vector<uint8_t> out(in.size());
+  out.resize(cobsDecode(in.data(), in.size(), out.data()));
+  return out;
+}
+
+std::vector<uint8_t> frame(uint8_t type, uint16_t seq, uint64_t timeUs, const char* payload) {
+  size_t len = strlen(payload);
+  std::vector<uint8_t> scratch(FRAME_HEADER_SIZE + len + FRAME_CRC_SIZE);
+  std::vector<uint8_t> out(frameEncodedSize(len));
+  out.resize(encodeFrame(type, seq, timeUs, (const uint8_t*)payload, len,
+                         scratch.data(), out.data()));
+  return out;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_crc16_check_value() {
+  const char* check = "123456789";
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16Ccitt((const uint8_t*)check, 9));
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, crc16Ccitt(nullptr, 0));
+  // Incremental use gives the same result
+  uint16_t crc = crc16Ccitt((const uint8_t*)check, 4);
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16Ccitt((const uint8_t*)check + 4, 5, crc));
+}
+
+void test_cobs_reference_vectors() {
+  const std::vector<uint8_t> cases[][2] = {
+      {{0x00}, {0x01, 0x01}},
+      {{0x00, 0x00}, {0x01, 0x01, 0x01}},
+      {{0x11, 0x22, 0x00, 0x33}, {0x03, 0x11, 0x22, 0x02, 0x33}},
+      {{0x11, 0x22, 0x33, 0x44}, {0x05, 0x11, 0x22, 0x33, 0x44}},
+      {{0x11, 0x00, 0x00, 0x00}, {0x02, 0x11, 0x01, 0x01, 0x01}},
+  };
+  for (const auto& c : cases) {
+    std::vector<uint8_t> encoded = cobs(c[0]);
+    TEST_ASSERT_TRUE(encoded == c[1]);
+    TEST_ASSERT_TRUE(uncobs(encoded) == c[0]);
+  }
+}
+
+void test_cobs_long_runs_round_trip() {
+  for (size_t len : {253, 254, 255, 508, 600}) {
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++) data[i] = (uint8_t)(i % 255 + 1); // No zeros
+    data[len / 3] = 0;
+    std::vector<uint8_t> encoded = cobs(data);
+    TEST_ASSERT_TRUE(encoded.size() <= len + len / 254 + 2);
+    TEST_ASSERT_TRUE(memchr(encoded.data(), 0, encoded.size()) == nullptr);
+    TEST_ASSERT_TRUE(uncobs(encoded) == data);
+  }
+}
+
+void test_cobs_rejects_malformed_input() {
+  const uint8_t overrun[] = {0x05, 0x11, 0x22}; // Code claims 4 bytes, has 2
+  const uint8_t zero[] = {0x02, 0x11, 0x00, 0x22};
+  uint8_t out[8];
+  TEST_ASSERT_EQUAL(0, (int)cobsDecode(overrun, sizeof(overrun), out));
+  TEST_ASSERT_EQUAL(0, (int)cobsDecode(zero, sizeof(zero), out));
+}
+
+void test_frame_round_trip() {
+  std::vector<uint8_t> encoded = frame(FRAME_EVENT, 0x0102, 0x0000AABBCCDD0011ULL, "BUZZ 3");
+
+  // Exactly one delimiter, at the end
+  TEST_ASSERT_EQUAL_UINT8(0, encoded.back());
+  TEST_ASSERT_TRUE(memchr(encoded.data(), 0, encoded.size() - 1) == nullptr);
+  TEST_ASSERT_TRUE(encoded.size() <= frameEncodedSize(6));
+
+  uint8_t raw[64];
+  size_t payloadLen = 0;
+  TEST_ASSERT_TRUE(decodeFrame(encoded.data(), encoded.size() - 1, raw, payloadLen));
+  TEST_ASSERT_EQUAL(6, (int)payloadLen);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_EVENT, raw[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x02, raw[1]); // Little-endian seq
+  TEST_ASSERT_EQUAL_HEX8(0x01, raw[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x11, raw[3]); // Little-endian time_us
+  TEST_ASSERT_EQUAL_HEX8(0xAA, raw[8]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, raw[10]);
+  TEST_ASSERT_TRUE(memcmp(raw + FRAME_HEADER_SIZE, "BUZZ 3", 6) == 0);
+}
+
+void test_empty_payload_frame() {
+  std::vector<uint8_t> encoded = frame(FRAME_RESPONSE, 0, 0, "");
+  uint8_t raw[32];
+  size_t payloadLen = 99;
+  TEST_ASSERT_TRUE(decodeFrame(encoded.data(), encoded.size() - 1, raw, payloadLen));
+  TEST_ASSERT_EQUAL(0, (int)payloadLen);
+}
+
+void test_corruption_detected() {
+  std::vector<uint8_t> good = frame(FRAME_COMMAND, 7, 123456, "CORRECT");
+  uint8_t raw[64];
+  size_t payloadLen;
+
+  // Every single-bit flip in the body is caught by COBS or the CRC
+  for (size_t i = 0; i < good.size() - 1; i++) {
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      std::vector<uint8_t> bad = good;
+      bad[i] ^= (uint8_t)(1 << bit);
+      if (bad[i] == 0) continue; // Would split the frame at the delimiter
+      TEST_ASSERT_FALSE(decodeFrame(bad.data(), bad.size() - 1, raw, payloadLen));
+    }
+  }
+
+  // Truncated frames fail too
+  TEST_ASSERT_FALSE(decodeFrame(good.data(), good.size() - 3, raw, payloadLen));
+  TEST_ASSERT_FALSE(decodeFrame(good.data(), 4, raw, payloadLen));
+}
+
+void test_receiver_resyncs_on_delimiter() {
+  std::vector<uint8_t> stream = {0x42, 0x13, 0x37}; // Tail of a lost frame
+  stream.push_back(0);
+  for (const char* payload : {"BUZZ 1", "WRONG", "BUZZ 2"}) {
+    std::vector<uint8_t> f = frame(FRAME_EVENT, 0, 0, payload);
+    stream.insert(stream.end(), f.begin(), f.end());
+  }
+
+  std::vector<std::string> decoded;
+  std::vector<uint8_t> block;
+  int rejected = 0;
+  for (uint8_t byte : stream) {
+    if (byte != 0) {
+      block.push_back(byte);
+      continue;
+    }
+    uint8_t raw[64];
+    size_t payloadLen;
+    if (decodeFrame(block.data(), block.size(), raw, payloadLen)) {
+      decoded.push_back(std::string((const char*)raw + FRAME_HEADER_SIZE, payloadLen));
+    } else {
+      rejected++;
+    }
+    block.clear();
+  }
+
+  TEST_ASSERT_EQUAL(1, rejected);
+  TEST_ASSERT_EQUAL(3, (int)decoded.size());
+  TEST_ASSERT_EQUAL_STRING("BUZZ 1", decoded[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("BUZZ 2", decoded[2].c_str());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc16_check_value);
+  RUN_TEST(test_cobs_reference_vectors);
+  RUN_TEST(test_cobs_long_runs_round_trip);
+  RUN_TEST(test_cobs_rejects_malformed_input);
+  RUN_TEST(test_frame_round_trip);
+  RUN_TEST(test_empty_payload_frame);
+  RUN_TEST(test_corruption_detected);
+  RUN_TEST(test_receiver_resyncs_on_delimiter);
+  return UNITY_END();
+}
@@ -0,0 +1,433 @@
+// GameCore<N> on the host: state machine, press arbitration, snapshot
+// restore and the LED frame / state sync encoding, against fake
+// clock, transport and output.
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "game_core.h"
+
+// ============================================================================
+// FAKES
+// ============================================================================
+
+class FakeClock : public GameClock {
+public:
+  FakeClock() : now(0) {}
+  int64_t nowUs() override { return now; }
+  int64_t now;
+};
+
+class FakeTransport : public GameTransport {
+public:
+  void publishLedState(const LedStateMessage& frame) override { frames.push_back(frame); }
+  void sendStateSync(uint8_t nodeId, const StateSyncMessage& msg) override {
+    syncTargets.push_back(nodeId);
+    syncs.push_back(msg);
+  }
+
+  std::vector<LedStateMessage> frames;
+  std::vector<uint8_t> syncTargets;
+  std::vector<StateSyncMessage> syncs;
+};
+
+class FakeOutput : public GameOutput {
+public:
+  FakeOutput() : winner(0), pressTimeUs(0), marginUs(0) {}
+  void report(const char* line) override { reports.push_back(line); }
+  void debug(const char*) override { debugLines++; }
+  void buzzed(uint8_t nodeId, uint64_t time, int64_t margin) override {
+    winner = nodeId;
+    pressTimeUs = time;
+    marginUs = margin;
+  }
+
+  std::vector<std::string> reports;
+  int debugLines = 0;
+  uint8_t winner;
+  uint64_t pressTimeUs;
+  int64_t marginUs;
+};
+
+const uint32_t WINDOW_US = 10000;
+
+template <uint8_t N> struct Fixture {
+  explicit Fixture(uint32_t windowUs = WINDOW_US)
+      : game(clock, transport, output, windowUs) {}
+
+  FakeClock clock;
+  FakeTransport transport;
+  FakeOutput output;
+  GameCore<N> game;
+};
+
+// Buzzer `node` wins an uncontested round
+template <uint8_t N> void lockIn(Fixture<N>& f, uint8_t node) {
+  f.game.press(node, f.clock.now, f.clock.now);
+  f.clock.now += WINDOW_US;
+  f.game.poll();
+}
+
+const std::string& lastReport(const FakeOutput& output) {
+  return output.reports.back();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// PRESSES AND ARBITRATION
+// ============================================================================
+
+void test_first_arrival_wins_without_arbitration() {
+  Fixture<4> f(0);
+  f.game.press(3, 100, 100);
+  f.game.press(1, 50, 120); // Earlier press, but arbitration is off
+
+  TEST_ASSERT_EQUAL(STATE_LOCKED, f.game.state());
+  TEST_ASSERT_EQUAL_UINT8(3, f.game.selected());
+  TEST_ASSERT_EQUAL_STRING("BUZZ 3", lastReport(f.output).c_str());
+  TEST_ASSERT_EQUAL_INT64(-1, f.output.marginUs);
+  TEST_ASSERT_EQUAL(1, (int)f.transport.frames.size());
+}
+
+void test_round_resolves_only_after_window() {
+  Fixture<4> f;
+  f.clock.now = 1000;
+  f.game.press(2, 900, 1000);
+  TEST_ASSERT_TRUE(f.game.arbiter().isOpen());
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+
+  f.clock.now = 1000 + WINDOW_US - 1;
+  f.game.poll();
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+  TEST_ASSERT_TRUE(f.transport.frames.empty());
+
+  f.clock.now = 1000 + WINDOW_US;
+  f.game.poll();
+  TEST_ASSERT_EQUAL(STATE_LOCKED, f.game.state());
+  TEST_ASSERT_EQUAL_UINT8(2, f.game.selected());
+  TEST_ASSERT_EQUAL_STRING("BUZZ 2", lastReport(f.output).c_str());
+  TEST_ASSERT_FALSE(f.game.arbiter().isOpen());
+}
+
+void test_reordered_frames_earliest_press_wins() {
+  Fixture<4> f;
+  // Node 4's frame arrives first, node 1 pressed 300µs earlier
+  f.clock.now = 2000;
+  f.game.press(4, 1500, 2000);
+  f.game.press(1, 1200, 2600);
+  f.game.press(3, 1900, 2700);
+  f.clock.now = 2000 + WINDOW_US;
+  f.game.poll();
+
+  TEST_ASSERT_EQUAL_UINT8(1, f.game.selected());
+  TEST_ASSERT_EQUAL_UINT64(1200, f.game.lastPressTimeUs());
+  TEST_ASSERT_EQUAL_STRING("BUZZ 1 MARGIN_US:300", lastReport(f.output).c_str());
+  TEST_ASSERT_EQUAL_UINT8(1, f.output.winner);
+  TEST_ASSERT_EQUAL_INT64(300, f.output.marginUs);
+  TEST_ASSERT_EQUAL_UINT32(1, f.game.arbiter().rounds());
+  TEST_ASSERT_EQUAL_UINT32(1, f.game.arbiter().contested());
+  TEST_ASSERT_EQUAL_UINT32(1, f.game.arbiter().reordered());
+}
+
+void test_repeated_press_keeps_earliest_time() {
+  Fixture<4> f;
+  f.game.press(2, 500, 1000);
+  f.game.press(3, 400, 1100);
+  f.game.press(2, 300, 1200); // Resent press with an earlier edge
+  f.clock.now = 1000 + WINDOW_US;
+  f.game.poll();
+
+  TEST_ASSERT_EQUAL_UINT8(2, f.game.selected());
+  TEST_ASSERT_EQUAL_INT64(100, f.output.marginUs);
+}
+
+void test_every_node_is_a_candidate() {
+  Fixture<64> f;
+  // 64 presses in one window; the earliest press arrives last
+  for (uint8_t i = 1; i <= 64; i++) {
+    f.game.press(i, 10000 - i, 1000 + i);
+  }
+  f.clock.now = 1001 + WINDOW_US;
+  f.game.poll();
+
+  TEST_ASSERT_EQUAL_UINT8(64, f.game.selected());
+  TEST_ASSERT_EQUAL_INT64(1, f.output.marginUs);
+  TEST_ASSERT_EQUAL_UINT32(1, f.game.arbiter().reordered());
+}
+
+void test_out_of_range_presses_ignored() {
+  Fixture<4> f(0);
+  f.game.press(0, 10, 10);
+  f.game.press(5, 10, 10);
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+  TEST_ASSERT_TRUE(f.output.reports.empty());
+}
+
+void test_locked_state_ignores_presses() {
+  Fixture<4> f;
+  lockIn(f, 1);
+  size_t frames = f.transport.frames.size();
+
+  f.game.press(2, f.clock.now, f.clock.now);
+  f.clock.now += WINDOW_US;
+  f.game.poll();
+  TEST_ASSERT_EQUAL_UINT8(1, f.game.selected());
+  TEST_ASSERT_FALSE(f.game.arbiter().isOpen());
+  TEST_ASSERT_EQUAL(frames, f.transport.frames.size());
+}
+
+// ============================================================================
+// CORRECT / WRONG / RESET
+// ============================================================================
+
+void test_correct_returns_to_ready() {
+  Fixture<4> f;
+  lockIn(f, 2);
+  f.game.wrong();
+  lockIn(f, 3);
+  f.game.correct();
+
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+  TEST_ASSERT_EQUAL_UINT8(0, f.game.selected());
+  TEST_ASSERT_TRUE(f.game.locked().none());
+  TEST_ASSERT_EQUAL_STRING("CORRECT", lastReport(f.output).c_str());
+}
+
+void test_commands_without_selection_ignored() {
+  Fixture<4> f;
+  f.game.correct();
+  f.game.wrong();
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+  TEST_ASSERT_TRUE(f.output.reports.empty());
+  TEST_ASSERT_TRUE(f.transport.frames.empty());
+}
+
+void test_wrong_locks_out_buzzer() {
+  Fixture<4> f;
+  lockIn(f, 2);
+  f.game.wrong();
+
+  TEST_ASSERT_EQUAL(STATE_PARTIAL_LOCKOUT, f.game.state());
+  TEST_ASSERT_EQUAL_UINT8(0, f.game.selected());
+  TEST_ASSERT_TRUE(f.game.locked().test(2));
+  TEST_ASSERT_EQUAL_STRING("WRONG", lastReport(f.output).c_str());
+
+  // The locked buzzer cannot open a round; the others can
+  f.game.press(2, f.clock.now, f.clock.now);
+  TEST_ASSERT_FALSE(f.game.arbiter().isOpen());
+  lockIn(f, 4);
+  TEST_ASSERT_EQUAL(STATE_LOCKED, f.game.state());
+  TEST_ASSERT_EQUAL_UINT8(4, f.game.selected());
+  TEST_ASSERT_TRUE(f.game.locked().test(2));
+}
+
+void test_wrong_with_everyone_locked_resets_to_ready() {
+  Fixture<3> f;
+  lockIn(f, 1);
+  f.game.wrong();
+  lockIn(f, 2);
+  f.game.wrong();
+  lockIn(f, 3);
+  f.game.wrong();
+
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+  TEST_ASSERT_EQUAL_UINT8(0, f.game.selected());
+  TEST_ASSERT_TRUE(f.game.locked().none());
+  TEST_ASSERT_EQUAL_STRING("WRONG", lastReport(f.output).c_str());
+  for (uint8_t i = 1; i <= 3; i++) {
+    TEST_ASSERT_EQUAL(LED_ON, f.game.ledStateFor(i));
+  }
+}
+
+void test_reset_cancels_open_round() {
+  Fixture<4> f;
+  lockIn(f, 1);
+  f.game.wrong();
+  f.game.press(3, f.clock.now, f.clock.now);
+  TEST_ASSERT_TRUE(f.game.arbiter().isOpen());
+
+  f.game.reset();
+  TEST_ASSERT_FALSE(f.game.arbiter().isOpen());
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+  TEST_ASSERT_TRUE(f.game.locked().none());
+  TEST_ASSERT_EQUAL_STRING("RESET", lastReport(f.output).c_str());
+
+  // The cancelled round never locks anyone in
+  f.clock.now += WINDOW_US;
+  f.game.poll();
+  TEST_ASSERT_EQUAL(STATE_READY, f.game.state());
+}
+
+// ============================================================================
+// SNAPSHOT RESTORE
+// ============================================================================
+
+GameSnapshot makeSnapshot(uint8_t state, uint8_t selected, uint64_t locked) {
+  GameSnapshot snapshot;
+  snapshot.state = state;
+  snapshot.selected = selected;
+  snapshot.ledSeq = 77;
+  snapshot.locked = locked;
+  return snapshot;
+}
+
+void test_restore_accepts_valid_snapshots() {
+  Fixture<4> f;
+  TEST_ASSERT_TRUE(f.game.restore(makeSnapshot(STATE_LOCKED, 3, 0x2)));
+  TEST_ASSERT_EQUAL(STATE_LOCKED, f.game.state());
+  TEST_ASSERT_EQUAL_UINT8(3, f.game.selected());
+  TEST_ASSERT_EQUAL_HEX64(0x2, f.game.locked().toMask());
+  TEST_ASSERT_EQUAL_UINT16(77, f.game.ledSeq());
+
+  // Publishing continues the saved sequence
+  f.game.publishLeds();
+  TEST_ASSERT_EQUAL_UINT16(78, f.transport.frames.back().seq);
+
+  Fixture<4> g;
+  TEST_ASSERT_TRUE(g.game.restore(makeSnapshot(STATE_PARTIAL_LOCKOUT, 0, 0x5)));
+  TEST_ASSERT_EQUAL(STATE_PARTIAL_LOCKOUT, g.game.state());
+  TEST_ASSERT_TRUE(g.game.restore(makeSnapshot(STATE_READY, 0, 0)));
+  TEST_ASSERT_EQUAL(STATE_READY, g.game.state());
+
+  // The snapshot round-trips
+  GameSnapshot saved = f.game.snapshot();
+  TEST_ASSERT_EQUAL_UINT8(STATE_LOCKED, saved.state);
+  TEST_ASSERT_EQUAL_UINT8(3, saved.selected);
+  TEST_ASSERT_EQUAL_HEX64(0x2, saved.locked);
+}
+
+void test_restore_rejects_bad_snapshots() {
+  const GameSnapshot bad[] = {
+      makeSnapshot(STATE_READY, 1, 0),             // READY with a selection
+      makeSnapshot(STATE_READY, 0, 0x1),           // READY with lockouts
+      makeSnapshot(STATE_LOCKED, 0, 0),            // LOCKED without a selection
+      makeSnapshot(STATE_LOCKED, 5, 0),            // Selection beyond N
+      makeSnapshot(STATE_LOCKED, 2, 0x2),          // Selected buzzer is locked out
+      makeSnapshot(STATE_PARTIAL_LOCKOUT, 0, 0),   // PARTIAL_LOCKOUT, nobody locked
+      makeSnapshot(STATE_PARTIAL_LOCKOUT, 2, 0x1), // PARTIAL_LOCKOUT with a selection
+      makeSnapshot(STATE_PARTIAL_LOCKOUT, 0, 0xF), // Everyone locked out
+      makeSnapshot(STATE_PARTIAL_LOCKOUT, 0, 0x10), // Lockout beyond N
+      makeSnapshot(3, 0, 0),                       // Unknown state
+  };
+
+  for (const GameSnapshot& snapshot : bad) {
+    Fixture<4> f;
+    lockIn(f, 2);
+    TEST_ASSERT_FALSE(f.game.restore(snapshot));
+    // Nothing changed
+    TEST_ASSERT_EQUAL(STATE_LOCKED, f.game.state());
+    TEST_ASSERT_EQUAL_UINT8(2, f.game.selected());
+  }
+}
+
+// ============================================================================
+// ENCODING
+// ============================================================================
+
+void test_led_states_follow_game_state() {
+  Fixture<4> f;
+  for (uint8_t i = 1; i <= 4; i++) TEST_ASSERT_EQUAL(LED_ON, f.game.ledStateFor(i));
+
+  lockIn(f, 2);
+  TEST_ASSERT_EQUAL(LED_OFF, f.game.ledStateFor(1));
+  TEST_ASSERT_EQUAL(LED_BLINK, f.game.ledStateFor(2));
+  TEST_ASSERT_EQUAL(LED_OFF, f.game.ledStateFor(3));
+
+  f.game.wrong();
+  TEST_ASSERT_EQUAL(LED_ON, f.game.ledStateFor(1));
+  TEST_ASSERT_EQUAL(LED_OFF, f.game.ledStateFor(2));
+  TEST_ASSERT_EQUAL(LED_ON, f.game.ledStateFor(4));
+}
+
+void test_published_frame_encodes_every_node() {
+  Fixture<4> f;
+  f.game.setEpoch(0xCAFEF00D);
+  lockIn(f, 1);
+  f.game.wrong();
+  lockIn(f, 3);
+
+  const LedStateMessage& frame = f.transport.frames.back();
+  TEST_ASSERT_EQUAL_UINT8(0, frame.node_id);
+  TEST_ASSERT_EQUAL_UINT8(MSG_LED_STATE, frame.msg_type);
+  TEST_ASSERT_EQUAL_UINT8(4, frame.node_count);
+  TEST_ASSERT_EQUAL_UINT32(0xCAFEF00D, frame.epoch);
+  TEST_ASSERT_EQUAL_UINT16(3, frame.seq); // BUZZ, WRONG, BUZZ
+  TEST_ASSERT_EQUAL(LED_OFF, getNodeLED(frame, 1));
+  TEST_ASSERT_EQUAL(LED_OFF, getNodeLED(frame, 2));
+  TEST_ASSERT_EQUAL(LED_BLINK, getNodeLED(frame, 3));
+  TEST_ASSERT_EQUAL(LED_OFF, getNodeLED(frame, 4));
+  // Node 1 = bits 0-1 of leds[0], node 3 = bits 4-5
+  TEST_ASSERT_EQUAL_HEX8(LED_BLINK << 4, frame.leds[0]);
+}
+
+void test_set_node_led_slots_are_independent() {
+  LedStateMessage frame;
+  memset(&frame, 0, sizeof(frame));
+  for (uint8_t i = 1; i <= MAX_NODES; i++) {
+    setNodeLED(frame, i, (LEDState)(i % 4));
+  }
+  for (uint8_t i = 1; i <= MAX_NODES; i++) {
+    TEST_ASSERT_EQUAL(i % 4, getNodeLED(frame, i));
+  }
+
+  // Overwriting one slot leaves its neighbours alone
+  setNodeLED(frame, 6, LED_OFF);
+  TEST_ASSERT_EQUAL(LED_OFF, getNodeLED(frame, 6));
+  TEST_ASSERT_EQUAL(5 % 4, getNodeLED(frame, 5));
+  TEST_ASSERT_EQUAL(7 % 4, getNodeLED(frame, 7));
+}
+
+void test_state_sync_encoding() {
+  Fixture<64> f;
+  f.game.setEpoch(42);
+  lockIn(f, 64);
+  f.game.wrong();
+  lockIn(f, 33);
+  f.game.wrong();
+
+  StateSyncMessage msg = f.game.stateSync(64);
+  TEST_ASSERT_EQUAL_UINT8(64, msg.node_id);
+  TEST_ASSERT_EQUAL_UINT8(MSG_STATE_SYNC, msg.msg_type);
+  TEST_ASSERT_EQUAL_UINT8(0, msg.selected);
+  TEST_ASSERT_EQUAL_UINT8(1, msg.partial_lockout);
+  TEST_ASSERT_EQUAL_UINT8(64, msg.node_count);
+  TEST_ASSERT_EQUAL_UINT16(f.game.ledSeq(), msg.led_seq);
+  TEST_ASSERT_EQUAL_UINT32(42, msg.epoch);
+  TEST_ASSERT_EQUAL_HEX64((1ULL << 63) | (1ULL << 32), msg.locked);
+
+  lockIn(f, 7);
+  f.game.syncNode(7);
+  TEST_ASSERT_EQUAL_UINT8(7, f.transport.syncTargets.back());
+  TEST_ASSERT_EQUAL_UINT8(7, f.transport.syncs.back().selected);
+  TEST_ASSERT_EQUAL_UINT8(0, f.transport.syncs.back().partial_lockout);
+
+  // Out-of-range nodes get nothing
+  f.game.syncNode(65);
+  TEST_ASSERT_EQUAL(1, (int)f.transport.syncs.size());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_arrival_wins_without_arbitration);
+  RUN_TEST(test_round_resolves_only_after_window);
+  RUN_TEST(test_reordered_frames_earliest_press_wins);
+  RUN_TEST(test_repeated_press_keeps_earliest_time);
+  RUN_TEST(test_every_node_is_a_candidate);
+  RUN_TEST(test_out_of_range_presses_ignored);
+  RUN_TEST(test_locked_state_ignores_presses);
+  RUN_TEST(test_correct_returns_to_ready);
+  RUN_TEST(test_commands_without_selection_ignored);
+  RUN_TEST(test_wrong_locks_out_buzzer);
+  RUN_TEST(test_wrong_with_everyone_locked_resets_to_ready);
+  RUN_TEST(test_reset_cancels_open_round);
+  RUN_TEST(test_restore_accepts_valid_snapshots);
+  RUN_TEST(test_restore_rejects_bad_snapshots);
+  RUN_TEST(test_led_states_follow_game_state);
+  RUN_TEST(test_published_frame_encodes_every_node);
+  RUN_TEST(test_set_node_led_slots_are_independent);
+  RUN_TEST(test_state_sync_encoding);
+  return UNITY_END();
+}
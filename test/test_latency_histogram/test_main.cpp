@@ -0,0 +1,117 @@
+// LatencyHistogram: exact low buckets, the 12.5% relative error bound
+// against exact percentiles, clamping, reset and concurrent recording.
+
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <unity.h>
+#include "latency_histogram.h"
+
+// |estimate - exact| <= exact / 8 (one sub-bucket), or exact below 16µs
+void assertWithinBucket(uint32_t exact, uint32_t estimate) {
+  uint32_t err = estimate > exact ? estimate - exact : exact - estimate;
+  TEST_ASSERT_TRUE(err <= exact / 8 + (exact < LatencyHistogram::LINEAR ? 0 : 1));
+}
+
+uint32_t exactPercentile(std::vector<uint32_t> values, uint8_t pct) {
+  std::sort(values.begin(), values.end());
+  size_t rank = (values.size() * pct + 99) / 100;
+  return values[rank - 1];
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_summary() {
+  LatencyHistogram histogram;
+  LatencyHistogram::Summary s = histogram.summarize();
+  TEST_ASSERT_EQUAL_UINT32(0, s.count);
+  TEST_ASSERT_EQUAL_UINT32(0, s.p50);
+  TEST_ASSERT_EQUAL_UINT32(0, s.max);
+}
+
+void test_small_values_are_exact() {
+  LatencyHistogram histogram;
+  for (int v = 0; v < 10; v++) histogram.record(v);
+  LatencyHistogram::Summary s = histogram.summarize();
+  TEST_ASSERT_EQUAL_UINT32(10, s.count);
+  TEST_ASSERT_EQUAL_UINT32(4, s.p50);
+  TEST_ASSERT_EQUAL_UINT32(8, s.p90);
+  TEST_ASSERT_EQUAL_UINT32(9, s.p99);
+  TEST_ASSERT_EQUAL_UINT32(9, s.max);
+}
+
+void test_percentiles_within_bucket_error() {
+  srand(7);
+  // Log-uniform latencies from 1µs to ~10 s
+  for (int run = 0; run < 20; run++) {
+    LatencyHistogram histogram;
+    std::vector<uint32_t> values;
+    for (int i = 0; i < 2000; i++) {
+      uint32_t v = (uint32_t)(1u << (rand() % 24)) + (uint32_t)(rand() % 1000);
+      values.push_back(v);
+      histogram.record(v);
+    }
+    LatencyHistogram::Summary s = histogram.summarize();
+    TEST_ASSERT_EQUAL_UINT32(2000, s.count);
+    TEST_ASSERT_EQUAL_UINT32(*std::max_element(values.begin(), values.end()), s.max);
+    assertWithinBucket(exactPercentile(values, 50), s.p50);
+    assertWithinBucket(exactPercentile(values, 90), s.p90);
+    assertWithinBucket(exactPercentile(values, 99), s.p99);
+    TEST_ASSERT_TRUE(s.p50 <= s.p90 && s.p90 <= s.p99 && s.p99 <= s.max);
+  }
+}
+
+void test_percentile_never_above_max() {
+  LatencyHistogram histogram;
+  histogram.record(1024); // Bucket 1024-1151, midpoint 1088
+  LatencyHistogram::Summary s = histogram.summarize();
+  TEST_ASSERT_EQUAL_UINT32(1024, s.p50);
+  TEST_ASSERT_EQUAL_UINT32(1024, s.p99);
+}
+
+void test_out_of_range_values_clamped() {
+  LatencyHistogram histogram;
+  histogram.record(-500); // Clock skew can make a delta negative
+  histogram.record(10000000000LL);
+  LatencyHistogram::Summary s = histogram.summarize();
+  TEST_ASSERT_EQUAL_UINT32(2, s.count);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, s.max);
+  TEST_ASSERT_EQUAL_UINT32(0, s.p50);
+}
+
+void test_reset_clears_everything() {
+  LatencyHistogram histogram;
+  histogram.record(123);
+  histogram.reset();
+  LatencyHistogram::Summary s = histogram.summarize();
+  TEST_ASSERT_EQUAL_UINT32(0, s.count);
+  TEST_ASSERT_EQUAL_UINT32(0, s.max);
+}
+
+void test_concurrent_recording_loses_no_counts() {
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&histogram, t] {
+      for (int i = 0; i < 100000; i++) histogram.record(t * 1000 + i % 500);
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  LatencyHistogram::Summary s = histogram.summarize();
+  TEST_ASSERT_EQUAL_UINT32(400000, s.count);
+  TEST_ASSERT_EQUAL_UINT32(3499, s.max);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_summary);
+  RUN_TEST(test_small_values_are_exact);
+  RUN_TEST(test_percentiles_within_bucket_error);
+  RUN_TEST(test_percentile_never_above_max);
+  RUN_TEST(test_out_of_range_values_clamped);
+  RUN_TEST(test_reset_clears_everything);
+  RUN_TEST(test_concurrent_recording_loses_no_counts);
+  return UNITY_END();
+}
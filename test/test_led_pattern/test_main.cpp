@@ -0,0 +1,161 @@
+// LedPatternPlayer: segment timing, fades split into gamma-corrected pieces,
+// repeats and hand-over to the next pattern, and the gamma table itself.
+
+#include <math.h>
+#include <unity.h>
+#include "led_pattern.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Take the step due at nowMs, checking it was due and not earlier
+LedPatternPlayer::Step stepAt(LedPatternPlayer& player, uint32_t nowMs) {
+  if (nowMs > 0) TEST_ASSERT_FALSE(player.isDue(nowMs - 1));
+  TEST_ASSERT_TRUE(player.isDue(nowMs));
+  TEST_ASSERT_EQUAL_UINT32(0, player.msUntilDue(nowMs));
+  return player.step(nowMs);
+}
+
+void test_gamma_table() {
+  TEST_ASSERT_EQUAL_UINT16(0, LED_GAMMA[0]);
+  TEST_ASSERT_EQUAL_UINT16(1023, LED_GAMMA[255]);
+  for (int level = 0; level < 256; level++) {
+    uint16_t expected = (uint16_t)lround(1023.0 * pow(level / 255.0, 2.2));
+    TEST_ASSERT_EQUAL_UINT16(expected, LED_GAMMA[level]);
+    if (level > 0) TEST_ASSERT_TRUE(LED_GAMMA[level] >= LED_GAMMA[level - 1]);
+  }
+}
+
+void test_jumps_hold_and_repeat() {
+  const LedSegment blink[] = {{255, 0, 500}, {0, 0, 500}};
+  const LedPattern pattern = {blink, 2, 2, nullptr};
+  LedPatternPlayer player;
+  player.start(&pattern, 1000);
+
+  for (uint32_t pass = 0; pass < 2; pass++) {
+    uint32_t t = 1000 + pass * 1000;
+    LedPatternPlayer::Step on = stepAt(player, t);
+    TEST_ASSERT_EQUAL_UINT16(1023, on.duty);
+    TEST_ASSERT_EQUAL_UINT16(0, on.fadeMs);
+    TEST_ASSERT_EQUAL_UINT32(500, player.msUntilDue(t));
+    LedPatternPlayer::Step off = stepAt(player, t + 500);
+    TEST_ASSERT_EQUAL_UINT16(0, off.duty);
+  }
+
+  // Two passes done, no next pattern: the last level holds
+  TEST_ASSERT_FALSE(player.isDue(4000));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, player.msUntilDue(4000));
+  TEST_ASSERT_EQUAL_UINT8(0, player.level());
+}
+
+void test_fade_is_split_into_pieces() {
+  const LedSegment up[] = {{255, 1000, 0}};
+  const LedPattern pattern = {up, 1, 1, nullptr};
+  LedPatternPlayer player;
+  player.start(&pattern, 0);
+
+  uint16_t lastDuty = 0;
+  for (uint32_t piece = 1; piece <= 10; piece++) {
+    LedPatternPlayer::Step step = stepAt(player, (piece - 1) * 100);
+    TEST_ASSERT_EQUAL_UINT16(100, step.fadeMs);
+    TEST_ASSERT_EQUAL_UINT16(LED_GAMMA[255 * piece / 10], step.duty);
+    TEST_ASSERT_TRUE(step.duty > lastDuty);
+    lastDuty = step.duty;
+  }
+  TEST_ASSERT_EQUAL_UINT16(1023, lastDuty);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, player.msUntilDue(1000));
+}
+
+void test_uneven_fade_ends_on_time() {
+  // 250 ms in pieces of at most 100 ms: 83 + 83 + 84, then the hold
+  const LedSegment seg[] = {{200, 250, 40}, {0, 0, 0}};
+  const LedPattern pattern = {seg, 2, 1, nullptr};
+  LedPatternPlayer player;
+  player.start(&pattern, 0);
+
+  TEST_ASSERT_EQUAL_UINT16(83, stepAt(player, 0).fadeMs);
+  TEST_ASSERT_EQUAL_UINT16(83, stepAt(player, 83).fadeMs);
+  LedPatternPlayer::Step last = stepAt(player, 166);
+  TEST_ASSERT_EQUAL_UINT16(LED_GAMMA[200], last.duty);
+  TEST_ASSERT_EQUAL_UINT32(84 + 40, player.msUntilDue(166));
+  TEST_ASSERT_EQUAL_UINT16(0, stepAt(player, 290).duty);
+}
+
+void test_hands_over_to_the_next_pattern() {
+  const LedSegment slow[] = {{255, 0, 500}, {0, 0, 500}};
+  const LedSegment fast[] = {{255, 0, 100}, {0, 0, 100}};
+  const LedPattern slowPattern = {slow, 2, 0, nullptr};
+  const LedPattern fastPattern = {fast, 2, 3, &slowPattern};
+  LedPatternPlayer player;
+  player.start(&fastPattern, 0);
+
+  uint32_t t = 0;
+  for (int i = 0; i < 6; i++) {
+    TEST_ASSERT_EQUAL_PTR(&fastPattern, player.pattern());
+    stepAt(player, t);
+    t += 100;
+  }
+  TEST_ASSERT_EQUAL_PTR(&slowPattern, player.pattern());
+
+  // Repeats forever
+  for (int i = 0; i < 100; i++) {
+    stepAt(player, t);
+    t += 500;
+  }
+  TEST_ASSERT_EQUAL_PTR(&slowPattern, player.pattern());
+  TEST_ASSERT_TRUE(player.msUntilDue(t) == 0);
+}
+
+void test_longer_pieces_mean_fewer_steps() {
+  const LedSegment breathe[] = {{255, 1000, 0}, {0, 1000, 0}};
+  const LedPattern pattern = {breathe, 2, 0, nullptr};
+  LedPatternPlayer player;
+  player.setMaxPieceMs(250);
+  player.start(&pattern, 0);
+
+  // One breathing cycle
+  for (uint32_t t = 0; t < 2000; t += 250) {
+    TEST_ASSERT_EQUAL_UINT16(250, stepAt(player, t).fadeMs);
+  }
+  TEST_ASSERT_EQUAL_UINT8(0, player.level());
+
+  // Back to the default from the next segment on
+  player.setMaxPieceMs(LedPatternPlayer::MAX_PIECE_MS);
+  TEST_ASSERT_EQUAL_UINT16(100, stepAt(player, 2000).fadeMs);
+}
+
+void test_restart_fades_from_the_current_level() {
+  const LedSegment on[] = {{255, 0, 0}};
+  const LedSegment down[] = {{0, 200, 0}};
+  const LedPattern onPattern = {on, 1, 1, nullptr};
+  const LedPattern downPattern = {down, 1, 1, nullptr};
+  LedPatternPlayer player;
+  player.start(&onPattern, 0);
+  stepAt(player, 0);
+  TEST_ASSERT_EQUAL_UINT8(255, player.level());
+
+  player.start(&downPattern, 10);
+  TEST_ASSERT_EQUAL_UINT16(LED_GAMMA[128], stepAt(player, 10).duty); // Halfway
+  TEST_ASSERT_EQUAL_UINT16(0, stepAt(player, 110).duty);
+}
+
+void test_no_pattern_never_due() {
+  LedPatternPlayer player;
+  TEST_ASSERT_FALSE(player.isDue(0));
+  player.start(nullptr, 0);
+  TEST_ASSERT_FALSE(player.isDue(0));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, player.msUntilDue(0));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_gamma_table);
+  RUN_TEST(test_jumps_hold_and_repeat);
+  RUN_TEST(test_fade_is_split_into_pieces);
+  RUN_TEST(test_uneven_fade_ends_on_time);
+  RUN_TEST(test_hands_over_to_the_next_pattern);
+  RUN_TEST(test_longer_pieces_mean_fewer_steps);
+  RUN_TEST(test_restart_fades_from_the_current_level);
+  RUN_TEST(test_no_pattern_never_due);
+  return UNITY_END();
+}
@@ -0,0 +1,146 @@
+// LinkQuality: heartbeat loss and RSSI smoothing, and the adaptive node
+// timeout derived from the loss rate.
+
+#include <unity.h>
+#include "link_quality.h"
+
+const uint32_t INTERVAL_MS = 2000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// One heartbeat, answered or not, at time n seconds
+void heartbeat(LinkQuality& link, int64_t n, bool answered, int8_t rssi = 0) {
+  link.heartbeatSent(n * 1000000, true);
+  if (answered) TEST_ASSERT_TRUE(link.onReply(n * 1000000, rssi));
+}
+
+void test_clean_link_uses_the_shortest_timeout(void) {
+  LinkQuality link;
+  for (int64_t n = 1; n <= 10; n++) heartbeat(link, n, true);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, link.lossRate());
+  TEST_ASSERT_EQUAL_UINT8(LinkQuality::MIN_MISSES, link.missesBeforeTimeout());
+  TEST_ASSERT_EQUAL_UINT32(LinkQuality::MIN_MISSES * INTERVAL_MS + LinkQuality::TIMEOUT_GRACE_MS,
+                           link.timeoutMs(INTERVAL_MS));
+  TEST_ASSERT_EQUAL_UINT32(10, link.sent());
+  TEST_ASSERT_EQUAL_UINT32(10, link.replies());
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost());
+}
+
+void test_unanswered_heartbeat_counts_lost_at_the_next_send(void) {
+  LinkQuality link;
+  link.heartbeatSent(1000000, true);
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost()); // Still waiting for the reply
+  link.heartbeatSent(3000000, true);
+  TEST_ASSERT_EQUAL_UINT32(1, link.lost());
+  TEST_ASSERT_EQUAL_FLOAT(0.125f, link.lossRate());
+  // loss^k < 0.001 needs k = ceil(ln 0.001 / ln 0.125) = 4
+  TEST_ASSERT_EQUAL_UINT8(4, link.missesBeforeTimeout());
+  TEST_ASSERT_EQUAL_UINT32(4 * INTERVAL_MS + LinkQuality::TIMEOUT_GRACE_MS,
+                           link.timeoutMs(INTERVAL_MS));
+}
+
+void test_timeout_recovers_as_replies_return(void) {
+  LinkQuality link;
+  heartbeat(link, 1, false);
+  heartbeat(link, 2, true); // Samples the loss of heartbeat 1
+  TEST_ASSERT_EQUAL_UINT8(4, link.missesBeforeTimeout());
+  uint8_t previous = link.missesBeforeTimeout();
+  for (int64_t n = 3; n < 40; n++) {
+    heartbeat(link, n, true);
+    TEST_ASSERT_TRUE(link.missesBeforeTimeout() <= previous);
+    previous = link.missesBeforeTimeout();
+  }
+  TEST_ASSERT_EQUAL_UINT8(LinkQuality::MIN_MISSES, link.missesBeforeTimeout());
+}
+
+void test_dead_link_clamps_to_the_longest_timeout(void) {
+  LinkQuality link;
+  for (int64_t n = 1; n <= 40; n++) heartbeat(link, n, false);
+  TEST_ASSERT_EQUAL_UINT32(39, link.lost()); // The last one is still pending
+  TEST_ASSERT_TRUE(link.lossRate() > 0.99f);
+  TEST_ASSERT_EQUAL_UINT8(LinkQuality::MAX_MISSES, link.missesBeforeTimeout());
+}
+
+void test_stale_and_repeated_replies_are_rejected(void) {
+  LinkQuality link;
+  link.heartbeatSent(1000000, true);
+  link.heartbeatSent(3000000, true);
+  TEST_ASSERT_FALSE(link.onReply(1000000, -50)); // Late: already counted lost
+  TEST_ASSERT_TRUE(link.onReply(3000000, -50));
+  TEST_ASSERT_FALSE(link.onReply(3000000, -50)); // Duplicate
+  TEST_ASSERT_EQUAL_UINT32(1, link.replies());
+  TEST_ASSERT_EQUAL_UINT32(1, link.lost());
+}
+
+void test_disconnected_heartbeats_are_not_sampled(void) {
+  LinkQuality link;
+  link.heartbeatSent(1000000, false);
+  TEST_ASSERT_FALSE(link.onReply(1000000, -50));
+  link.heartbeatSent(3000000, false);
+  link.heartbeatSent(5000000, true);
+  TEST_ASSERT_EQUAL_UINT32(3, link.sent());
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, link.lossRate());
+}
+
+void test_rssi_average(void) {
+  LinkQuality link;
+  heartbeat(link, 1, true, 0); // Not measured
+  TEST_ASSERT_FALSE(link.hasRssi());
+  heartbeat(link, 2, true, -60);
+  TEST_ASSERT_TRUE(link.hasRssi());
+  TEST_ASSERT_EQUAL_FLOAT(-60.0f, link.rssiAverage()); // First sample seeds it
+  heartbeat(link, 3, true, -68);
+  TEST_ASSERT_EQUAL_INT8(-68, link.lastRssi());
+  TEST_ASSERT_EQUAL_FLOAT(-61.0f, link.rssiAverage());
+  heartbeat(link, 4, true, 0);
+  TEST_ASSERT_EQUAL_INT8(-68, link.lastRssi());
+  TEST_ASSERT_EQUAL_FLOAT(-61.0f, link.rssiAverage());
+}
+
+void test_suppressed_heartbeats(void) {
+  LinkQuality link;
+  TEST_ASSERT_EQUAL_UINT32(1, link.heartbeatSent(1000000, true));
+  link.heartbeatSuppressed();
+  link.heartbeatSuppressed();
+  TEST_ASSERT_EQUAL_UINT8(2, link.suppressedRun());
+  // The reply to the last heartbeat sent is still accepted
+  TEST_ASSERT_TRUE(link.onReply(1000000, -55));
+  TEST_ASSERT_EQUAL_UINT32(2, link.heartbeatSent(7000000, true));
+  TEST_ASSERT_EQUAL_UINT8(0, link.suppressedRun());
+  TEST_ASSERT_EQUAL_UINT32(2, link.suppressed());
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost());
+}
+
+void test_reset_forgets_everything(void) {
+  LinkQuality link;
+  heartbeat(link, 1, false);
+  heartbeat(link, 2, true, -70);
+  link.heartbeatSuppressed();
+  link.heartbeatSent(5000000, true);
+  link.reset();
+  TEST_ASSERT_FALSE(link.onReply(5000000, -70));
+  TEST_ASSERT_FALSE(link.hasRssi());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, link.lossRate());
+  TEST_ASSERT_EQUAL_UINT8(0, link.suppressedRun());
+  TEST_ASSERT_EQUAL_UINT32(0, link.sent());
+  TEST_ASSERT_EQUAL_UINT32(0, link.replies());
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost());
+  TEST_ASSERT_EQUAL_UINT32(0, link.suppressed());
+  TEST_ASSERT_EQUAL_UINT32(1, link.heartbeatSent(7000000, true));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_link_uses_the_shortest_timeout);
+  RUN_TEST(test_unanswered_heartbeat_counts_lost_at_the_next_send);
+  RUN_TEST(test_timeout_recovers_as_replies_return);
+  RUN_TEST(test_dead_link_clamps_to_the_longest_timeout);
+  RUN_TEST(test_stale_and_repeated_replies_are_rejected);
+  RUN_TEST(test_disconnected_heartbeats_are_not_sampled);
+  RUN_TEST(test_rssi_average);
+  RUN_TEST(test_suppressed_heartbeats);
+  RUN_TEST(test_reset_forgets_everything);
+  return UNITY_END();
+}
@@ -0,0 +1,219 @@
+// LinkScheduler on the host: heartbeat rounds and their suppression after
+// ACKs, LED delivery tracking on publish and sync, and retransmits until the
+// node ACKs or delivery gives up, against a fake clock and radio.
+
+#include <vector>
+#include <unity.h>
+#include "link_scheduler.h"
+
+// ============================================================================
+// FAKES
+// ============================================================================
+
+class FakeClock : public GameClock {
+public:
+  FakeClock() : now(0) {}
+  int64_t nowUs() override { return now; }
+  int64_t now;
+};
+
+class FakeLinkTransport : public LinkTransport {
+public:
+  FakeLinkTransport() : broadcasts(0) {}
+  void sendHeartbeat(const HeartbeatMessage& msg) override { heartbeats.push_back(msg); }
+  void broadcastLedFrame(const LedStateMessage&) override { broadcasts++; }
+  void resendLedFrame(uint8_t nodeId, const LedStateMessage&) override {
+    resends.push_back(nodeId);
+  }
+  void deliveryFailed(uint8_t nodeId, uint16_t) override { failed.push_back(nodeId); }
+
+  // Heartbeats of the last round, by addressed node
+  bool heartbeatTo(uint8_t nodeId) const {
+    for (const HeartbeatMessage& msg : heartbeats) {
+      if (msg.node_id == nodeId) return true;
+    }
+    return false;
+  }
+
+  std::vector<HeartbeatMessage> heartbeats;
+  int broadcasts;
+  std::vector<uint8_t> resends;
+  std::vector<uint8_t> failed;
+};
+
+const uint8_t NODES = 4;
+const uint8_t MAX_SUPPRESSED = 3;
+
+struct Fixture {
+  Fixture() : links(clock, transport, MAX_SUPPRESSED), frame() {
+    frame.msg_type = MSG_LED_STATE;
+    frame.epoch = 7;
+  }
+
+  void round() {
+    transport.heartbeats.clear();
+    links.heartbeat(frame);
+  }
+
+  void publish() {
+    frame.seq++;
+    links.published(frame);
+  }
+
+  FakeClock clock;
+  FakeLinkTransport transport;
+  LinkScheduler<NODES> links;
+  LedStateMessage frame;
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+
+void test_heartbeat_round_reaches_every_node() {
+  Fixture f;
+  f.frame.msg_type = 0; // Nothing published yet: no LED repeat
+  f.frame.seq = 41;
+  f.clock.now = 2000000;
+  f.round();
+  TEST_ASSERT_EQUAL(NODES, f.transport.heartbeats.size());
+  for (uint8_t i = 0; i < NODES; i++) {
+    const HeartbeatMessage& msg = f.transport.heartbeats[i];
+    TEST_ASSERT_EQUAL_UINT8(i + 1, msg.node_id);
+    TEST_ASSERT_EQUAL_UINT8(MSG_HEARTBEAT, msg.msg_type);
+    TEST_ASSERT_EQUAL_UINT16(41, msg.led_seq);
+    TEST_ASSERT_EQUAL_UINT32(7, msg.epoch);
+    TEST_ASSERT_EQUAL_UINT32(1, msg.number);
+    TEST_ASSERT_EQUAL_UINT64(2000000, msg.time_us);
+  }
+  TEST_ASSERT_EQUAL(0, f.transport.broadcasts);
+
+  f.frame.msg_type = MSG_LED_STATE;
+  f.round();
+  TEST_ASSERT_EQUAL_UINT32(2, f.transport.heartbeats[0].number);
+  TEST_ASSERT_EQUAL(1, f.transport.broadcasts);
+}
+
+void test_ack_makes_the_next_heartbeat_redundant() {
+  Fixture f;
+  f.links.setConnected(1, true);
+  f.links.setConnected(2, true);
+  f.round();
+
+  f.links.onAck(1, 0, 0);
+  f.links.onAck(3, 0, 0); // Not connected: always gets its heartbeat
+  TEST_ASSERT_TRUE(f.links.heartbeatRedundant(1));
+  TEST_ASSERT_FALSE(f.links.heartbeatRedundant(2)); // No ACK
+  TEST_ASSERT_FALSE(f.links.heartbeatRedundant(3));
+  f.round();
+  TEST_ASSERT_FALSE(f.transport.heartbeatTo(1));
+  TEST_ASSERT_TRUE(f.transport.heartbeatTo(2));
+  TEST_ASSERT_TRUE(f.transport.heartbeatTo(3));
+  TEST_ASSERT_EQUAL_UINT32(1, f.links.quality(1).suppressed());
+
+  // The ACK only counts for the round after it
+  f.round();
+  TEST_ASSERT_TRUE(f.transport.heartbeatTo(1));
+}
+
+void test_suppression_is_capped() {
+  Fixture f;
+  f.links.setConnected(1, true);
+  f.round();
+  for (uint8_t n = 0; n < MAX_SUPPRESSED; n++) {
+    f.links.onAck(1, 0, 0);
+    f.round();
+    TEST_ASSERT_FALSE(f.transport.heartbeatTo(1));
+  }
+  f.links.onAck(1, 0, 0);
+  f.round();
+  TEST_ASSERT_TRUE(f.transport.heartbeatTo(1)); // Clock sync and status stay fresh
+  TEST_ASSERT_EQUAL_UINT8(0, f.links.quality(1).suppressedRun());
+}
+
+void test_low_power_node_always_gets_its_heartbeat() {
+  Fixture f;
+  f.links.setConnected(1, true);
+  f.clock.now = 1000;
+  f.round();
+  TEST_ASSERT_TRUE(f.links.onReply(1, 1000, -50, NODE_STATUS_LOW_POWER));
+  f.links.onAck(1, 0, 0);
+  TEST_ASSERT_FALSE(f.links.heartbeatRedundant(1));
+
+  // Back in active mode
+  f.round();
+  f.links.onReply(1, 1000, -50, 0);
+  f.links.onAck(1, 0, 0);
+  TEST_ASSERT_TRUE(f.links.heartbeatRedundant(1));
+}
+
+void test_publish_tracks_connected_nodes_only() {
+  Fixture f;
+  f.links.setConnected(2, true);
+  f.publish();
+  TEST_ASSERT_TRUE(f.links.isPending());
+  TEST_ASSERT_TRUE(f.links.delivery(2).isPending());
+  TEST_ASSERT_FALSE(f.links.delivery(1).isPending());
+
+  f.links.onAck(2, f.frame.seq, 3000);
+  TEST_ASSERT_FALSE(f.links.isPending());
+  TEST_ASSERT_EQUAL_UINT32(1, f.links.delivery(2).acked());
+}
+
+void test_overdue_ack_is_retransmitted_then_given_up() {
+  Fixture f;
+  f.links.setConnected(3, true);
+  f.publish();
+
+  f.clock.now = ReliableLink::INITIAL_RTO_US - 1;
+  f.links.retransmit(f.frame);
+  TEST_ASSERT_EQUAL(0, f.transport.resends.size());
+
+  for (int64_t n = 0; f.links.isPending() && n < 100; n++) {
+    f.clock.now += ReliableLink::MAX_RTO_US;
+    f.links.retransmit(f.frame);
+  }
+  TEST_ASSERT_EQUAL(ReliableLink::MAX_RESENDS, f.transport.resends.size());
+  TEST_ASSERT_EQUAL_UINT8(3, f.transport.resends[0]);
+  TEST_ASSERT_EQUAL(1, f.transport.failed.size());
+  TEST_ASSERT_EQUAL_UINT8(3, f.transport.failed[0]);
+}
+
+void test_sync_is_tracked_and_disconnect_cancels() {
+  Fixture f;
+  f.links.setConnected(4, true);
+  f.links.synced(4, 12);
+  TEST_ASSERT_TRUE(f.links.delivery(4).isPending());
+  TEST_ASSERT_EQUAL_UINT16(12, f.links.delivery(4).pendingSeq());
+
+  f.links.setConnected(4, false);
+  TEST_ASSERT_FALSE(f.links.isConnected(4));
+  TEST_ASSERT_FALSE(f.links.isPending());
+}
+
+void test_out_of_range_nodes_ignored() {
+  Fixture f;
+  f.links.setConnected(0, true);
+  f.links.setConnected(NODES + 1, true);
+  f.links.synced(NODES + 1, 1);
+  f.links.onAck(0, 1, 0);
+  TEST_ASSERT_FALSE(f.links.onReply(NODES + 1, 0, 0, 0));
+  TEST_ASSERT_FALSE(f.links.isPending());
+  TEST_ASSERT_FALSE(f.links.heartbeatRedundant(0));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_heartbeat_round_reaches_every_node);
+  RUN_TEST(test_ack_makes_the_next_heartbeat_redundant);
+  RUN_TEST(test_suppression_is_capped);
+  RUN_TEST(test_low_power_node_always_gets_its_heartbeat);
+  RUN_TEST(test_publish_tracks_connected_nodes_only);
+  RUN_TEST(test_overdue_ack_is_retransmitted_then_given_up);
+  RUN_TEST(test_sync_is_tracked_and_disconnect_cancels);
+  RUN_TEST(test_out_of_range_nodes_ignored);
+  return UNITY_END();
+}
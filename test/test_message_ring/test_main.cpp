@@ -0,0 +1,126 @@
+// MessageRing: record round trip, truncation, both backpressure policies
+// and arena wrap-around checked against a reference FIFO.
+
+#include <deque>
+#include <string>
+#include <unity.h>
+#include "message_ring.h"
+
+typedef MessageRing<128, 32> Ring; // Room for a handful of records
+
+std::string popString(Ring& ring, uint64_t* timeUs = nullptr) {
+  const char* data;
+  uint8_t len;
+  uint64_t t;
+  if (!ring.peek(data, len, t)) return "<empty>";
+  std::string s(data, len);
+  if (timeUs) *timeUs = t;
+  ring.pop();
+  return s;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_records_round_trip_with_timestamps() {
+  Ring ring;
+  TEST_ASSERT_TRUE(ring.format(1000, "BUZZ %u", 3));
+  TEST_ASSERT_TRUE(ring.format(0x123456789ULL, "WRONG"));
+  TEST_ASSERT_EQUAL_UINT16(2, ring.size());
+  TEST_ASSERT_EQUAL_UINT16(2 * 9 + 6 + 5, ring.usedBytes());
+
+  uint64_t t = 0;
+  TEST_ASSERT_EQUAL_STRING("BUZZ 3", popString(ring, &t).c_str());
+  TEST_ASSERT_EQUAL_UINT64(1000, t);
+  TEST_ASSERT_EQUAL_STRING("WRONG", popString(ring, &t).c_str());
+  TEST_ASSERT_EQUAL_UINT64(0x123456789ULL, t);
+  TEST_ASSERT_EQUAL_UINT16(0, ring.size());
+  TEST_ASSERT_EQUAL_UINT16(0, ring.usedBytes());
+}
+
+void test_long_records_truncated() {
+  Ring ring;
+  TEST_ASSERT_TRUE(ring.format(0, "%s", "0123456789012345678901234567890123456789"));
+  TEST_ASSERT_EQUAL_STRING("01234567890123456789012345678901", popString(ring).c_str());
+}
+
+void test_empty_record_rejected() {
+  Ring ring;
+  TEST_ASSERT_FALSE(ring.format(0, "%s", ""));
+  TEST_ASSERT_EQUAL_UINT16(0, ring.size());
+}
+
+void test_drop_newest_keeps_queued_records() {
+  Ring ring(MessageRingBase::DROP_NEWEST);
+  int accepted = 0;
+  for (int i = 0; i < 20; i++) {
+    if (ring.format(i, "MSG %02d", i)) accepted++;
+  }
+  TEST_ASSERT_TRUE(accepted > 0 && accepted < 20);
+  TEST_ASSERT_EQUAL_UINT32(20 - accepted, ring.dropped());
+  TEST_ASSERT_EQUAL_STRING("MSG 00", popString(ring).c_str());
+}
+
+void test_drop_oldest_keeps_newest_records() {
+  Ring ring(MessageRingBase::DROP_OLDEST);
+  for (int i = 0; i < 20; i++) {
+    TEST_ASSERT_TRUE(ring.format(i, "MSG %02d", i));
+  }
+  TEST_ASSERT_TRUE(ring.dropped() > 0);
+  TEST_ASSERT_EQUAL_UINT32(20, ring.size() + ring.dropped());
+
+  // What survives is the newest contiguous run, still in order
+  int first = 20 - ring.size();
+  for (int i = first; i < 20; i++) {
+    char expected[16];
+    snprintf(expected, sizeof(expected), "MSG %02d", i);
+    TEST_ASSERT_EQUAL_STRING(expected, popString(ring).c_str());
+  }
+  TEST_ASSERT_EQUAL_STRING("<empty>", popString(ring).c_str());
+}
+
+void test_policy_switch() {
+  Ring ring;
+  TEST_ASSERT_EQUAL(MessageRingBase::DROP_OLDEST, ring.policy());
+  ring.setPolicy(MessageRingBase::DROP_NEWEST);
+  TEST_ASSERT_EQUAL(MessageRingBase::DROP_NEWEST, ring.policy());
+}
+
+void test_wrap_around_matches_reference_fifo() {
+  Ring ring(MessageRingBase::DROP_NEWEST);
+  std::deque<std::string> model;
+  uint32_t rng = 12345;
+
+  for (int step = 0; step < 20000; step++) {
+    rng = rng * 1103515245u + 12345u;
+    if ((rng >> 16) % 3 != 0) {
+      // Variable lengths so records land at every offset of the arena
+      int len = 1 + (rng >> 8) % 40;
+      std::string s(len, (char)('a' + step % 26));
+      bool ok = ring.format(step, "%s", s.c_str());
+      if (ok) model.push_back(s.substr(0, 32));
+    } else if (!model.empty()) {
+      TEST_ASSERT_EQUAL_STRING(model.front().c_str(), popString(ring).c_str());
+      model.pop_front();
+    }
+    TEST_ASSERT_EQUAL_UINT16(model.size(), ring.size());
+    TEST_ASSERT_TRUE(ring.usedBytes() <= ring.capacityBytes());
+  }
+  while (!model.empty()) {
+    TEST_ASSERT_EQUAL_STRING(model.front().c_str(), popString(ring).c_str());
+    model.pop_front();
+  }
+  TEST_ASSERT_EQUAL_UINT16(0, ring.size());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_round_trip_with_timestamps);
+  RUN_TEST(test_long_records_truncated);
+  RUN_TEST(test_empty_record_rejected);
+  RUN_TEST(test_drop_newest_keeps_queued_records);
+  RUN_TEST(test_drop_oldest_keeps_newest_records);
+  RUN_TEST(test_policy_switch);
+  RUN_TEST(test_wrap_around_matches_reference_fifo);
+  return UNITY_END();
+}
@@ -0,0 +1,291 @@
+// NodeLink on the host: connecting on a heartbeat and pulling a state sync,
+// LED frame dedup and ACKs, state sync decoding, heartbeat gap counting,
+// epoch changes and disconnects, against a fake clock and radio.
+
+#include <string.h>
+#include <vector>
+#include <unity.h>
+#include "node_link.h"
+
+// ============================================================================
+// FAKES
+// ============================================================================
+
+class FakeClock : public GameClock {
+public:
+  FakeClock() : now(0) {}
+  int64_t nowUs() override { return now; }
+  int64_t now;
+};
+
+class FakeNodeIO : public NodeLinkIO {
+public:
+  void sendToController(const void* data, size_t len) override {
+    const uint8_t* bytes = (const uint8_t*)data;
+    sent.push_back(std::vector<uint8_t>(bytes, bytes + len));
+  }
+  void showLed(LEDState state, int64_t rxTimeUs) override {
+    leds.push_back(state);
+    ledRxUs.push_back(rxTimeUs);
+  }
+  void heartbeat(TimeSyncMessage& reply) override {
+    reply.rssi = -60;
+    reply.battery_mv = 3900;
+  }
+  void log(const char*) override { logLines++; }
+
+  // Type of the n-th frame sent
+  uint8_t type(size_t n) const { return sent[n][1]; }
+  template <typename T> T frame(size_t n) const {
+    T msg;
+    TEST_ASSERT_EQUAL(sizeof(T), sent[n].size());
+    memcpy(&msg, sent[n].data(), sizeof(T));
+    return msg;
+  }
+
+  std::vector<std::vector<uint8_t> > sent;
+  std::vector<LEDState> leds;
+  std::vector<int64_t> ledRxUs;
+  int logLines = 0;
+};
+
+const uint8_t NODE = 2;
+const uint32_t EPOCH = 0xA1B2C3D4;
+
+struct Fixture {
+  Fixture() : link(NODE, clock, io) {}
+
+  void heartbeat(uint32_t number, uint16_t ledSeq, uint32_t epoch = EPOCH,
+                 uint8_t nodeId = NODE) {
+    HeartbeatMessage msg = {};
+    msg.node_id = nodeId;
+    msg.msg_type = MSG_HEARTBEAT;
+    msg.led_seq = ledSeq;
+    msg.epoch = epoch;
+    msg.number = number;
+    msg.time_us = 5000;
+    TEST_ASSERT_TRUE(link.onFrame((const uint8_t*)&msg, sizeof(msg), clock.now));
+  }
+
+  void ledFrame(uint16_t seq, LEDState state, uint32_t epoch = EPOCH) {
+    LedStateMessage msg = {};
+    msg.msg_type = MSG_LED_STATE;
+    msg.seq = seq;
+    msg.epoch = epoch;
+    msg.node_count = 4;
+    for (uint8_t i = 1; i <= 4; i++) setNodeLED(msg, i, i == NODE ? state : LED_OFF);
+    TEST_ASSERT_TRUE(link.onFrame((const uint8_t*)&msg, sizeof(msg), clock.now));
+  }
+
+  void stateSync(uint16_t seq, uint8_t selected, bool partial, uint64_t locked) {
+    StateSyncMessage msg = {};
+    msg.node_id = NODE;
+    msg.msg_type = MSG_STATE_SYNC;
+    msg.selected = selected;
+    msg.partial_lockout = partial ? 1 : 0;
+    msg.node_count = 4;
+    msg.led_seq = seq;
+    msg.epoch = EPOCH;
+    msg.locked = locked;
+    TEST_ASSERT_TRUE(link.onFrame((const uint8_t*)&msg, sizeof(msg), clock.now));
+  }
+
+  // Connect with a first heartbeat and apply the state sync it pulls (READY:
+  // LED on)
+  void connect(uint16_t seq) {
+    heartbeat(1, seq);
+    stateSync(seq, 0, false, 0);
+    io.sent.clear();
+    io.leds.clear();
+    io.ledRxUs.clear();
+  }
+
+  FakeClock clock;
+  FakeNodeIO io;
+  NodeLink link;
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+
+void test_first_heartbeat_connects_and_pulls_a_sync() {
+  Fixture f;
+  TEST_ASSERT_FALSE(f.link.isConnected());
+  TEST_ASSERT_EQUAL(LED_FADE, f.link.led());
+
+  f.clock.now = 7000;
+  f.heartbeat(1, 10);
+  TEST_ASSERT_TRUE(f.link.isConnected());
+  TEST_ASSERT_EQUAL(2, f.io.sent.size());
+  TimeSyncMessage reply = f.io.frame<TimeSyncMessage>(0);
+  TEST_ASSERT_EQUAL_UINT8(NODE, reply.node_id);
+  TEST_ASSERT_EQUAL_UINT8(MSG_TIME_SYNC, reply.msg_type);
+  TEST_ASSERT_EQUAL_UINT64(5000, reply.t1_us);
+  TEST_ASSERT_EQUAL_UINT64(7000, reply.t2_us);
+  TEST_ASSERT_EQUAL_UINT64(7000, reply.t3_us);
+  TEST_ASSERT_EQUAL_INT8(-60, reply.rssi);
+  TEST_ASSERT_EQUAL_UINT16(3900, reply.battery_mv);
+  TEST_ASSERT_EQUAL_UINT8(MSG_STATE_REQUEST, f.io.type(1));
+
+  // Heartbeats for other nodes are ours to ignore, not unexpected frames
+  f.heartbeat(2, 10, EPOCH, NODE + 1);
+  TEST_ASSERT_EQUAL(2, f.io.sent.size());
+}
+
+void test_led_frames_ignored_until_connected() {
+  Fixture f;
+  f.ledFrame(1, LED_ON);
+  TEST_ASSERT_EQUAL(0, f.io.sent.size()); // Not even ACKed
+  TEST_ASSERT_EQUAL(0, f.io.leds.size());
+  TEST_ASSERT_FALSE(f.link.hasLedSeq());
+}
+
+void test_led_frame_applied_once_and_always_acked() {
+  Fixture f;
+  f.connect(10);
+
+  f.clock.now = 9000;
+  f.ledFrame(11, LED_BLINK);
+  TEST_ASSERT_EQUAL(1, f.io.leds.size());
+  TEST_ASSERT_EQUAL(LED_BLINK, f.io.leds[0]);
+  TEST_ASSERT_EQUAL_INT64(9000, f.io.ledRxUs[0]);
+  AckMessage ack = f.io.frame<AckMessage>(0);
+  TEST_ASSERT_EQUAL_UINT8(MSG_LED_STATE, ack.acked_type);
+  TEST_ASSERT_EQUAL_UINT16(11, ack.seq);
+
+  // A repeat (our ACK may have been lost) and a stale frame: ACKed with the
+  // newest seq held, LED untouched
+  f.ledFrame(11, LED_BLINK);
+  f.ledFrame(9, LED_OFF);
+  TEST_ASSERT_EQUAL(1, f.io.leds.size());
+  TEST_ASSERT_EQUAL(3, f.io.sent.size());
+  TEST_ASSERT_EQUAL_UINT16(11, f.io.frame<AckMessage>(2).seq);
+
+  // A new seq that leaves this node's slot as it is: no restart
+  f.ledFrame(12, LED_BLINK);
+  TEST_ASSERT_EQUAL(1, f.io.leds.size());
+  TEST_ASSERT_EQUAL_UINT16(12, f.link.ledSeq());
+}
+
+void test_state_sync_decoding() {
+  StateSyncMessage msg = {};
+  msg.selected = 0;
+  TEST_ASSERT_EQUAL(LED_ON, NodeLink::stateSyncLed(msg, 1));   // READY
+  msg.selected = 3;
+  TEST_ASSERT_EQUAL(LED_BLINK, NodeLink::stateSyncLed(msg, 3)); // LOCKED, selected
+  TEST_ASSERT_EQUAL(LED_OFF, NodeLink::stateSyncLed(msg, 1));   // LOCKED, other
+  msg.selected = 0;
+  msg.partial_lockout = 1;
+  msg.locked = 0x5; // Nodes 1 and 3
+  TEST_ASSERT_EQUAL(LED_OFF, NodeLink::stateSyncLed(msg, 1));
+  TEST_ASSERT_EQUAL(LED_ON, NodeLink::stateSyncLed(msg, 2));
+  msg.locked = 1ULL << 63;
+  TEST_ASSERT_EQUAL(LED_OFF, NodeLink::stateSyncLed(msg, 64));
+}
+
+void test_state_sync_applied_and_repeat_only_acked() {
+  Fixture f;
+  f.heartbeat(1, 20);
+  f.io.sent.clear();
+
+  f.stateSync(20, NODE, false, 0);
+  TEST_ASSERT_EQUAL(1, f.io.leds.size());
+  TEST_ASSERT_EQUAL(LED_BLINK, f.io.leds[0]);
+  AckMessage ack = f.io.frame<AckMessage>(0);
+  TEST_ASSERT_EQUAL_UINT8(MSG_STATE_SYNC, ack.acked_type);
+  TEST_ASSERT_EQUAL_UINT16(20, ack.seq);
+
+  // Retransmitted sync: ACK again, LED (and its blink phase) left alone
+  f.stateSync(20, NODE, false, 0);
+  TEST_ASSERT_EQUAL(1, f.io.leds.size());
+  TEST_ASSERT_EQUAL(2, f.io.sent.size());
+}
+
+void test_heartbeat_behind_pulls_a_sync() {
+  Fixture f;
+  f.connect(10);
+
+  f.heartbeat(2, 10); // Same version: reply only
+  TEST_ASSERT_EQUAL(1, f.io.sent.size());
+  f.heartbeat(3, 12); // Missed an LED change
+  TEST_ASSERT_EQUAL(3, f.io.sent.size());
+  TEST_ASSERT_EQUAL_UINT8(MSG_STATE_REQUEST, f.io.type(2));
+}
+
+void test_heartbeat_gaps_counted_within_an_epoch() {
+  Fixture f;
+  f.connect(10);
+
+  f.heartbeat(4, 10); // 2 and 3 missed
+  TEST_ASSERT_EQUAL_UINT32(2, f.link.heartbeatGaps());
+  f.heartbeat(2, 10); // Backwards: not a gap
+  TEST_ASSERT_EQUAL_UINT32(2, f.link.heartbeatGaps());
+  TEST_ASSERT_EQUAL_UINT16(2, f.io.frame<TimeSyncMessage>(1).hb_gaps);
+
+  // A restarted controller numbers afresh: no gap across epochs
+  f.heartbeat(9, 1, EPOCH + 1);
+  TEST_ASSERT_EQUAL_UINT32(2, f.link.heartbeatGaps());
+}
+
+void test_new_epoch_drops_the_held_sequence() {
+  Fixture f;
+  f.connect(500);
+  TEST_ASSERT_TRUE(f.link.hasLedSeq());
+
+  // The restarted controller's seq 3 is older than 500 but not stale
+  f.ledFrame(3, LED_BLINK, EPOCH + 1);
+  TEST_ASSERT_EQUAL_UINT32(EPOCH + 1, f.link.epoch());
+  TEST_ASSERT_EQUAL_UINT16(3, f.link.ledSeq());
+  TEST_ASSERT_EQUAL(1, f.io.leds.size());
+  TEST_ASSERT_EQUAL(LED_BLINK, f.link.led());
+}
+
+void test_disconnect_fades_until_the_next_heartbeat() {
+  Fixture f;
+  f.connect(10);
+
+  f.link.disconnect();
+  TEST_ASSERT_FALSE(f.link.isConnected());
+  TEST_ASSERT_FALSE(f.link.hasLedSeq());
+  TEST_ASSERT_EQUAL(LED_FADE, f.link.led());
+  TEST_ASSERT_EQUAL(LED_FADE, f.io.leds.back());
+  TEST_ASSERT_EQUAL_INT64(-1, f.io.ledRxUs.back());
+
+  f.ledFrame(11, LED_ON); // Still disconnected
+  TEST_ASSERT_EQUAL(LED_FADE, f.link.led());
+
+  // Reconnecting pulls the state; no gap is counted across the outage
+  f.heartbeat(7, 11);
+  TEST_ASSERT_TRUE(f.link.isConnected());
+  TEST_ASSERT_EQUAL_UINT32(0, f.link.heartbeatGaps());
+  TEST_ASSERT_EQUAL_UINT8(MSG_STATE_REQUEST, f.io.type(f.io.sent.size() - 1));
+}
+
+void test_unknown_frames_rejected() {
+  Fixture f;
+  uint8_t retired[sizeof(BuzzerMessage)] = {0, MSG_LED_COMMAND};
+  TEST_ASSERT_FALSE(f.link.onFrame(retired, sizeof(retired), 0));
+  uint8_t shortHeartbeat[4] = {NODE, MSG_HEARTBEAT};
+  TEST_ASSERT_FALSE(f.link.onFrame(shortHeartbeat, sizeof(shortHeartbeat), 0));
+  TEST_ASSERT_FALSE(f.link.onFrame(retired, 1, 0));
+  TEST_ASSERT_EQUAL(0, f.io.sent.size());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_heartbeat_connects_and_pulls_a_sync);
+  RUN_TEST(test_led_frames_ignored_until_connected);
+  RUN_TEST(test_led_frame_applied_once_and_always_acked);
+  RUN_TEST(test_state_sync_decoding);
+  RUN_TEST(test_state_sync_applied_and_repeat_only_acked);
+  RUN_TEST(test_heartbeat_behind_pulls_a_sync);
+  RUN_TEST(test_heartbeat_gaps_counted_within_an_epoch);
+  RUN_TEST(test_new_epoch_drops_the_held_sequence);
+  RUN_TEST(test_disconnect_fades_until_the_next_heartbeat);
+  RUN_TEST(test_unknown_frames_rejected);
+  return UNITY_END();
+}
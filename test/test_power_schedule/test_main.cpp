@@ -0,0 +1,134 @@
+// Low-power schedule: radio windows line up with the controller heartbeat,
+// and a press is sent on the first loop() pass after it happens, so low-power
+// mode adds no press-to-send latency over active mode. The light-sleep wake-up
+// itself is a hardware latency and is not modelled here.
+
+#include <stdint.h>
+#include <unity.h>
+#include "power_schedule.h"
+
+const uint32_t HB = HEARTBEAT_INTERVAL_MS;
+const uint64_t PASS_US = 1000; // loop() pass when awake (delay(1))
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_busy_node_never_sleeps(void) {
+  const uint32_t spans[] = {0, 1, LIGHT_SLEEP_MIN_MS, 500, HB, UINT32_MAX};
+  for (uint32_t radio : spans) {
+    for (uint32_t led : spans) {
+      TEST_ASSERT_EQUAL_UINT32(0, lightSleepMs(false, radio, led));
+    }
+  }
+}
+
+void test_sleep_ends_at_the_first_deadline(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, lightSleepMs(true, LIGHT_SLEEP_MIN_MS - 1, UINT32_MAX));
+  TEST_ASSERT_EQUAL_UINT32(LIGHT_SLEEP_MIN_MS, lightSleepMs(true, LIGHT_SLEEP_MIN_MS, UINT32_MAX));
+  TEST_ASSERT_EQUAL_UINT32(100, lightSleepMs(true, 1500, 100));
+  TEST_ASSERT_EQUAL_UINT32(1500, lightSleepMs(true, 1500, UINT32_MAX));
+  TEST_ASSERT_EQUAL_UINT32(0, lightSleepMs(true, 0, 100)); // Radio window open
+}
+
+void test_connected_window_covers_each_heartbeat(void) {
+  for (uint32_t since = 0; since < 3 * HB; since++) {
+    uint32_t phase = since % HB;
+    uint32_t wait = radioNextWindowMs(since, true);
+    bool listening = phase >= HB - RADIO_WINDOW_LEAD_MS ||
+                     (since >= HB && phase < RADIO_WINDOW_LATE_MS);
+    if (listening) {
+      TEST_ASSERT_EQUAL_UINT32(0, wait);
+    } else {
+      // Wakes exactly RADIO_WINDOW_LEAD_MS before the expected heartbeat
+      TEST_ASSERT_EQUAL_UINT32(HB - RADIO_WINDOW_LEAD_MS, (since + wait) % HB);
+    }
+  }
+}
+
+void test_search_window_once_per_period(void) {
+  const uint32_t window = HB + RADIO_WINDOW_LEAD_MS + RADIO_WINDOW_LATE_MS;
+  for (uint32_t since = 0; since < 2 * RADIO_SEARCH_PERIOD_MS; since += 7) {
+    uint32_t phase = since % RADIO_SEARCH_PERIOD_MS;
+    uint32_t wait = radioNextWindowMs(since, false);
+    if (phase < window) {
+      TEST_ASSERT_EQUAL_UINT32(0, wait);
+    } else {
+      TEST_ASSERT_EQUAL_UINT32(0, (since + wait) % RADIO_SEARCH_PERIOD_MS);
+    }
+  }
+}
+
+// Node loop() model, connected, heartbeats on time every HB from t = 0. Each
+// pass handles a heartbeat that has arrived (radio hold afterwards) and sends
+// a press that has happened; then the node either light-sleeps until the
+// schedule or the button wakes it, or waits one pass.
+struct PressRun {
+  uint64_t latencyUs;  // Press to the pass that sends it
+  bool pressedAsleep;  // The press woke the node
+  bool missedHeartbeat;
+};
+
+PressRun runPress(bool lowPower, uint64_t pressUs) {
+  PressRun run = {0, false, false};
+  uint64_t now = 0, lastHeartbeat = 0, awakeUntil = 0, nextHeartbeat = HB * 1000ULL;
+  for (;;) {
+    if (nextHeartbeat <= now) {
+      lastHeartbeat = now;
+      awakeUntil = now + RADIO_HOLD_MS * 1000ULL;
+      nextHeartbeat += HB * 1000ULL;
+    }
+    if (pressUs <= now) {
+      run.latencyUs = now - pressUs;
+      return run;
+    }
+    if (lowPower) {
+      uint32_t sinceMs = (uint32_t)(now / 1000 - lastHeartbeat / 1000);
+      uint32_t sleepMs = lightSleepMs(now >= awakeUntil, radioNextWindowMs(sinceMs, true),
+                                      UINT32_MAX);
+      if (sleepMs > 0) {
+        uint64_t wake = now + sleepMs * 1000ULL;
+        if (nextHeartbeat < wake && nextHeartbeat < pressUs) run.missedHeartbeat = true;
+        if (pressUs < wake) {
+          run.pressedAsleep = true;
+          now = pressUs; // GPIO wake-up, press captured on wake
+        } else {
+          now = wake;
+        }
+        continue;
+      }
+    }
+    now += PASS_US;
+  }
+}
+
+void test_low_power_press_to_send_matches_active(void) {
+  uint64_t maxActive = 0, maxLow = 0;
+  uint32_t asleep = 0, presses = 0;
+  // Every press phase over two heartbeat intervals (odd step: off the ms grid)
+  for (uint64_t pressUs = HB * 1000ULL; pressUs < 3 * HB * 1000ULL; pressUs += 997) {
+    PressRun active = runPress(false, pressUs);
+    PressRun low = runPress(true, pressUs);
+    TEST_ASSERT_FALSE(low.missedHeartbeat);
+    TEST_ASSERT_TRUE(low.latencyUs <= PASS_US);
+    if (low.pressedAsleep) {
+      TEST_ASSERT_EQUAL_UINT64(0, low.latencyUs); // Sent on the first pass after wake-up
+      asleep++;
+    }
+    if (active.latencyUs > maxActive) maxActive = active.latencyUs;
+    if (low.latencyUs > maxLow) maxLow = low.latencyUs;
+    presses++;
+  }
+  TEST_ASSERT_TRUE(maxLow <= maxActive);
+  // Most phases find a connected low-power node asleep
+  TEST_ASSERT_TRUE(asleep > presses * 9 / 10);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_busy_node_never_sleeps);
+  RUN_TEST(test_sleep_ends_at_the_first_deadline);
+  RUN_TEST(test_connected_window_covers_each_heartbeat);
+  RUN_TEST(test_search_window_once_per_period);
+  RUN_TEST(test_low_power_press_to_send_matches_active);
+  return UNITY_END();
+}
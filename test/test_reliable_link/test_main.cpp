@@ -0,0 +1,152 @@
+// ReliableLink: RFC 6298 RTO estimation, Karn's rule, exponential backoff,
+// cumulative ACKs across sequence wrap, and the retry budget.
+
+#include <unity.h>
+#include "reliable_link.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_initial_timeout_before_any_sample() {
+  ReliableLink link;
+  TEST_ASSERT_FALSE(link.hasRtt());
+  TEST_ASSERT_EQUAL_UINT32(ReliableLink::INITIAL_RTO_US, link.currentRtoUs());
+  link.track(1, 0);
+  TEST_ASSERT_FALSE(link.isDue(ReliableLink::INITIAL_RTO_US - 1));
+  TEST_ASSERT_TRUE(link.isDue(ReliableLink::INITIAL_RTO_US));
+}
+
+void test_rto_follows_rfc6298() {
+  ReliableLink link;
+  link.track(1, 0);
+  TEST_ASSERT_TRUE(link.onAck(1, 4000));
+  // First sample: SRTT = R, RTTVAR = R/2, RTO = R + 4 * R/2
+  TEST_ASSERT_EQUAL_UINT32(4000, link.srttUs());
+  TEST_ASSERT_EQUAL_UINT32(2000, link.rttvarUs());
+  TEST_ASSERT_EQUAL_UINT32(12000, link.rtoUs());
+
+  link.track(2, 100000);
+  link.onAck(2, 108000); // R = 8000, |SRTT - R| = 4000
+  TEST_ASSERT_EQUAL_UINT32((3 * 2000 + 4000) / 4, link.rttvarUs());
+  TEST_ASSERT_EQUAL_UINT32((7 * 4000 + 8000) / 8, link.srttUs());
+  TEST_ASSERT_EQUAL_UINT32(4500 + 4 * 2500, link.rtoUs());
+  TEST_ASSERT_EQUAL_UINT32(8000, link.lastRttUs());
+}
+
+void test_rto_clamped() {
+  ReliableLink fast;
+  for (uint16_t seq = 1; seq <= 20; seq++) {
+    fast.track(seq, seq * 10000);
+    fast.onAck(seq, seq * 10000 + 300);
+  }
+  TEST_ASSERT_EQUAL_UINT32(ReliableLink::MIN_RTO_US, fast.rtoUs());
+
+  ReliableLink slow;
+  slow.track(1, 0);
+  slow.onAck(1, 900000);
+  TEST_ASSERT_EQUAL_UINT32(ReliableLink::MAX_RTO_US, slow.rtoUs());
+}
+
+void test_retransmitted_message_not_sampled() {
+  ReliableLink link;
+  link.track(1, 0);
+  link.onAck(1, 2000);
+  uint32_t srtt = link.srttUs();
+
+  link.track(2, 100000);
+  TEST_ASSERT_TRUE(link.retransmitted(106000));
+  // Ambiguous: the ACK may answer either copy (Karn's rule)
+  TEST_ASSERT_TRUE(link.onAck(2, 107000));
+  TEST_ASSERT_EQUAL_UINT32(srtt, link.srttUs());
+  TEST_ASSERT_EQUAL_UINT32(2000, link.lastRttUs());
+}
+
+void test_backoff_doubles_until_ack() {
+  ReliableLink link;
+  link.track(1, 0);
+  link.onAck(1, 2000);
+  uint32_t rto = link.rtoUs(); // 6000
+
+  link.track(2, 0);
+  int64_t now = 0;
+  for (int i = 1; i <= 3; i++) {
+    now += link.currentRtoUs();
+    TEST_ASSERT_TRUE(link.isDue(now));
+    link.retransmitted(now);
+    TEST_ASSERT_EQUAL_UINT32(rto << i, link.currentRtoUs());
+  }
+  TEST_ASSERT_FALSE(link.isDue(now + (rto << 3) - 1));
+
+  link.onAck(2, now + 1000);
+  TEST_ASSERT_EQUAL_UINT32(rto, link.currentRtoUs());
+}
+
+void test_backoff_capped_at_max_rto() {
+  ReliableLink link;
+  link.track(1, 0);
+  for (int i = 0; i < ReliableLink::MAX_RESENDS; i++) link.retransmitted(0);
+  TEST_ASSERT_EQUAL_UINT32(ReliableLink::MAX_RTO_US, link.currentRtoUs());
+}
+
+void test_gives_up_after_max_resends() {
+  ReliableLink link;
+  link.track(7, 0);
+  for (int i = 0; i < ReliableLink::MAX_RESENDS; i++) {
+    TEST_ASSERT_TRUE(link.retransmitted(i * 1000));
+  }
+  TEST_ASSERT_FALSE(link.retransmitted(99000));
+  TEST_ASSERT_FALSE(link.isPending());
+  TEST_ASSERT_EQUAL_UINT32(1, link.failures());
+  TEST_ASSERT_EQUAL_UINT32(ReliableLink::MAX_RESENDS, link.retransmits());
+  TEST_ASSERT_FALSE(link.onAck(7, 100000)); // Too late to count
+}
+
+void test_cumulative_and_stale_acks() {
+  ReliableLink link;
+  link.track(10, 0);
+  TEST_ASSERT_FALSE(link.onAck(9, 1000)); // Older than pending
+  TEST_ASSERT_TRUE(link.isPending());
+
+  // A newer send supersedes the pending one
+  link.track(11, 2000);
+  TEST_ASSERT_EQUAL_UINT16(11, link.pendingSeq());
+  TEST_ASSERT_FALSE(link.onAck(10, 3000));
+  TEST_ASSERT_TRUE(link.onAck(12, 4000)); // Covers 11
+  TEST_ASSERT_FALSE(link.onAck(12, 4000)); // Nothing pending
+  TEST_ASSERT_EQUAL_UINT32(2, link.sent());
+  TEST_ASSERT_EQUAL_UINT32(1, link.acked());
+}
+
+void test_ack_across_sequence_wrap() {
+  ReliableLink link;
+  link.track(0xFFFE, 0);
+  TEST_ASSERT_TRUE(link.onAck(0x0001, 1000)); // Wrapped but newer
+  link.track(0x0002, 2000);
+  TEST_ASSERT_FALSE(link.onAck(0xFFFF, 3000)); // Wrapped and older
+}
+
+void test_cancel_is_not_a_failure() {
+  ReliableLink link;
+  link.track(1, 0);
+  link.retransmitted(50000);
+  link.cancel();
+  TEST_ASSERT_FALSE(link.isPending());
+  TEST_ASSERT_FALSE(link.isDue(10000000));
+  TEST_ASSERT_EQUAL_UINT32(0, link.failures());
+  TEST_ASSERT_EQUAL_UINT32(ReliableLink::INITIAL_RTO_US, link.currentRtoUs());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_initial_timeout_before_any_sample);
+  RUN_TEST(test_rto_follows_rfc6298);
+  RUN_TEST(test_rto_clamped);
+  RUN_TEST(test_retransmitted_message_not_sampled);
+  RUN_TEST(test_backoff_doubles_until_ack);
+  RUN_TEST(test_backoff_capped_at_max_rto);
+  RUN_TEST(test_gives_up_after_max_resends);
+  RUN_TEST(test_cumulative_and_stale_acks);
+  RUN_TEST(test_ack_across_sequence_wrap);
+  RUN_TEST(test_cancel_is_not_a_failure);
+  return UNITY_END();
+}
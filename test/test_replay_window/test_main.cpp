@@ -0,0 +1,96 @@
+// ReplayWindow: duplicate press suppression with out-of-order ids, window
+// edges, large jumps, node restarts and id wrap-around.
+
+#include <unity.h>
+#include "replay_window.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_resent_press_is_duplicate() {
+  ReplayWindow window;
+  TEST_ASSERT_TRUE(window.accept(1000));
+  TEST_ASSERT_FALSE(window.accept(1000));
+  TEST_ASSERT_TRUE(window.accept(1001));
+  TEST_ASSERT_FALSE(window.accept(1001));
+  TEST_ASSERT_FALSE(window.accept(1000));
+  TEST_ASSERT_EQUAL_UINT32(2, window.accepted());
+  TEST_ASSERT_EQUAL_UINT32(3, window.duplicates());
+}
+
+void test_out_of_order_ids_inside_window() {
+  ReplayWindow window;
+  window.accept(100);
+  TEST_ASSERT_TRUE(window.accept(105));
+  TEST_ASSERT_TRUE(window.accept(103)); // Late but new
+  TEST_ASSERT_FALSE(window.accept(103));
+  TEST_ASSERT_TRUE(window.accept(101));
+  TEST_ASSERT_FALSE(window.accept(105));
+  TEST_ASSERT_FALSE(window.accept(100));
+}
+
+void test_window_edges() {
+  ReplayWindow window;
+  window.accept(1000);
+  window.accept(1000 + ReplayWindow::SIZE - 1);
+  // Oldest id still tracked: its bit is set
+  TEST_ASSERT_FALSE(window.accept(1000));
+  TEST_ASSERT_TRUE(window.accept(1001));
+  TEST_ASSERT_EQUAL_UINT32(0, window.restarts());
+
+  // One past the window: treated as a restarted node
+  TEST_ASSERT_TRUE(window.accept(1000 + ReplayWindow::SIZE - 1 - ReplayWindow::SIZE));
+  TEST_ASSERT_EQUAL_UINT32(1, window.restarts());
+}
+
+void test_large_jump_forgets_history() {
+  ReplayWindow window;
+  for (uint32_t id = 1; id <= 10; id++) window.accept(id);
+  TEST_ASSERT_TRUE(window.accept(10 + 100)); // Many presses lost
+  TEST_ASSERT_TRUE(window.accept(10 + 99));  // Inside the new window, unseen
+  TEST_ASSERT_FALSE(window.accept(10 + 100));
+}
+
+void test_node_restart_with_new_random_base() {
+  ReplayWindow window;
+  window.accept(0x80000000u);
+  window.accept(0x80000001u);
+  // Node rebooted; ids now start far below
+  TEST_ASSERT_TRUE(window.accept(0x00001234u));
+  TEST_ASSERT_EQUAL_UINT32(1, window.restarts());
+  TEST_ASSERT_FALSE(window.accept(0x00001234u));
+  TEST_ASSERT_TRUE(window.accept(0x00001235u));
+}
+
+void test_ids_wrap_around() {
+  ReplayWindow window;
+  window.accept(0xFFFFFFFEu);
+  TEST_ASSERT_TRUE(window.accept(0xFFFFFFFFu));
+  TEST_ASSERT_TRUE(window.accept(0x00000000u));
+  TEST_ASSERT_TRUE(window.accept(0x00000001u));
+  TEST_ASSERT_FALSE(window.accept(0xFFFFFFFFu));
+  TEST_ASSERT_FALSE(window.accept(0x00000000u));
+  TEST_ASSERT_EQUAL_UINT32(0, window.restarts());
+}
+
+void test_reset_stats_keeps_window() {
+  ReplayWindow window;
+  window.accept(5);
+  window.accept(5);
+  window.resetStats();
+  TEST_ASSERT_EQUAL_UINT32(0, window.accepted());
+  TEST_ASSERT_EQUAL_UINT32(0, window.duplicates());
+  TEST_ASSERT_FALSE(window.accept(5));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_resent_press_is_duplicate);
+  RUN_TEST(test_out_of_order_ids_inside_window);
+  RUN_TEST(test_window_edges);
+  RUN_TEST(test_large_jump_forgets_history);
+  RUN_TEST(test_node_restart_with_new_random_base);
+  RUN_TEST(test_ids_wrap_around);
+  RUN_TEST(test_reset_stats_keeps_window);
+  return UNITY_END();
+}